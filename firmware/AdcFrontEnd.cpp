@@ -0,0 +1,97 @@
+#include "AdcFrontEnd.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#endif
+
+#define ADC_FULL_SCALE 4095
+#define ADC_FULL_SCALE_MV 3100 // 12 dB attenuation
+#define ADC_DEFAULT_VREF_MV 1100
+
+uint16_t* AdcFrontEnd::linearization = nullptr;
+
+AdcFrontEnd::AdcFrontEnd() {
+  reset();
+}
+
+// Builds the raw-to-linear table from the eFuse calibration through the
+// ESP-IDF 5 adc_cali schemes (curve fitting where the chip has it, else
+// line fitting). Without calibration reads pass through.
+bool AdcFrontEnd::calibrate() {
+#if defined(ARDUINO_ARCH_ESP32)
+  adc_cali_handle_t handle = nullptr;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+  adc_cali_curve_fitting_config_t config = {};
+  config.unit_id = ADC_UNIT_1;
+  config.atten = ADC_ATTEN_DB_12;
+  config.bitwidth = ADC_BITWIDTH_12;
+  if (adc_cali_create_scheme_curve_fitting(&config, &handle) != ESP_OK) return false;
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+  adc_cali_line_fitting_config_t config = {};
+  config.unit_id = ADC_UNIT_1;
+  config.atten = ADC_ATTEN_DB_12;
+  config.bitwidth = ADC_BITWIDTH_12;
+#if CONFIG_IDF_TARGET_ESP32
+  config.default_vref = ADC_DEFAULT_VREF_MV;
+#endif
+  if (adc_cali_create_scheme_line_fitting(&config, &handle) != ESP_OK) return false;
+#else
+  return false;
+#endif
+  if (!linearization) {
+    linearization = new uint16_t[ADC_FRONT_END_LUT_SIZE];
+  }
+  for (uint16_t raw = 0; raw < ADC_FRONT_END_LUT_SIZE; raw++) {
+    int mv = 0;
+    adc_cali_raw_to_voltage(handle, raw, &mv);
+    uint32_t counts = ((uint32_t)(mv > 0 ? mv : 0) * ADC_FULL_SCALE + ADC_FULL_SCALE_MV / 2) / ADC_FULL_SCALE_MV;
+    linearization[raw] = (uint16_t)(counts > ADC_FULL_SCALE ? ADC_FULL_SCALE : counts);
+  }
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+  adc_cali_delete_scheme_curve_fitting(handle);
+#else
+  adc_cali_delete_scheme_line_fitting(handle);
+#endif
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AdcFrontEnd::reset() {
+  sum = 0;
+  count = 0;
+  history[0] = 0;
+  history[1] = 0;
+  primed = 0;
+  output = 0;
+}
+
+// Returns true when a new decimated sample is available via value(). The
+// median starts over after a reset and holds back its first
+// ADC_FRONT_END_PRIMING_OUTPUTS samples until it has three to compare, so
+// a spike at the start of a window is rejected like any other; after that
+// every 2^ADC_FRONT_END_OVERSAMPLE_SHIFT reads give one output.
+bool AdcFrontEnd::push(uint16_t raw) {
+  sum += linearization ? linearization[raw & (ADC_FRONT_END_LUT_SIZE - 1)] : raw;
+  if (++count < (1 << ADC_FRONT_END_OVERSAMPLE_SHIFT)) return false;
+
+  uint16_t decimated = (uint16_t)((sum + (1 << (ADC_FRONT_END_OVERSAMPLE_SHIFT - 1))) >> ADC_FRONT_END_OVERSAMPLE_SHIFT);
+  sum = 0;
+  count = 0;
+
+  if (primed < ADC_FRONT_END_PRIMING_OUTPUTS) {
+    history[primed++] = decimated;
+    return false;
+  }
+
+  uint16_t a = history[0];
+  uint16_t b = history[1];
+  uint16_t c = decimated;
+  uint16_t lo = a < b ? a : b;
+  uint16_t hi = a < b ? b : a;
+  output = c < lo ? lo : (c > hi ? hi : c);
+  history[0] = b;
+  history[1] = c;
+  return true;
+}
@@ -0,0 +1,36 @@
+#ifndef ADC_FRONT_END_H
+#define ADC_FRONT_END_H
+
+#include <stdint.h>
+
+#define ADC_FRONT_END_OVERSAMPLE_SHIFT 2 // 4 raw reads per output sample
+#define ADC_FRONT_END_LUT_SIZE 4096
+#define ADC_FRONT_END_PRIMING_OUTPUTS 2 // decimated samples the median needs first
+
+// Streaming capture conditioning for the 12-bit ESP32 ADC, all integer:
+// raw reads are linearized through a calibration table, summed over a
+// boxcar of 2^ADC_FRONT_END_OVERSAMPLE_SHIFT reads and decimated, and the
+// decimated stream is passed through a 3-tap median so a single spike
+// cannot set a whole window's peak-to-peak. Output stays on the 0..4095
+// scale so existing thresholds remain valid. Reset it at the start of every
+// window: windows are not contiguous, so no history may carry over.
+class AdcFrontEnd {
+public:
+  AdcFrontEnd();
+
+  static bool calibrate();
+  void reset();
+  bool push(uint16_t raw);
+  uint16_t value() const { return output; }
+
+private:
+  // Shared by all inputs, they sit on the same ADC unit
+  static uint16_t* linearization;
+  uint32_t sum;
+  uint8_t count;
+  uint16_t history[2];
+  uint8_t primed; // decimated samples held back so far
+  uint16_t output;
+};
+
+#endif
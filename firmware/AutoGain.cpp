@@ -0,0 +1,42 @@
+#include "AutoGain.h"
+
+AutoGain::AutoGain(uint32_t periodMs, uint16_t maxClipPermille, uint16_t raiseHeadroom, uint16_t stepNumerator, uint16_t stepDenominator) {
+  this->periodMs = periodMs;
+  this->maxClipPermille = maxClipPermille;
+  this->raiseHeadroom = raiseHeadroom;
+  this->stepNumerator = stepNumerator;
+  this->stepDenominator = stepDenominator;
+  reset(0);
+}
+
+void AutoGain::reset(uint32_t nowMs) {
+  periodStart = nowMs;
+  totalSamples = 0;
+  totalClips = 0;
+  peakSignal = 0;
+  holding = true;
+}
+
+AutoGain::Step AutoGain::update(uint32_t nowMs, uint16_t signal, uint16_t clips, uint16_t samples, bool canRaise, bool canLower) {
+  totalSamples += samples;
+  totalClips += clips;
+  if (signal > peakSignal) peakSignal = signal;
+
+  if (nowMs - periodStart < periodMs) return KEEP;
+
+  uint32_t clipPermille = totalSamples ? totalClips * 1000 / totalSamples : 0;
+  uint32_t raisedPeak = (uint32_t)peakSignal * stepNumerator / stepDenominator;
+  bool wasHolding = holding;
+  Step step = KEEP;
+
+  if (clipPermille > maxClipPermille && canLower) {
+    step = LOWER;
+  } else if (!wasHolding && totalClips == 0 && raisedPeak < raiseHeadroom && canRaise) {
+    step = RAISE;
+  }
+
+  reset(nowMs);
+  // After a change sit out one full period before considering a raise
+  holding = (step != KEEP);
+  return step;
+}
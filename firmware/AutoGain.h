@@ -0,0 +1,36 @@
+#ifndef AUTO_GAIN_H
+#define AUTO_GAIN_H
+
+#include <stdint.h>
+
+// Decides microphone gain steps from the clipping rate and peak headroom
+// observed over an evaluation period. Lowers gain as soon as the clip
+// rate is exceeded; raises it only if the loudest window of the period
+// would still fit after one step up, and never right after a change.
+class AutoGain {
+public:
+  enum Step {
+    KEEP = 0,
+    RAISE = 1,
+    LOWER = -1
+  };
+
+  AutoGain(uint32_t periodMs, uint16_t maxClipPermille, uint16_t raiseHeadroom, uint16_t stepNumerator, uint16_t stepDenominator);
+
+  void reset(uint32_t nowMs);
+  Step update(uint32_t nowMs, uint16_t signal, uint16_t clips, uint16_t samples, bool canRaise, bool canLower);
+
+private:
+  uint32_t periodMs;
+  uint16_t maxClipPermille;
+  uint16_t raiseHeadroom;
+  uint16_t stepNumerator;
+  uint16_t stepDenominator;
+  uint32_t periodStart;
+  uint32_t totalSamples;
+  uint32_t totalClips;
+  uint16_t peakSignal;
+  bool holding;
+};
+
+#endif
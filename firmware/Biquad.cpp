@@ -0,0 +1,65 @@
+#include "Biquad.h"
+#include <math.h>
+
+#define BIQUAD_PI 3.14159265f
+
+Biquad::Biquad() {
+  setBypass();
+  reset();
+}
+
+// Keeps the sample history: direct form I state is the signal itself, so
+// a redesign (e.g. a sample rate change) continues without a step
+void Biquad::setNormalized(float nb0, float nb1, float nb2, float na0, float na1, float na2) {
+  const float scale = (float)(1L << BIQUAD_COEFF_SHIFT) / na0;
+  b0 = (int32_t)lroundf(nb0 * scale);
+  b1 = (int32_t)lroundf(nb1 * scale);
+  b2 = (int32_t)lroundf(nb2 * scale);
+  a1 = (int32_t)lroundf(na1 * scale);
+  a2 = (int32_t)lroundf(na2 * scale);
+}
+
+void Biquad::designLowPass(float sampleRate, float cutoff, float q) {
+  float w0 = 2.0f * BIQUAD_PI * cutoff / sampleRate;
+  float alpha = sinf(w0) / (2.0f * q);
+  float c = cosf(w0);
+  setNormalized((1.0f - c) / 2.0f, 1.0f - c, (1.0f - c) / 2.0f, 1.0f + alpha, -2.0f * c, 1.0f - alpha);
+}
+
+void Biquad::designHighPass(float sampleRate, float cutoff, float q) {
+  float w0 = 2.0f * BIQUAD_PI * cutoff / sampleRate;
+  float alpha = sinf(w0) / (2.0f * q);
+  float c = cosf(w0);
+  setNormalized((1.0f + c) / 2.0f, -(1.0f + c), (1.0f + c) / 2.0f, 1.0f + alpha, -2.0f * c, 1.0f - alpha);
+}
+
+void Biquad::designHighShelf(float sampleRate, float frequency, float q, float gainDb) {
+  float a = powf(10.0f, gainDb / 40.0f);
+  float w0 = 2.0f * BIQUAD_PI * frequency / sampleRate;
+  float alpha = sinf(w0) / (2.0f * q);
+  float c = cosf(w0);
+  float s = 2.0f * sqrtf(a) * alpha;
+  setNormalized(
+    a * ((a + 1.0f) + (a - 1.0f) * c + s),
+    -2.0f * a * ((a - 1.0f) + (a + 1.0f) * c),
+    a * ((a + 1.0f) + (a - 1.0f) * c - s),
+    (a + 1.0f) - (a - 1.0f) * c + s,
+    2.0f * ((a - 1.0f) - (a + 1.0f) * c),
+    (a + 1.0f) - (a - 1.0f) * c - s);
+}
+
+// One-pole DC blocker y = x - x1 + r * y1 as a degenerate biquad
+void Biquad::designDcBlocker(float sampleRate, float cutoff) {
+  float r = 1.0f - 2.0f * BIQUAD_PI * cutoff / sampleRate;
+  setNormalized(1.0f, -1.0f, 0.0f, 1.0f, -r, 0.0f);
+}
+
+void Biquad::setBypass() {
+  setNormalized(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+// Only on explicit request, e.g. when the input stream restarts
+void Biquad::reset() {
+  x1 = x2 = y1 = y2 = 0;
+  error = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdint.h>
+
+#define BIQUAD_COEFF_SHIFT 28
+
+// Direct form I biquad. Samples are Q15, coefficients Q28 so the poles
+// of low cutoffs at ~20 kHz sample rates stay accurate; the accumulator
+// is 64 bit with first-order error feedback on the output rounding.
+// Coefficients are designed in float (RBJ cookbook) off the sample path.
+// Redesigning keeps the state; only reset() clears it.
+class Biquad {
+public:
+  Biquad();
+
+  void designLowPass(float sampleRate, float cutoff, float q);
+  void designHighPass(float sampleRate, float cutoff, float q);
+  void designHighShelf(float sampleRate, float frequency, float q, float gainDb);
+  void designDcBlocker(float sampleRate, float cutoff);
+  void setBypass();
+  void reset();
+
+  int32_t process(int32_t x) {
+    int64_t acc = (int64_t)b0 * x + (int64_t)b1 * x1 + (int64_t)b2 * x2
+                - (int64_t)a1 * y1 - (int64_t)a2 * y2 + error;
+    int32_t y = (int32_t)(acc >> BIQUAD_COEFF_SHIFT);
+    error = (int32_t)(acc - ((int64_t)y << BIQUAD_COEFF_SHIFT));
+    x2 = x1;
+    x1 = x;
+    y2 = y1;
+    y1 = y;
+    return y;
+  }
+
+private:
+  void setNormalized(float nb0, float nb1, float nb2, float na0, float na1, float na2);
+  int32_t b0, b1, b2, a1, a2;
+  int32_t x1, x2, y1, y2;
+  int32_t error;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef BLE_TRANSPORT_H
+#define BLE_TRANSPORT_H
+
+// BLE GATT transport on NimBLE-Arduino (2.x), exposing the Nordic UART
+// service: the phone writes commands to RX and subscribes to
+// notifications on TX. Header-only so the sketch only pulls in NimBLE
+// when it includes this file (USE_BLE).
+
+#include <NimBLEDevice.h>
+#include <atomic>
+#include "Transport.h"
+
+#define BLE_UART_SERVICE "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
+#define BLE_UART_RX "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"
+#define BLE_UART_TX "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define BLE_PREFERRED_MTU 185
+#define BLE_RX_BUFFER 256 // power of two
+
+class BleTransport : public Transport, NimBLEServerCallbacks, NimBLECharacteristicCallbacks {
+public:
+  void begin(const char* deviceName) override {
+    NimBLEDevice::init(deviceName);
+    NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
+    server = NimBLEDevice::createServer();
+    server->setCallbacks(this, false);
+    NimBLEService* service = server->createService(BLE_UART_SERVICE);
+    tx = service->createCharacteristic(BLE_UART_TX, NIMBLE_PROPERTY::NOTIFY);
+    NimBLECharacteristic* rx = service->createCharacteristic(
+      BLE_UART_RX, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
+    rx->setCallbacks(this);
+    service->start();
+    NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+    advertising->addServiceUUID(BLE_UART_SERVICE);
+    advertising->start();
+  }
+
+  int available() override {
+    return (uint16_t)(rxHead.load(std::memory_order_acquire) - rxTail.load(std::memory_order_relaxed));
+  }
+
+  int read() override {
+    uint16_t tail = rxTail.load(std::memory_order_relaxed);
+    if (rxHead.load(std::memory_order_acquire) == tail) return -1;
+    uint8_t c = rxBuffer[tail % BLE_RX_BUFFER];
+    rxTail.store(tail + 1, std::memory_order_release);
+    return c;
+  }
+
+  // One notification per MTU-sized piece; stops at the first one the
+  // stack cannot buffer and reports how much went out.
+  size_t write(const uint8_t* data, size_t length) override {
+    if (!isConnected()) return 0;
+    size_t payload = server->getPeerMTU(connection) - 3;
+    size_t sent = 0;
+    while (sent < length) {
+      size_t n = length - sent < payload ? length - sent : payload;
+      tx->setValue(data + sent, n);
+      if (!tx->notify()) break;
+      sent += n;
+    }
+    return sent;
+  }
+
+  bool isConnected() override {
+    return server && server->getConnectedCount() > 0;
+  }
+
+  // The last peer's address stays in peer after it disconnects
+  bool getPeerAddress(uint8_t address[6]) override {
+    if (!isConnected()) return false;
+    memcpy(address, peer, sizeof(peer));
+    return true;
+  }
+
+private:
+  NimBLEServer* server = nullptr;
+  NimBLECharacteristic* tx = nullptr;
+  uint16_t connection = 0;
+  uint8_t peer[6] = {};
+  // Filled from the NimBLE host task, drained by the loop; each index is
+  // written by one side only. The release store of an index publishes the
+  // bytes written before it.
+  uint8_t rxBuffer[BLE_RX_BUFFER];
+  std::atomic<uint16_t> rxHead{ 0 };
+  std::atomic<uint16_t> rxTail{ 0 };
+
+  // Advertising restarts by itself after a disconnect
+  void onConnect(NimBLEServer*, NimBLEConnInfo& info) override {
+    connection = info.getConnHandle();
+    memcpy(peer, info.getAddress().getVal(), sizeof(peer));
+  }
+
+  void onWrite(NimBLECharacteristic* characteristic, NimBLEConnInfo&) override {
+    NimBLEAttValue value = characteristic->getValue();
+    const uint8_t* bytes = value.data();
+    uint16_t head = rxHead.load(std::memory_order_relaxed);
+    uint16_t tail = rxTail.load(std::memory_order_acquire);
+    for (size_t i = 0; i < value.length(); i++) {
+      if ((uint16_t)(head - tail) >= BLE_RX_BUFFER) break;
+      rxBuffer[head % BLE_RX_BUFFER] = bytes[i];
+      head++;
+    }
+    rxHead.store(head, std::memory_order_release);
+  }
+};
+
+#endif
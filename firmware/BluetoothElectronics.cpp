@@ -1,51 +1,36 @@
 #define DEBUG 0
 #define DEBUG_BAUD_RATE 57600
-#define DEBUG_INPUT 0
 
 #include "BluetoothElectronics.h"
-#if !DEBUG_INPUT
-#include "BluetoothSerial.h"
-#endif
 
-BluetoothElectronics::BluetoothElectronics(String deviceName)
-  : deviceName(deviceName) {}
-
-void BluetoothElectronics::registerCommand(const String& receiveChar, void (*action)(const String&)) {
-  Command* newCommand = new Command{ receiveChar, action, nullptr };
-  if (!commandHead) {
-    commandHead = newCommand;
-  } else {
-    Command* temp = commandHead;
-    while (temp->next) {
-      temp = temp->next;
-    }
-    temp->next = newCommand;
-  }
+BluetoothElectronics::BluetoothElectronics(String deviceName, Transport& transport)
+  : deviceName(deviceName), transport(transport) {}
+
+void BluetoothElectronics::setCommands(const CommandIndex& commands) {
+  this->commands = commands;
+}
+
+void BluetoothElectronics::setInputListener(void (*listener)(const String&)) {
+  inputListener = listener;
+}
+
+// Called from handleInput() whenever a client has newly connected
+void BluetoothElectronics::setConnectListener(void (*listener)()) {
+  connectListener = listener;
 }
 
 void BluetoothElectronics::begin() {
 #if DEBUG
   Serial.begin(DEBUG_BAUD_RATE);
 #endif
-#if DEBUG_INPUT
-  if (!Serial) {
-    Serial.begin(DEBUG_BAUD_RATE);
-  }
-  Serial.println("Using Serial for input (DEBUG_INPUT mode)");
-#else
-  serialBT.begin(deviceName, false);
-#endif
+  transport.begin(deviceName.c_str());
 }
 
 void BluetoothElectronics::handleInput() {
   static String inputBuffer = "";
-#if DEBUG_INPUT
-  while (Serial.available()) {
-    char c = Serial.read();
-#else
-  while (serialBT.available()) {
-    char c = serialBT.read();
-#endif
+  flushOutput();
+  while (transport.available() > 0) {
+    char c = transport.read();
 #if DEBUG
     Serial.println("Received char: " + String(c));
 #endif
@@ -54,13 +39,12 @@ void BluetoothElectronics::handleInput() {
 #if DEBUG
       Serial.println("Received: " + inputBuffer);
 #endif
+      if (inputListener) {
+        inputListener(inputBuffer);
+      }
       processInput(inputBuffer);
-#if DEBUG_INPUT
-      Serial.println("Echo: " + inputBuffer);
-#else
-  #if DEBUG
-      serialBT.println("Echo: " + inputBuffer);
-  #endif
+#if DEBUG
+      enqueue("Echo: " + inputBuffer + "\r\n", 0);
 #endif
       inputBuffer = "";
     } else {
@@ -73,28 +57,77 @@ void BluetoothElectronics::processInput(String input) {
 #if DEBUG
   Serial.println("Processing trimmed input: " + input);
 #endif
-  Command* current = commandHead;
-  while (current) {
-    if (input.startsWith(current->receiveChar)) {
+  if (input.startsWith(KWL_BATCH_BEGIN)) {
+    processBatch(input);
+    return;
+  }
+  const KwlCommand* command = findCommand(commands, input.c_str());
+  if (command) {
 #if DEBUG
-      Serial.println("Matched receiveChar: " + current->receiveChar);
+    Serial.println("Matched receiveChar: " + String(command->receiveChar));
 #endif
-      String parameter = "";
-      int receiveCharLength = current->receiveChar.length();
-      if (input.length() > receiveCharLength) {
-        parameter = input.substring(receiveCharLength);
-      }
+    runCommand(command, input);
+  }
 #if DEBUG
-      Serial.println("Parameter: " + parameter);
+  Serial.println("Finished processing input.");
 #endif
-      current->action(parameter);
-      break;
+}
+
+// Batch frame: #<seq>|<command>;<command>;... answered by one *Q<seq>*.
+// A repeated seq is a retransmission and is only acknowledged again. A
+// latestWins command is skipped when the same command follows with only
+// other latestWins commands in between: those set independent values,
+// whereas anything else (e.g. a sampling mode switch) may change what the
+// skipped one would have applied to.
+void BluetoothElectronics::processBatch(const String& input) {
+  int bar = input.indexOf(KWL_BATCH_SEPARATOR);
+  if (bar < 0) return;
+  uint32_t seq = (uint32_t)input.substring(1, bar).toInt();
+  if (!hasBatchSeq || seq != lastBatchSeq) {
+    String parts[KWL_BATCH_MAX_COMMANDS];
+    const KwlCommand* matched[KWL_BATCH_MAX_COMMANDS];
+    uint8_t count = 0;
+    int start = bar + 1;
+    while (start < (int)input.length() && count < KWL_BATCH_MAX_COMMANDS) {
+      int end = input.indexOf(KWL_BATCH_DELIMITER, start);
+      if (end < 0) end = input.length();
+      parts[count] = input.substring(start, end);
+      parts[count].trim();
+      matched[count] = findCommand(commands, parts[count].c_str());
+      if (matched[count]) count++;
+      start = end + 1;
     }
-    current = current->next;
+    for (uint8_t i = 0; i < count; i++) {
+      bool superseded = false;
+      if (matched[i]->latestWins) {
+        for (uint8_t j = i + 1; j < count && !superseded && matched[j]->latestWins; j++) {
+          superseded = matched[j] == matched[i];
+        }
+      }
+      if (!superseded) {
+        runCommand(matched[i], parts[i]);
+      }
+    }
+    lastBatchSeq = seq;
+    hasBatchSeq = true;
+  }
+  sendKwlValue(seq, KWL_BATCH_ACK);
+}
+
+void BluetoothElectronics::runCommand(const KwlCommand* command, const String& input) {
+  String parameter = "";
+  unsigned receiveCharLength = strlen(command->receiveChar);
+  if (input.length() > receiveCharLength) {
+    parameter = input.substring(receiveCharLength);
   }
 #if DEBUG
-  Serial.println("Finished processing input.");
+  Serial.println("Parameter: " + parameter);
 #endif
+  command->action(parameter);
+}
+
+bool BluetoothElectronics::getPeerAddress(uint8_t address[6]) {
+  return transport.getPeerAddress(address);
 }
 
 void BluetoothElectronics::sendKwlString(String value, String receiveChar) {
@@ -102,12 +135,8 @@ void BluetoothElectronics::sendKwlString(String value, String receiveChar) {
 #if DEBUG
   Serial.println("Sending: " + cmd);
 #endif
-#if DEBUG_INPUT
-  Serial.println(cmd);
-#else
-  //serialBT.flush();
-  serialBT.println(cmd);
-#endif
+  char key = receiveChar.length() == 1 && coalescedKeys.indexOf(receiveChar[0]) >= 0 ? receiveChar[0] : 0;
+  enqueue(cmd + "\r\n", key);
 }
 
 void BluetoothElectronics::sendKwlValue(int value, String receiveChar) {
@@ -119,10 +148,114 @@ void BluetoothElectronics::sendKwlCode(String code) {
 #if DEBUG
   Serial.println("Sending: " + cmd);
 #endif
-#if DEBUG_INPUT
-  Serial.print(cmd);
-#else
-  //serialBT.flush();
-  serialBT.print(cmd);
-#endif
+  enqueue(cmd, 0);
+}
+
+void BluetoothElectronics::sendRaw(const String& text) {
+  enqueue(text, 0);
+}
+
+// Values sent under these receive chars only matter in their latest
+// form: a queued one is overwritten in place instead of adding a line.
+void BluetoothElectronics::setCoalescedKeys(const String& receiveChars) {
+  coalescedKeys = receiveChars;
+}
+
+void BluetoothElectronics::setMaxSendRate(uint16_t bytesPerSecond) {
+  this->bytesPerSecond = bytesPerSecond;
+  sendCredit = 0;
+}
+
+uint16_t BluetoothElectronics::getMaxSendRate() {
+  return bytesPerSecond;
+}
+
+// Lets bulk senders (e.g. a dump) wait for room instead of being dropped
+bool BluetoothElectronics::hasQueueSpace(uint16_t bytes, uint8_t lines) {
+  return queueCount + lines <= TX_QUEUE_SLOTS && queueBytes + bytes <= TX_QUEUE_MAX_BYTES;
+}
+
+uint32_t BluetoothElectronics::getDroppedCount() {
+  return droppedCount;
+}
+
+uint32_t BluetoothElectronics::getCoalescedCount() {
+  return coalescedCount;
+}
+
+void BluetoothElectronics::enqueue(const String& text, char key) {
+  if (key) {
+    // The head may be partly written already and is left alone
+    for (uint8_t i = headOffset ? 1 : 0; i < queueCount; i++) {
+      Outgoing& o = queue[(queueHead + i) % TX_QUEUE_SLOTS];
+      if (o.key == key && queueBytes - o.text.length() + text.length() <= TX_QUEUE_MAX_BYTES) {
+        queueBytes = queueBytes - o.text.length() + text.length();
+        o.text = text;
+        coalescedCount++;
+        return;
+      }
+    }
+  }
+  if (!hasQueueSpace(text.length())) {
+    droppedCount++;
+    return;
+  }
+  Outgoing& o = queue[(queueHead + queueCount) % TX_QUEUE_SLOTS];
+  o.text = text;
+  o.key = key;
+  queueCount++;
+  queueBytes += text.length();
+}
+
+// Writes queued text while the send credit lasts. Credit accrues at the
+// max send rate and is capped at TX_BURST_MS worth, so the link is never
+// fed faster than configured and the serial write does not block. Long
+// lines go out in pieces across calls.
+void BluetoothElectronics::flushOutput() {
+  uint32_t now = millis();
+  uint32_t elapsed = now - lastRefillMs;
+  lastRefillMs = now;
+  bool connected = transport.isConnected();
+  if (connected && !wasConnected) {
+    // A new client numbers its batches afresh
+    hasBatchSeq = false;
+    if (connectListener) {
+      wasConnected = true;
+      connectListener();
+    }
+  }
+  wasConnected = connected;
+  if (!connected) {
+    droppedCount += queueCount;
+    while (queueCount > 0) {
+      queue[queueHead].text = "";
+      queueHead = (queueHead + 1) % TX_QUEUE_SLOTS;
+      queueCount--;
+    }
+    queueBytes = 0;
+    headOffset = 0;
+    sendCredit = 0;
+    return;
+  }
+
+  if (bytesPerSecond > 0) {
+    uint32_t burst = (uint32_t)bytesPerSecond * TX_BURST_MS / 1000;
+    if (elapsed > TX_BURST_MS) elapsed = TX_BURST_MS;
+    sendCredit += elapsed * bytesPerSecond / 1000;
+    if (sendCredit > burst) sendCredit = burst;
+  }
+  while (queueCount > 0 && (bytesPerSecond == 0 || sendCredit > 0)) {
+    Outgoing& o = queue[queueHead];
+    uint16_t n = o.text.length() - headOffset;
+    if (bytesPerSecond > 0 && n > sendCredit) n = sendCredit;
+    size_t sent = transport.write((const uint8_t*)o.text.c_str() + headOffset, n);
+    if (bytesPerSecond > 0) sendCredit -= sent;
+    headOffset += sent;
+    if (headOffset < o.text.length()) break;
+    queueBytes -= o.text.length();
+    o.text = "";
+    headOffset = 0;
+    queueHead = (queueHead + 1) % TX_QUEUE_SLOTS;
+    queueCount--;
+  }
 }
@@ -2,35 +2,78 @@
 #define BLUETOOTH_ELECTRONICS_H
 
 #include "Arduino.h"
-#include "BluetoothSerial.h"
+#include "CommandTable.h"
+#include "Transport.h"
 
 #define KWL_BEGIN "*.kwl"
 #define KWL_END "*"
+#define KWL_BATCH_BEGIN "#"
+#define KWL_BATCH_SEPARATOR '|'
+#define KWL_BATCH_DELIMITER ';'
+#define KWL_BATCH_ACK "Q"
+#define KWL_BATCH_MAX_COMMANDS 16
+
+#define TX_QUEUE_SLOTS 16
+#define TX_QUEUE_MAX_BYTES 4096
+#define TX_DEFAULT_BYTES_PER_SECOND 8000 // 0 = unlimited
+#define TX_BURST_MS 100
 
 class BluetoothElectronics {
 public:
-  BluetoothElectronics(String deviceName);
-  void registerCommand(const String& receiveChar, void (*action)(const String&));
+  BluetoothElectronics(String deviceName, Transport& transport);
+  void setCommands(const CommandIndex& commands);
+  void setInputListener(void (*listener)(const String&));
+  void setConnectListener(void (*listener)());
   void begin();
   void handleInput();
 
+  bool getPeerAddress(uint8_t address[6]);
+
   void sendKwlString(String input, String receiveChar);
   void sendKwlValue(int value, String receiveChar);
   void sendKwlCode(String code);
+  void sendRaw(const String& text);
+
+  void setCoalescedKeys(const String& receiveChars);
+  void setMaxSendRate(uint16_t bytesPerSecond);
+  uint16_t getMaxSendRate();
+  bool hasQueueSpace(uint16_t bytes, uint8_t lines = 1);
+  void flushOutput();
+  uint32_t getDroppedCount();
+  uint32_t getCoalescedCount();
 
 private:
-  struct Command {
-    String receiveChar;
-    void (*action)(const String& parameter);
-    Command* next = nullptr;
+  String deviceName;
+  Transport& transport;
+  CommandIndex commands = {};
+  void (*inputListener)(const String& input) = nullptr;
+  void (*connectListener)() = nullptr;
+  bool wasConnected = false;
+  uint32_t lastBatchSeq = 0;
+  bool hasBatchSeq = false;
+  void processInput(String input);
+  void processBatch(const String& input);
+  void runCommand(const KwlCommand* command, const String& input);
 
-    Command(const String& r, void (*a)(const String&), Command* n = nullptr) : receiveChar(r), action(a), next(n) {}
+  // Outbound lines wait here and are written by flushOutput() as the
+  // send rate allows, so a slow or absent client never blocks the loop.
+  struct Outgoing {
+    String text;
+    char key;
   };
 
-  String deviceName;
-  BluetoothSerial serialBT;
-  Command* commandHead = nullptr;
-  void processInput(String input);
+  Outgoing queue[TX_QUEUE_SLOTS];
+  uint8_t queueHead = 0;
+  uint8_t queueCount = 0;
+  uint16_t queueBytes = 0;
+  String coalescedKeys;
+  uint16_t bytesPerSecond = TX_DEFAULT_BYTES_PER_SECOND;
+  uint16_t headOffset = 0;
+  uint32_t sendCredit = 0;
+  uint32_t lastRefillMs = 0;
+  uint32_t droppedCount = 0;
+  uint32_t coalescedCount = 0;
+  void enqueue(const String& text, char key);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define COMMAND_NONE 0xFF
+#define COMMAND_TABLE_MAX 254
+
+class String;
+
+// One Bluetooth command: input lines starting with receiveChar run the
+// action with the rest of the line. latestWins marks commands that set
+// an absolute value (sliders): within a batch only the last one applies.
+struct KwlCommand {
+  const char* receiveChar;
+  void (*action)(const String& parameter);
+  bool latestWins;
+};
+
+// Flat view of a CommandTable, so BluetoothElectronics needs no template
+struct CommandIndex {
+  const KwlCommand* commands;
+  const uint8_t* first; // 256 entries, by the input's first byte
+  const uint8_t* next; // chain of commands sharing a first byte
+};
+
+// Command list plus a jump table on the first character, all computed
+// at compile time so the table lives in flash and dispatch does not
+// allocate. Commands sharing a first character are chained and tried
+// in list order, like the former linked list.
+template <size_t N>
+struct CommandTable {
+  static_assert(N > 0 && N <= COMMAND_TABLE_MAX, "too many commands");
+
+  KwlCommand commands[N];
+  uint8_t first[256];
+  uint8_t next[N];
+
+  constexpr CommandTable(const KwlCommand (&list)[N])
+    : commands(), first(), next() {
+    for (size_t c = 0; c < 256; c++) {
+      first[c] = COMMAND_NONE;
+    }
+    for (size_t i = 0; i < N; i++) {
+      commands[i] = list[i];
+      next[i] = COMMAND_NONE;
+      uint8_t c = (uint8_t)list[i].receiveChar[0];
+      if (first[c] == COMMAND_NONE) {
+        first[c] = (uint8_t)i;
+      } else {
+        size_t last = first[c];
+        while (next[last] != COMMAND_NONE) {
+          last = next[last];
+        }
+        next[last] = (uint8_t)i;
+      }
+    }
+  }
+
+  constexpr CommandIndex index() const {
+    return CommandIndex{ commands, first, next };
+  }
+};
+
+template <size_t N>
+constexpr CommandTable<N> makeCommandTable(const KwlCommand (&list)[N]) {
+  return CommandTable<N>(list);
+}
+
+// First command whose receiveChar prefixes input, or nullptr
+inline const KwlCommand* findCommand(const CommandIndex& index, const char* input) {
+  if (!index.commands) return nullptr;
+  for (uint8_t i = index.first[(uint8_t)input[0]]; i != COMMAND_NONE; i = index.next[i]) {
+    const char* prefix = index.commands[i].receiveChar;
+    const char* p = input;
+    while (*prefix && *prefix == *p) {
+      prefix++;
+      p++;
+    }
+    if (!*prefix) return &index.commands[i];
+  }
+  return nullptr;
+}
+
+#endif
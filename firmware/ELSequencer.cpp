@@ -1,11 +1,8 @@
 #include "ELSequencer.h"
+#include "WireMask.h"
 
 ELSequencer::ELSequencer(const uint8_t order[], const uint8_t count)
   : channelOrder(order), channelCount(count) {
-    channelIndices = new uint8_t[count];
-    for (uint8_t i = 0; i < count; i++) {
-      channelIndices[i] = i;
-    }
     currentPattern = new uint8_t[count];
     for (uint8_t i = 0; i < count; i++) {
       currentPattern[i] = 0;
@@ -13,6 +10,7 @@ ELSequencer::ELSequencer(const uint8_t order[], const uint8_t count)
   }
 
 void ELSequencer::begin() {
+  rng.seed(esp_random());
   initSequencer();
   playWireStartSequence();
 }
@@ -49,6 +47,14 @@ void ELSequencer::lightWiresByPattern(uint8_t pattern[]) {
   }
 }
 
+void ELSequencer::lightWiresByMask(uint8_t mask) {
+  for (uint8_t i = 0; i < channelCount; i++) {
+    uint8_t value = (i < WIRE_MASK_MAX_CHANNELS && (mask >> i) & 1) ? HIGH : LOW;
+    digitalWrite(channelOrder[i], value);
+    currentPattern[i] = (value == HIGH) ? 1 : 0;
+  }
+}
+
 void ELSequencer::lightAll() {
   for (uint8_t i = 0; i < channelCount; i++) {
     digitalWrite(channelOrder[i], HIGH);
@@ -64,31 +70,15 @@ void ELSequencer::lightNone() {
 }
 
 void ELSequencer::lightRandomWires() {
-  for (uint8_t i = 0; i < channelCount; i++) {
-    uint8_t value = random(0, 2) > 0 ? HIGH : LOW;
-    digitalWrite(channelOrder[i], value);
-    currentPattern[i] = (value == HIGH) ? 1 : 0;
-  }
+  lightWiresByMask((uint8_t)(rng.next() >> 24) & WireMask::fullMask(channelCount));
 }
 
 void ELSequencer::lightNumRandomWires(uint8_t numWires) {
-  if (numWires > channelCount) {
-    numWires = channelCount;
-  }
-  for (uint8_t i = 0; i < channelCount; i++) {
-    uint8_t j = random(0, channelCount);
-    uint8_t temp = channelIndices[i];
-    channelIndices[i] = channelIndices[j];
-    channelIndices[j] = temp;
-  }
-  for (uint8_t i = 0; i < channelCount; i++) {
-    digitalWrite(channelOrder[i], LOW);
-    currentPattern[i] = 0;
-  }
-  for (uint8_t i = 0; i < numWires; i++) {
-    digitalWrite(channelOrder[channelIndices[i]], HIGH);
-    currentPattern[channelIndices[i]] = 1;
-  }
+  lightWiresByMask(WireMask::randomMask(rng, channelCount, numWires));
+}
+
+void ELSequencer::swapRandomWires(uint8_t swapCount) {
+  lightWiresByMask(WireMask::swapBits(rng, getCurrentMask(), channelCount, swapCount));
 }
 
 void ELSequencer::initSequencer() {
@@ -123,6 +113,14 @@ void ELSequencer::getCurrentPattern(uint8_t* out) const {
   }
 }
 
+uint8_t ELSequencer::getCurrentMask() const {
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < channelCount && i < WIRE_MASK_MAX_CHANNELS; i++) {
+    if (currentPattern[i]) mask |= (uint8_t)(1U << i);
+  }
+  return mask;
+}
+
 bool ELSequencer::isChannelOn(uint8_t idx) const {
   if (idx >= channelCount) return false;
   return currentPattern[idx] != 0;
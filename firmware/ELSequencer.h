@@ -2,6 +2,7 @@
 #define EL_SEQUENCER_H
 
 #include "Arduino.h"
+#include "FastRandom.h"
 
 class ELSequencer {
 public:
@@ -11,12 +12,15 @@ public:
   void lightWiresAtIndex(uint8_t index);
   void lightNumWiresUpToWire(uint8_t num, uint8_t wireNum);
   void lightWiresByPattern(uint8_t pattern[]);
+  void lightWiresByMask(uint8_t mask);
   void lightAll();
   void lightNone();
   void lightRandomWires();
   void lightNumRandomWires(uint8_t num);
+  void swapRandomWires(uint8_t swapCount);
 
   void getCurrentPattern(uint8_t* out) const;
+  uint8_t getCurrentMask() const;
   uint8_t getChannelCount() const { return channelCount; }
   bool isChannelOn(uint8_t idx) const;
 
@@ -25,8 +29,8 @@ private:
   void playWireStartSequence();
   const uint8_t channelCount;
   const uint8_t* channelOrder;
-  uint8_t* channelIndices;
   uint8_t* currentPattern;
+  FastRandom rng;
 };
 
 #endif
\ No newline at end of file
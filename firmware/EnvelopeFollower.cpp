@@ -0,0 +1,78 @@
+#include "EnvelopeFollower.h"
+
+#define ENVELOPE_ONE (1UL << ENVELOPE_FRACTION_BITS)
+// Long gaps (e.g. the mode was inactive) saturate instead of overflowing
+#define ENVELOPE_MAX_ELAPSED_MS 60000UL
+
+EnvelopeFollower::EnvelopeFollower(uint16_t attackMsPerLevel, uint16_t releaseMsPerLevel) {
+  this->attackMsPerLevel = attackMsPerLevel;
+  this->releaseMsPerLevel = releaseMsPerLevel;
+  reset(0);
+}
+
+void EnvelopeFollower::setAttack(uint16_t msPerLevel) {
+  if (msPerLevel == attackMsPerLevel) return;
+  attackMsPerLevel = msPerLevel;
+  attackRemainder = 0;
+}
+
+void EnvelopeFollower::setRelease(uint16_t msPerLevel) {
+  if (msPerLevel == releaseMsPerLevel) return;
+  releaseMsPerLevel = msPerLevel;
+  releaseRemainder = 0;
+}
+
+void EnvelopeFollower::reset(uint32_t nowMs) {
+  value = 0;
+  goal = 0;
+  lastMs = nowMs;
+  attackRemainder = 0;
+  releaseRemainder = 0;
+}
+
+// Q8 distance covered in elapsedMs; the sub-step remainder is kept so
+// many short updates add up to exactly one long one
+uint32_t EnvelopeFollower::slew(uint32_t elapsedMs, uint16_t msPerLevel, uint32_t& remainder) {
+  if (msPerLevel == 0) return UINT32_MAX;
+  uint32_t scaled = elapsedMs * ENVELOPE_ONE + remainder;
+  remainder = scaled % msPerLevel;
+  return scaled / msPerLevel;
+}
+
+// The elapsed time is integrated towards the target held since the last
+// call; the new target takes effect from now on. Instant attack/release
+// settings apply the new target immediately.
+uint8_t EnvelopeFollower::update(uint16_t target, uint32_t nowMs) {
+  advance(nowMs - lastMs);
+  lastMs = nowMs;
+  goal = (uint32_t)target << ENVELOPE_FRACTION_BITS;
+
+  if ((goal > value && attackMsPerLevel == 0) || (goal < value && releaseMsPerLevel == 0)) {
+    value = goal;
+    attackRemainder = 0;
+    releaseRemainder = 0;
+  }
+  return getLevel();
+}
+
+void EnvelopeFollower::advance(uint32_t elapsedMs) {
+  if (elapsedMs > ENVELOPE_MAX_ELAPSED_MS) elapsedMs = ENVELOPE_MAX_ELAPSED_MS;
+  if (goal > value) {
+    releaseRemainder = 0;
+    uint32_t step = slew(elapsedMs, attackMsPerLevel, attackRemainder);
+    value = (goal - value > step) ? value + step : goal;
+  } else if (goal < value) {
+    attackRemainder = 0;
+    uint32_t step = slew(elapsedMs, releaseMsPerLevel, releaseRemainder);
+    value = (value - goal > step) ? value - step : goal;
+  }
+  if (value == goal) {
+    attackRemainder = 0;
+    releaseRemainder = 0;
+  }
+}
+
+// Rounded up: a level stays lit until a full release step has elapsed
+uint8_t EnvelopeFollower::getLevel() const {
+  return (uint8_t)((value + ENVELOPE_ONE - 1) >> ENVELOPE_FRACTION_BITS);
+}
@@ -0,0 +1,36 @@
+#ifndef ENVELOPE_FOLLOWER_H
+#define ENVELOPE_FOLLOWER_H
+
+#include <stdint.h>
+
+#define ENVELOPE_FRACTION_BITS 8
+
+// Slews a wire level towards its target at a fixed rate, given as
+// milliseconds per level for attack and release (0 = jump). Progress is
+// integrated from the exact elapsed time in Q8 with the division
+// remainder carried over, so the envelope does not depend on how often
+// update() is called.
+class EnvelopeFollower {
+public:
+  EnvelopeFollower(uint16_t attackMsPerLevel, uint16_t releaseMsPerLevel);
+
+  void setAttack(uint16_t msPerLevel);
+  void setRelease(uint16_t msPerLevel);
+  void reset(uint32_t nowMs);
+  uint8_t update(uint16_t target, uint32_t nowMs);
+  uint8_t getLevel() const;
+  uint32_t getValue() const { return value; }
+
+private:
+  void advance(uint32_t elapsedMs);
+  uint32_t slew(uint32_t elapsedMs, uint16_t msPerLevel, uint32_t& remainder);
+  uint16_t attackMsPerLevel;
+  uint16_t releaseMsPerLevel;
+  uint32_t value;
+  uint32_t goal;
+  uint32_t lastMs;
+  uint32_t attackRemainder;
+  uint32_t releaseRemainder;
+};
+
+#endif
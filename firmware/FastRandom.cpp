@@ -0,0 +1,35 @@
+#include "FastRandom.h"
+
+FastRandom::FastRandom(uint32_t seed) {
+  this->seed(seed);
+}
+
+void FastRandom::seed(uint32_t seed) {
+  // xorshift has a fixed point at zero
+  state = seed ? seed : 0x9E3779B9UL;
+}
+
+uint32_t FastRandom::next() {
+  uint32_t x = state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state = x;
+  return x;
+}
+
+// Unbiased value in [0, bound) using multiply-shift with rejection (Lemire).
+// The division only runs on the rare path where a rejection is possible.
+uint32_t FastRandom::below(uint32_t bound) {
+  if (bound == 0) return 0;
+  uint64_t m = (uint64_t)next() * bound;
+  uint32_t low = (uint32_t)m;
+  if (low < bound) {
+    uint32_t threshold = (uint32_t)(-bound) % bound;
+    while (low < threshold) {
+      m = (uint64_t)next() * bound;
+      low = (uint32_t)m;
+    }
+  }
+  return (uint32_t)(m >> 32);
+}
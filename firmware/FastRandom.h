@@ -0,0 +1,19 @@
+#ifndef FAST_RANDOM_H
+#define FAST_RANDOM_H
+
+#include <stdint.h>
+
+// Seedable xorshift32 generator. Replaces Arduino random(), which goes
+// through libc rand() and a biased modulo on every call.
+class FastRandom {
+public:
+  explicit FastRandom(uint32_t seed = 0x9E3779B9UL);
+  void seed(uint32_t seed);
+  uint32_t next();
+  uint32_t below(uint32_t bound);
+
+private:
+  uint32_t state;
+};
+
+#endif
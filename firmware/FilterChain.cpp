@@ -0,0 +1,46 @@
+#include "FilterChain.h"
+
+#define DC_BLOCKER_CUTOFF_HZ 10.0f
+#define WIDEBAND_CUTOFF_HZ 4000.0f
+#define BASS_CUTOFF_HZ 160.0f
+#define BUTTERWORTH_Q 0.7071f
+// Redesign only when the measured rate drifts by more than 1/32
+#define SAMPLE_RATE_TOLERANCE_SHIFT 5
+
+FilterChain::FilterChain() {
+  band = OFF;
+  sampleRateHz = 20000;
+  design();
+}
+
+void FilterChain::setBand(Band band) {
+  if (band == this->band) return;
+  this->band = band;
+  design();
+}
+
+void FilterChain::configure(uint32_t sampleRateHz) {
+  if (sampleRateHz == 0) return;
+  uint32_t diff = sampleRateHz > this->sampleRateHz ? sampleRateHz - this->sampleRateHz : this->sampleRateHz - sampleRateHz;
+  if (diff <= (this->sampleRateHz >> SAMPLE_RATE_TOLERANCE_SHIFT)) return;
+  this->sampleRateHz = sampleRateHz;
+  design();
+}
+
+void FilterChain::design() {
+  float fs = (float)sampleRateHz;
+  dcBlocker.designDcBlocker(fs, DC_BLOCKER_CUTOFF_HZ);
+  switch (band) {
+    case BASS:
+      lowPass.designLowPass(fs, BASS_CUTOFF_HZ, BUTTERWORTH_Q);
+      break;
+    case WIDEBAND:
+      // Leave headroom below Nyquist when the ADC loop runs slowly
+      lowPass.designLowPass(fs, WIDEBAND_CUTOFF_HZ < fs * 0.4f ? WIDEBAND_CUTOFF_HZ : fs * 0.4f, BUTTERWORTH_Q);
+      break;
+    case OFF:
+    default:
+      lowPass.setBypass();
+      break;
+  }
+}
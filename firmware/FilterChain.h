@@ -0,0 +1,47 @@
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdint.h>
+#include "Biquad.h"
+
+#define FILTER_ADC_MIDPOINT 2048
+#define FILTER_ADC_TO_Q15_SHIFT 4
+
+// Optional pre-filter for the 12-bit sample stream: removes the slowly
+// wandering MAX9814 bias and either band-limits against inverter noise or
+// keeps only the bass band. Output is re-centered on the ADC midpoint so
+// min/max tracking downstream is unchanged.
+class FilterChain {
+public:
+  enum Band {
+    OFF,
+    WIDEBAND,
+    BASS
+  };
+
+  FilterChain();
+
+  void setBand(Band band);
+  Band getBand() const { return band; }
+  void configure(uint32_t sampleRateHz);
+  uint32_t getSampleRate() const { return sampleRateHz; }
+
+  uint16_t process(uint16_t sample) {
+    if (band == OFF) return sample;
+    int32_t x = ((int32_t)sample - FILTER_ADC_MIDPOINT) << FILTER_ADC_TO_Q15_SHIFT;
+    int32_t y = lowPass.process(dcBlocker.process(x)) >> FILTER_ADC_TO_Q15_SHIFT;
+    y += FILTER_ADC_MIDPOINT;
+    if (y < 0) return 0;
+    if (y > 4095) return 4095;
+    return (uint16_t)y;
+  }
+
+private:
+  void design();
+  Band band;
+  uint32_t sampleRateHz;
+  Biquad dcBlocker;
+  Biquad lowPass;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include "FixedLog.h"
+
+namespace {
+  // round(log2(1 + i / 32) * 256)
+  const uint16_t mantissaLog[33] = {
+    0, 11, 22, 33, 44, 54, 63, 73, 82, 92, 100, 109, 118, 126, 134, 142,
+    150, 157, 165, 172, 179, 186, 193, 200, 207, 213, 220, 226, 232, 238, 244, 250,
+    256
+  };
+}
+
+// Integer part from the leading-zero count, fraction from the five bits
+// below the MSB, linearly interpolated with the eight bits after that.
+// log2Q8(0) is clamped to 0.
+uint16_t FixedLog::log2Q8(uint32_t x) {
+  if (x == 0) return 0;
+  uint8_t msb = 31 - __builtin_clz(x);
+  uint32_t normalized = x << (31 - msb);
+  uint8_t index = (normalized >> 26) & 0x1F;
+  uint16_t frac = (normalized >> 18) & 0xFF;
+  uint16_t base = mantissaLog[index];
+  uint16_t step = mantissaLog[index + 1] - base;
+  return (uint16_t)(msb * FIXED_LOG_ONE + base + ((step * frac) >> 8));
+}
@@ -0,0 +1,13 @@
+#ifndef FIXED_LOG_H
+#define FIXED_LOG_H
+
+#include <stdint.h>
+
+// log2 in Q8.8 fixed point: 256 per octave, i.e. ~6.02 dB per 256.
+#define FIXED_LOG_ONE 256
+
+namespace FixedLog {
+  uint16_t log2Q8(uint32_t x);
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include "FlightRecorder.h"
+#include <string.h>
+
+// Largest window record: header, three 5-byte varints, mask
+#define FLIGHT_MAX_WINDOW_RECORD 17
+
+FlightRecorder::FlightRecorder(uint16_t blockCount) {
+  this->blockCount = blockCount ? blockCount : 1;
+  storage = new uint8_t[(uint32_t)this->blockCount * FLIGHT_BLOCK_SIZE];
+  sequence = 0;
+  clear();
+}
+
+void FlightRecorder::clear() {
+  currentBlock = 0;
+  usedBlocks = 0;
+  offset = FLIGHT_BLOCK_SIZE;
+  lastMs = 0;
+  lastSignal = 0;
+  lastMask = 0;
+  dumpPosition = 0;
+  dumpRemaining = 0;
+}
+
+void FlightRecorder::recordWindow(uint32_t nowMs, uint16_t signal, uint8_t level, uint8_t mask, uint16_t loopMs) {
+  nowMs = notBefore(nowMs);
+  if (!reserve(nowMs, FLIGHT_MAX_WINDOW_RECORD)) return;
+  uint8_t* block = storage + (uint32_t)currentBlock * FLIGHT_BLOCK_SIZE;
+  bool maskChanged = mask != lastMask;
+  block[offset++] = (uint8_t)((maskChanged ? 0x20 : 0x00) | (level & 0x0F));
+  putVarint(nowMs - lastMs);
+  int32_t delta = (int32_t)signal - (int32_t)lastSignal;
+  putVarint((uint32_t)((delta << 1) ^ (delta >> 31)));
+  putVarint(loopMs);
+  if (maskChanged) {
+    block[offset++] = mask;
+  }
+  lastMs = nowMs;
+  lastSignal = signal;
+  lastMask = mask;
+}
+
+void FlightRecorder::recordCommand(uint32_t nowMs, const char* text, uint8_t length) {
+  if (length > FLIGHT_MAX_COMMAND) length = FLIGHT_MAX_COMMAND;
+  nowMs = notBefore(nowMs);
+  if (!reserve(nowMs, 1 + 5 + length)) return;
+  uint8_t* block = storage + (uint32_t)currentBlock * FLIGHT_BLOCK_SIZE;
+  block[offset++] = (uint8_t)(0x40 | length);
+  putVarint(nowMs - lastMs);
+  memcpy(block + offset, text, length);
+  offset += length;
+  lastMs = nowMs;
+}
+
+// Deltas are unsigned, so a stamp older than the last record (a caller
+// mixing clocks) is recorded at the last time instead of wrapping
+uint32_t FlightRecorder::notBefore(uint32_t nowMs) const {
+  return (int32_t)(nowMs - lastMs) < 0 ? lastMs : nowMs;
+}
+
+// Makes room for a record of up to `length` bytes, starting a new block
+// (and dropping the oldest one) when the current block is full.
+bool FlightRecorder::reserve(uint32_t nowMs, uint8_t length) {
+  if (isDumping()) return false; // keep the dump consistent
+  if (offset + length < FLIGHT_BLOCK_SIZE) return true;
+  // Blocks are pre-filled with FLIGHT_RECORD_END, so the tail needs no padding
+  openBlock(nowMs);
+  return true;
+}
+
+void FlightRecorder::openBlock(uint32_t nowMs) {
+  if (usedBlocks > 0) {
+    currentBlock = (currentBlock + 1) % blockCount;
+  }
+  if (usedBlocks < blockCount) usedBlocks++;
+  uint8_t* block = storage + (uint32_t)currentBlock * FLIGHT_BLOCK_SIZE;
+  memset(block, FLIGHT_RECORD_END, FLIGHT_BLOCK_SIZE);
+  if (usedBlocks == 1 && lastMs == 0) lastMs = nowMs;
+  block[0] = FLIGHT_BLOCK_MAGIC;
+  memcpy(block + 1, &sequence, 4);
+  memcpy(block + 5, &lastMs, 4);
+  memcpy(block + 9, &lastSignal, 2);
+  block[11] = lastMask;
+  sequence++;
+  offset = FLIGHT_HEADER_SIZE;
+}
+
+void FlightRecorder::putVarint(uint32_t value) {
+  uint8_t* block = storage + (uint32_t)currentBlock * FLIGHT_BLOCK_SIZE;
+  while (value >= 0x80) {
+    block[offset++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  block[offset++] = (uint8_t)value;
+}
+
+// Blocks are dumped oldest first; recording pauses until the dump is read.
+void FlightRecorder::beginDump() {
+  if (usedBlocks == 0) return;
+  uint16_t oldest = (usedBlocks < blockCount) ? 0 : (currentBlock + 1) % blockCount;
+  dumpPosition = (uint32_t)oldest * FLIGHT_BLOCK_SIZE;
+  dumpRemaining = (uint32_t)usedBlocks * FLIGHT_BLOCK_SIZE;
+}
+
+uint16_t FlightRecorder::readDump(uint8_t* out, uint16_t maxLength) {
+  uint32_t total = (uint32_t)blockCount * FLIGHT_BLOCK_SIZE;
+  uint16_t n = 0;
+  while (n < maxLength && dumpRemaining > 0) {
+    out[n++] = storage[dumpPosition];
+    dumpPosition = (dumpPosition + 1) % total;
+    dumpRemaining--;
+  }
+  return n;
+}
@@ -0,0 +1,53 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+
+#define FLIGHT_BLOCK_SIZE 256
+#define FLIGHT_BLOCK_MAGIC 0xA5
+#define FLIGHT_HEADER_SIZE 12
+#define FLIGHT_RECORD_END 0xFF
+#define FLIGHT_MAX_COMMAND 63
+
+// RAM ring of per-window signal, level, wire mask and loop time plus
+// received commands. Storage is split into fixed blocks; each block opens
+// with an absolute keyframe and then holds delta-encoded records, so the
+// oldest block can be dropped on wrap without breaking decoding.
+//
+// Block: magic, sequence (u32), time ms (u32), signal (u16), mask (u8),
+// then records until FLIGHT_RECORD_END:
+//   window:  0b00m0llll, varint dt ms, zigzag varint signal delta,
+//            varint loop ms, [mask if m]
+//   command: 0b01nnnnnn, varint dt ms, n bytes of text
+// All multi-byte fields are little endian.
+class FlightRecorder {
+public:
+  explicit FlightRecorder(uint16_t blockCount);
+
+  void clear();
+  void recordWindow(uint32_t nowMs, uint16_t signal, uint8_t level, uint8_t mask, uint16_t loopMs);
+  void recordCommand(uint32_t nowMs, const char* text, uint8_t length);
+
+  void beginDump();
+  bool isDumping() const { return dumpRemaining > 0; }
+  uint16_t readDump(uint8_t* out, uint16_t maxLength);
+
+private:
+  uint32_t notBefore(uint32_t nowMs) const;
+  bool reserve(uint32_t nowMs, uint8_t length);
+  void openBlock(uint32_t nowMs);
+  void putVarint(uint32_t value);
+  uint8_t* storage;
+  uint16_t blockCount;
+  uint16_t currentBlock;
+  uint16_t usedBlocks;
+  uint16_t offset;
+  uint32_t sequence;
+  uint32_t lastMs;
+  uint16_t lastSignal;
+  uint8_t lastMask;
+  uint32_t dumpPosition;
+  uint32_t dumpRemaining;
+};
+
+#endif
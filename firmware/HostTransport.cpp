@@ -0,0 +1,97 @@
+#ifndef ARDUINO
+
+#include "HostTransport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+HostTransport::HostTransport(uint16_t port) {
+  this->port = port;
+  this->listener = -1;
+  this->client = -1;
+  this->rxLength = 0;
+  this->rxPosition = 0;
+}
+
+HostTransport::~HostTransport() {
+  drop();
+  if (listener >= 0) close(listener);
+}
+
+void HostTransport::begin(const char* deviceName) {
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 1) < 0) {
+    perror("HostTransport");
+    close(listener);
+    listener = -1;
+    return;
+  }
+  fcntl(listener, F_SETFL, O_NONBLOCK);
+  fprintf(stderr, "%s listening on localhost:%u\n", deviceName, port);
+}
+
+// Accepts a waiting client and refills the receive buffer, never blocking
+void HostTransport::poll() {
+  if (client < 0 && listener >= 0) {
+    client = accept(listener, nullptr, nullptr);
+    if (client >= 0) {
+      int yes = 1;
+      fcntl(client, F_SETFL, O_NONBLOCK);
+      setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    }
+  }
+  if (client >= 0 && rxPosition == rxLength) {
+    ssize_t n = recv(client, rxBuffer, sizeof(rxBuffer), 0);
+    if (n > 0) {
+      rxLength = n;
+      rxPosition = 0;
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      drop();
+    }
+  }
+}
+
+void HostTransport::drop() {
+  if (client >= 0) close(client);
+  client = -1;
+  rxLength = 0;
+  rxPosition = 0;
+}
+
+int HostTransport::available() {
+  poll();
+  return rxLength - rxPosition;
+}
+
+int HostTransport::read() {
+  if (rxPosition == rxLength) return -1;
+  return rxBuffer[rxPosition++];
+}
+
+size_t HostTransport::write(const uint8_t* data, size_t length) {
+  if (client < 0) return 0;
+  ssize_t n = send(client, data, length, MSG_NOSIGNAL);
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) drop();
+    return 0;
+  }
+  return n;
+}
+
+bool HostTransport::isConnected() {
+  poll();
+  return client >= 0;
+}
+
+#endif
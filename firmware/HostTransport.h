@@ -0,0 +1,36 @@
+#ifndef HOST_TRANSPORT_H
+#define HOST_TRANSPORT_H
+
+// Host stand-in for the Bluetooth link: a TCP server on localhost that
+// accepts one client at a time (e.g. `nc localhost 8023`). Only built off
+// target; the sketch never includes it.
+#ifndef ARDUINO
+
+#include "Transport.h"
+
+#define HOST_TRANSPORT_PORT 8023
+
+class HostTransport : public Transport {
+public:
+  explicit HostTransport(uint16_t port = HOST_TRANSPORT_PORT);
+  ~HostTransport();
+  void begin(const char* deviceName) override;
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  bool isConnected() override;
+
+private:
+  uint16_t port;
+  int listener;
+  int client;
+  uint8_t rxBuffer[256];
+  size_t rxLength;
+  size_t rxPosition;
+  void poll();
+  void drop();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef KWL_PANEL_H
+#define KWL_PANEL_H
+
+#include <stdint.h>
+
+// Generated by generate-kwl-panel from app/Bluetooth_Electronics_Panels.kwl.
+// Do not edit; change the panel in the app, export it and regenerate.
+constexpr char KWL_PANEL[] = R"KWL(clear_panel()
+select_panel(2)
+set_grid_size(23,12)
+add_text(0,0,large,L,Sampling:,245,240,245,)
+add_button(5,0,21,"S\n    ",)
+add_button(7,0,22,"s\n    ",)
+add_button(9,0,23,"K\n    ",)
+add_text(11,0,large,L,P2P,245,240,245,P)
+add_text(0,2,large,L,Curve:,245,240,245,)
+add_button(5,2,21,"C1\n    ",)
+add_button(7,2,22,"C2\n    ",)
+add_button(9,2,23,"C3\n    ",)
+add_text(11,2,large,L,LIN,245,240,245,C)
+add_text(0,4,large,L,Band:,245,240,245,)
+add_button(5,4,20,"B0\n    ",)
+add_button(7,4,21,"B1\n    ",)
+add_button(9,4,22,"B2\n    ",)
+add_text(11,4,large,L,OFF,245,240,245,B)
+add_text(0,6,large,L,Mics:,245,240,245,)
+add_button(5,6,21,"X1\n    ",)
+add_button(7,6,22,"X2\n    ",)
+add_button(9,6,23,"X3\n    ",)
+add_text(11,6,large,L,MAX,245,240,245,X)
+add_text(0,8,large,L,Tempo:,245,240,245,)
+add_button(5,8,1,"Y\n    ",)
+add_button(7,8,2,"y\n    ",)
+add_text(11,8,large,L,-,245,240,245,Y)
+add_text(0,10,large,L,Send rate:,245,240,245,)
+add_slider(5,10,8,0,32000,8000,T,"\n    ",1)
+add_text(14,10,large,L,8000,245,240,245,T)
+add_text(15,0,large,L,AGC,245,240,245,)
+add_switch(18,0,3,"A\n    ","a\n    ",0,0)
+add_text(21,0,large,L,MAN,245,240,245,A)
+add_text(15,2,large,L,ADC,245,240,245,)
+add_switch(18,2,3,"F\n    ","f\n    ",0,0)
+add_text(21,2,large,L,RAW,245,240,245,F)
+add_text(15,4,large,L,Graph,245,240,245,)
+add_switch(18,4,1,"D\n    ","d\n    ",0,0)
+add_text(21,4,large,L,OFF,245,240,245,D)
+add_text(15,6,large,L,Capture,245,240,245,)
+add_switch(18,6,1,"W\n    ","w\n    ",0,0)
+add_text(15,8,large,L,Recorder,245,240,245,)
+add_button(19,8,3,"R\n    ",)
+add_button(21,8,4,"r\n    ",)
+add_text(15,10,large,L,Stats,245,240,245,)
+add_button(18,10,5,"t\n    ",)
+add_button(20,10,6,"v\n    ",)
+add_button(22,10,7,"U\n    ",)
+add_text(15,11,medium,L,-,245,240,245,t)
+set_panel_notes(-,,,)
+select_panel(1)
+set_grid_size(22,11)
+add_text(1,3,xlarge,R,1161,245,240,245,L)
+add_text(10,1,xlarge,L,High,245,240,245,)
+add_text(10,3,xlarge,L,Low,245,240,245,)
+add_text(1,5,xlarge,L,Gain:,245,240,245,)
+add_text(3,5,xlarge,R,1,245,240,245,N)
+add_text(1,7,xlarge,L,Mode:,245,240,245,)
+add_text(1,9,xlarge,L,Setting:,245,240,245,)
+add_text(1,1,xlarge,R,2519,245,240,245,H)
+add_text(16,6,xlarge,L,Graph,245,240,245,)
+add_text(4,9,xlarge,L,3,245,240,245,S)
+add_text(14,8,xlarge,L,RMS,245,240,245,P)
+add_text(4,7,xlarge,L,R1,245,240,245,M)
+add_button(5,5,21,"N1\n    ",)
+add_button(7,5,22,"N2\n    ",)
+add_button(9,5,23,N3,)
+add_switch(12,7,3,"S\n    ","s\n    ",0,0)
+add_switch(19,6,1,"D\n    ","d\n    ",0,0)
+add_slider(2,3,8,0,2000,1161,L,"\n    ",1)
+add_slider(2,1,8,200,4000,2519,H,"\n    ",1)
+add_4way_pad(6,7,"1\n","2\n","3\n","4\n",,0,,)
+add_roll_graph(12,0,10,787.0,2519.0,100,G,Microphone Levels,Time,Value,1,0,1,0,1,1,thin,none,3,1,42,97,222,2,237,115,7,3,51,215,155)
+add_monitor(16,7,6,,1)
+set_panel_notes(-,,,)
+run())KWL";
+
+// FNV-1a of the panel text, so the firmware can tell whether the phone
+// already has this version
+constexpr uint32_t kwlPanelHash(const char* text) {
+  uint32_t hash = 2166136261UL;
+  while (*text) {
+    hash = (hash ^ (uint8_t)*text++) * 16777619UL;
+  }
+  return hash;
+}
+
+constexpr uint32_t KWL_PANEL_HASH = kwlPanelHash(KWL_PANEL);
+
+#endif
@@ -0,0 +1,94 @@
+#include "LevelQuantizer.h"
+#include "FixedLog.h"
+#include <math.h>
+
+// Loudness grows roughly with amplitude^0.6 (Stevens' power law)
+#define PERCEPTUAL_EXPONENT 0.6f
+
+LevelQuantizer::LevelQuantizer(uint8_t levels, uint8_t hysteresisPercent) {
+  this->levels = levels > LEVEL_QUANTIZER_MAX_LEVELS ? LEVEL_QUANTIZER_MAX_LEVELS : levels;
+  this->hysteresisPercent = hysteresisPercent > 50 ? 50 : hysteresisPercent;
+  this->low = 0;
+  this->high = 1;
+  this->curve = LINEAR;
+  this->level = 0;
+  rebuild();
+}
+
+void LevelQuantizer::setRange(uint16_t low, uint16_t high) {
+  if (high <= low) high = low + 1;
+  if (low == this->low && high == this->high) return;
+  this->low = low;
+  this->high = high;
+  rebuild();
+}
+
+void LevelQuantizer::setCurve(Curve curve) {
+  if (curve == this->curve) return;
+  this->curve = curve;
+  rebuild();
+}
+
+void LevelQuantizer::setHysteresis(uint8_t percent) {
+  hysteresisPercent = percent > 50 ? 50 : percent;
+  rebuild();
+}
+
+uint16_t LevelQuantizer::toDomain(uint16_t signal) const {
+  return curve == DECIBEL ? FixedLog::log2Q8(signal) : signal;
+}
+
+void LevelQuantizer::rebuild() {
+  uint16_t domainLow = toDomain(low);
+  uint16_t domainHigh = toDomain(high);
+  if (domainHigh <= domainLow) domainHigh = domainLow + 1;
+  uint32_t span = domainHigh - domainLow;
+  riseThreshold[0] = domainLow;
+  for (uint8_t l = 1; l <= levels; l++) {
+    uint32_t offset;
+    switch (curve) {
+      case PERCEPTUAL:
+        offset = (uint32_t)ceilf(span * powf((float)l / levels, 1.0f / PERCEPTUAL_EXPONENT));
+        break;
+      case DECIBEL:
+      case LINEAR:
+      default:
+        // Same steps as map(), which truncates: the smallest offset that
+        // reaches level l is ceil(l * span / levels)
+        offset = (l * span + levels - 1) / levels;
+        break;
+    }
+    riseThreshold[l] = (uint16_t)(domainLow + offset);
+  }
+
+  fallThreshold[0] = 0;
+  for (uint8_t l = 1; l <= levels; l++) {
+    uint16_t band = (uint16_t)((uint32_t)(riseThreshold[l] - riseThreshold[l - 1]) * hysteresisPercent / 100);
+    fallThreshold[l] = riseThreshold[l] - band;
+  }
+}
+
+uint8_t LevelQuantizer::quantize(uint16_t signal) {
+  signal = toDomain(signal);
+  uint8_t l = level;
+  while (l < levels && signal >= riseThreshold[l + 1]) {
+    l++;
+  }
+  if (l == level) {
+    while (l > 0 && signal < fallThreshold[l]) {
+      l--;
+    }
+  }
+  level = l;
+  return level;
+}
+
+// Stateless lookup on the same steps, without hysteresis
+uint8_t LevelQuantizer::levelFor(uint16_t signal) const {
+  signal = toDomain(signal);
+  uint8_t l = 0;
+  while (l < levels && signal >= riseThreshold[l + 1]) {
+    l++;
+  }
+  return l;
+}
@@ -0,0 +1,46 @@
+#ifndef LEVEL_QUANTIZER_H
+#define LEVEL_QUANTIZER_H
+
+#include <stdint.h>
+
+#define LEVEL_QUANTIZER_MAX_LEVELS 16
+
+// Maps a loudness signal onto 0..levels wires. Step thresholds are
+// precomputed whenever the range or curve changes, so quantize() is a few
+// comparisons. A level is only left downwards once the signal drops a
+// fraction of the step width below its threshold, which keeps a signal
+// hovering at a step boundary from toggling the wires every window.
+// The DECIBEL curve compares a fixed-point log2 of the signal against
+// thresholds spaced evenly in the log domain.
+class LevelQuantizer {
+public:
+  enum Curve {
+    LINEAR,
+    PERCEPTUAL,
+    DECIBEL
+  };
+
+  LevelQuantizer(uint8_t levels, uint8_t hysteresisPercent);
+
+  void setRange(uint16_t low, uint16_t high);
+  void setCurve(Curve curve);
+  void setHysteresis(uint8_t percent);
+  Curve getCurve() const { return curve; }
+  uint8_t quantize(uint16_t signal);
+  uint8_t levelFor(uint16_t signal) const;
+  uint8_t getLevel() const { return level; }
+
+private:
+  void rebuild();
+  uint16_t toDomain(uint16_t signal) const;
+  uint8_t levels;
+  uint8_t hysteresisPercent;
+  uint16_t low;
+  uint16_t high;
+  Curve curve;
+  uint8_t level;
+  uint16_t riseThreshold[LEVEL_QUANTIZER_MAX_LEVELS + 1];
+  uint16_t fallThreshold[LEVEL_QUANTIZER_MAX_LEVELS + 1];
+};
+
+#endif
@@ -6,32 +6,68 @@
 LoudnessMeter::LoudnessMeter(
   uint8_t micOut, uint8_t micGain, uint8_t micSampleWindowMillis,
   uint16_t defaultPeakToPeakLow, uint16_t defaultPeakToPeakHigh,
-  uint16_t defaultRmsLow, uint16_t defaultRmsHigh) {
+  uint16_t defaultRmsLow, uint16_t defaultRmsHigh)
+  : loudness(micSampleWindowMillis) {
 
-  this->micOut = micOut;
+  this->micOut[0] = micOut;
+  this->inputCount = 1;
+  this->combiner = COMBINE_MAX;
   this->micGain = micGain;
   this->micSampleWindowMicros = (uint32_t)micSampleWindowMillis * 1000UL;
   this->peakToPeakLow = defaultPeakToPeakLow;
   this->peakToPeakHigh = defaultPeakToPeakHigh;
   this->rmsLow = defaultRmsLow;
   this->rmsHigh = defaultRmsHigh;
+  // Loudness is reported on the peak-to-peak scale
+  this->loudnessLow = defaultPeakToPeakLow;
+  this->loudnessHigh = defaultPeakToPeakHigh;
+
+  this->gainStepNumerator = 1;
+  this->gainStepDenominator = 1;
 
   this->mode = PEAK_TO_PEAK;
   this->gain = HIGH_GAIN;
+  this->frontEndEnabled = false;
+  this->channelRms = false;
+  this->clipCount = 0;
+  this->sampleCount = 0;
+  this->windowSamples = 0;
+  this->sampleRate = 0;
+  this->captureBuffer = nullptr;
+  this->captureCapacity = 0;
+  this->captureLength = 0;
+
+  for (uint8_t i = 0; i < MAX_MIC_INPUTS; i++) {
+    channels[i].window.reset();
+    channels[i].envelope.setDoubleWindow(true);
+    channels[i].signal = 0;
+  }
+}
 
-  this->prevFullMin = 512;
-  this->prevFullMax = 512;
+// Up to MAX_MIC_INPUTS pins, captured interleaved in one scan per sample
+// period. Call before begin().
+void LoudnessMeter::setInputs(const uint8_t pins[], uint8_t count) {
+  if (count == 0) return;
+  if (count > MAX_MIC_INPUTS) count = MAX_MIC_INPUTS;
+  for (uint8_t i = 0; i < count; i++) {
+    micOut[i] = pins[i];
+  }
+  inputCount = count;
 }
 
 void LoudnessMeter::begin() {
-  pinMode(micOut, INPUT);
+  for (uint8_t i = 0; i < inputCount; i++) {
+    pinMode(micOut[i], INPUT);
+  }
   setGain(gain);
+  AdcFrontEnd::calibrate();
 #if DEBUG
   Serial.begin(DEBUG_BAUD_RATE);
 #endif
 }
 
 void LoudnessMeter::readAudioSample() {
+  captureWindow();
   switch (mode) {
     case PEAK_TO_PEAK:
       samplePeakToPeak();
@@ -39,83 +75,199 @@ void LoudnessMeter::readAudioSample() {
     case RMS:
       sampleEnvelope();
       break;
+    case LOUDNESS:
+      sampleLoudness();
+      break;
   }
 }
 
-void LoudnessMeter::samplePeakToPeak() {
-  uint16_t currentMin = MAX_SIGNAL;
-  uint16_t currentMax = 0;
+// Single pass over the window: every input is read once per iteration
+// and its min, max and sum (sum of squares only on request) are updated
+// in place.
+void LoudnessMeter::captureWindow() {
+  for (uint8_t i = 0; i < inputCount; i++) {
+    channels[i].window.reset();
+    frontEnd[i].reset();
+  }
   uint16_t numSamples = 0;
   const uint32_t start = micros();
+  clipCount = 0;
+  captureLength = 0;
 
   while (micros() - start < micSampleWindowMicros) {
-    uint16_t currentSample = analogRead(micOut);
-    currentMin = min(currentMin, currentSample);
-    currentMax = max(currentMax, currentSample);
+    uint32_t mixed = 0;
+    for (uint8_t i = 0; i < inputCount; i++) {
+      uint16_t s = nextSample(i);
+      if (channelRms) {
+        channels[i].window.addSquared(s);
+      } else {
+        channels[i].window.add(s);
+      }
+      mixed += s;
+    }
+    if (mode == LOUDNESS) {
+      if (inputCount > 1) mixed /= inputCount;
+      loudness.push((int32_t)mixed - FILTER_ADC_MIDPOINT);
+    }
     numSamples++;
   }
 
-  signal = currentMax - currentMin;
+  finishWindow(numSamples);
+}
+
+void LoudnessMeter::samplePeakToPeak() {
+  for (uint8_t i = 0; i < inputCount; i++) {
+    channels[i].signal = channels[i].window.peakToPeak();
+  }
+  signal = combine();
 
 #if DEBUG
-  Serial.println(numSamples);
+  Serial.println(windowSamples);
 #endif
 }
 
 void LoudnessMeter::sampleEnvelope() {
-  uint16_t currentMin = MAX_SIGNAL;
-  uint16_t currentMax = 0;
+  for (uint8_t i = 0; i < inputCount; i++) {
+    Channel& c = channels[i];
+    c.signal = c.envelope.feed(c.window.min, c.window.max);
+  }
+  signal = combine();
 
-  uint32_t start = micros();
+#if DEBUG
+  Serial.print(channels[0].window.peakToPeak()); Serial.print(",");
+  Serial.println(signal);
+#endif
+}
 
-  while (micros() - start < micSampleWindowMicros) {
-    uint16_t s = analogRead(micOut);
+void LoudnessMeter::sampleLoudness() {
+  for (uint8_t i = 0; i < inputCount; i++) {
+    channels[i].signal = channels[i].window.peakToPeak();
+  }
+  loudness.endHop(windowSamples);
+  signal = min(loudness.value(), (uint16_t)MAX_SIGNAL);
+}
 
-    if (s < currentMin) currentMin = s;
-    if (s > currentMax) currentMax = s;
+// Spatial drive reads the channels individually; the combined signal
+// then follows the loudest input so single-level modes keep working.
+uint16_t LoudnessMeter::combine() {
+  if (inputCount == 1) return channels[0].signal;
+  uint32_t total = 0;
+  uint16_t loudest = 0;
+  for (uint8_t i = 0; i < inputCount; i++) {
+    total += channels[i].signal;
+    if (channels[i].signal > loudest) loudest = channels[i].signal;
+  }
+  switch (combiner) {
+    case COMBINE_MEAN:
+      return (uint16_t)(total / inputCount);
+    case COMBINE_MAX:
+    case COMBINE_SPATIAL:
+    default:
+      return loudest;
   }
+}
 
-  uint16_t currentAmp = currentMax - currentMin;
+inline uint16_t LoudnessMeter::nextSample(uint8_t input) {
+  // Clips are counted on the raw reads, before averaging can hide them
+  uint16_t sample;
+  if (frontEndEnabled) {
+    uint16_t raw;
+    do {
+      raw = analogRead(micOut[input]);
+      countClip(raw);
+    } while (!frontEnd[input].push(raw));
+    sample = frontEnd[input].value();
+  } else {
+    sample = analogRead(micOut[input]);
+    countClip(sample);
+  }
+  if (input == 0 && captureLength < captureCapacity) {
+    captureBuffer[captureLength++] = sample;
+  }
+  return filter[input].process(sample);
+}
 
-  uint16_t lowMin = (prevFullMin < currentMin) ? prevFullMin : currentMin;
-  uint16_t lowMax = (prevFullMax > currentMax) ? prevFullMax : currentMax;
-  uint16_t lowAmp = lowMax - lowMin;
+// Keeps the pre-filters designed for the per-input sample rate actually
+// achieved
+void LoudnessMeter::finishWindow(uint16_t numSamples) {
+  windowSamples = numSamples;
+  sampleCount = numSamples * inputCount;
+  if (frontEndEnabled) {
+    // The median's priming reads were clip-checked too
+    sampleCount = (sampleCount + ADC_FRONT_END_PRIMING_OUTPUTS * inputCount) << ADC_FRONT_END_OVERSAMPLE_SHIFT;
+  }
+  sampleRate = (uint16_t)((uint32_t)numSamples * 1000000UL / micSampleWindowMicros);
+  for (uint8_t i = 0; i < inputCount; i++) {
+    filter[i].configure(sampleRate);
+  }
+  if (mode == LOUDNESS) {
+    loudness.configure(sampleRate);
+  }
+}
 
-  prevFullMin = currentMin;
-  prevFullMax = currentMax;
+inline void LoudnessMeter::countClip(uint16_t sample) {
+  if (sample <= CLIP_MARGIN || sample >= MAX_SIGNAL - CLIP_MARGIN) {
+    clipCount++;
+  }
+}
 
-  signal = (uint16_t)lowAmp;
+// Thresholds are given and read at the current gain
+void LoudnessMeter::setLow(uint16_t low) {
+  lowThreshold() = fromGain(low, gain);
+}
 
-#if DEBUG
-  Serial.print(lowAmp); Serial.print(",");
-  Serial.print(currentAmp); Serial.print(",");
-  Serial.println(signal);
-#endif
+void LoudnessMeter::setHigh(uint16_t high) {
+  highThreshold() = fromGain(high, gain);
 }
 
-void LoudnessMeter::setLow(uint16_t low) {
+uint32_t& LoudnessMeter::lowThreshold() {
   switch (mode) {
-    case PEAK_TO_PEAK:
-      peakToPeakLow = low;
-      break;
     case RMS:
-      rmsLow = low;
-      break;
+      return rmsLow;
+    case LOUDNESS:
+      return loudnessLow;
+    case PEAK_TO_PEAK:
+    default:
+      return peakToPeakLow;
   }
 }
 
-void LoudnessMeter::setHigh(uint16_t high) {
+uint32_t& LoudnessMeter::highThreshold() {
   switch (mode) {
-    case PEAK_TO_PEAK:
-      peakToPeakHigh = high;
-      break;
     case RMS:
-      rmsHigh = high;
-      break;
+      return rmsHigh;
+    case LOUDNESS:
+      return loudnessHigh;
+    case PEAK_TO_PEAK:
+    default:
+      return peakToPeakHigh;
+  }
+}
+
+// Each step down from HIGH_GAIN divides the signal by the gain step
+uint16_t LoudnessMeter::atGain(uint32_t threshold, Gain gain) {
+  uint64_t scaled = threshold;
+  uint64_t divisor = 1;
+  for (uint8_t i = HIGH_GAIN; i < gain; i++) {
+    scaled *= gainStepDenominator;
+    divisor *= gainStepNumerator;
+  }
+  scaled = (scaled + divisor / 2) / divisor;
+  return (uint16_t)(scaled < MAX_SIGNAL ? scaled : MAX_SIGNAL);
+}
+
+uint32_t LoudnessMeter::fromGain(uint16_t value, Gain gain) {
+  uint64_t scaled = value;
+  uint64_t divisor = 1;
+  for (uint8_t i = HIGH_GAIN; i < gain; i++) {
+    scaled *= gainStepNumerator;
+    divisor *= gainStepDenominator;
   }
+  return (uint32_t)((scaled + divisor / 2) / divisor);
 }
 
 void LoudnessMeter::setGain(Gain gain) {
+  this->gain = gain;
   switch (gain) {
     case HIGH_GAIN:
       pinMode(micGain, INPUT);
@@ -131,29 +283,135 @@ void LoudnessMeter::setGain(Gain gain) {
   }
 }
 
+// Signal ratio between adjacent gains. With it set, the thresholds of
+// all sampling modes follow every gain change (AGC or manual), so the
+// mapped output stays continuous.
+void LoudnessMeter::setGainStep(uint16_t numerator, uint16_t denominator) {
+  gainStepNumerator = numerator ? numerator : 1;
+  gainStepDenominator = denominator ? denominator : 1;
+}
+
+// Whether every sampling mode's high threshold stays below MAX_SIGNAL at
+// the gain, i.e. switching to it keeps the level mapping intact
+bool LoudnessMeter::thresholdsFit(Gain gain) {
+  uint32_t highs[] = { peakToPeakHigh, rmsHigh, loudnessHigh };
+  for (uint32_t high : highs) {
+    if (atGain(high, gain) >= MAX_SIGNAL) return false;
+  }
+  return true;
+}
+
 uint16_t LoudnessMeter::getSignal() {
   return signal;
 }
 
+// Kept below the high threshold even where both clamp
 uint16_t LoudnessMeter::getLow() {
-  switch (mode) {
-    case PEAK_TO_PEAK:
-      return peakToPeakLow;
-    case RMS:
-      return rmsLow;
-  }
+  uint16_t low = atGain(lowThreshold(), gain);
+  uint16_t high = getHigh();
+  return low < high ? low : high - 1;
 }
 
 uint16_t LoudnessMeter::getHigh() {
-  switch (mode) {
-    case PEAK_TO_PEAK:
-      return peakToPeakHigh;
-    case RMS:
+  uint16_t high = atGain(highThreshold(), gain);
+  return high > 0 ? high : 1;
+}
 
-      return rmsHigh;
-  }
+LoudnessMeter::Gain LoudnessMeter::getGain() {
+  return gain;
+}
+
+uint16_t LoudnessMeter::getClipCount() {
+  return clipCount;
+}
+
+uint16_t LoudnessMeter::getSampleCount() {
+  return sampleCount;
 }
 
 void LoudnessMeter::setMode(Mode mode) {
+  if (mode == LOUDNESS && this->mode != LOUDNESS) {
+    loudness.reset();
+  }
+  if (mode == RMS && this->mode != RMS) {
+    for (uint8_t i = 0; i < MAX_MIC_INPUTS; i++) {
+      channels[i].envelope.reset();
+    }
+  }
   this->mode = mode;
 }
+
+LoudnessMeter::Mode LoudnessMeter::getMode() {
+  return mode;
+}
+
+void LoudnessMeter::setFrontEnd(bool enabled) {
+  frontEndEnabled = enabled;
+  for (uint8_t i = 0; i < MAX_MIC_INPUTS; i++) {
+    frontEnd[i].reset();
+  }
+}
+
+bool LoudnessMeter::isFrontEndEnabled() {
+  return frontEndEnabled;
+}
+
+void LoudnessMeter::setFilterBand(FilterChain::Band band) {
+  for (uint8_t i = 0; i < MAX_MIC_INPUTS; i++) {
+    filter[i].setBand(band);
+  }
+}
+
+FilterChain::Band LoudnessMeter::getFilterBand() {
+  return filter[0].getBand();
+}
+
+void LoudnessMeter::setCombiner(Combiner combiner) {
+  this->combiner = combiner;
+}
+
+LoudnessMeter::Combiner LoudnessMeter::getCombiner() {
+  return combiner;
+}
+
+uint8_t LoudnessMeter::getInputCount() {
+  return inputCount;
+}
+
+uint16_t LoudnessMeter::getSampleRate() {
+  return sampleRate;
+}
+
+// While a buffer is set, every window's first-input samples (after the
+// front-end, before the pre-filter) are copied into it, up to capacity.
+void LoudnessMeter::startCapture(uint16_t* buffer, uint16_t capacity) {
+  captureBuffer = buffer;
+  captureCapacity = buffer ? capacity : 0;
+  captureLength = 0;
+}
+
+void LoudnessMeter::stopCapture() {
+  startCapture(nullptr, 0);
+}
+
+uint16_t LoudnessMeter::getCaptureLength() {
+  return captureLength;
+}
+
+uint16_t LoudnessMeter::getChannelSignal(uint8_t input) {
+  if (input >= inputCount) return 0;
+  return channels[input].signal;
+}
+
+// Per-input deviation costs a 64-bit multiply-add per sample, so the
+// windows only accumulate squares while it is enabled
+void LoudnessMeter::setChannelRms(bool enabled) {
+  channelRms = enabled;
+}
+
+// Standard deviation of the input's last window in ADC counts, 0 unless
+// setChannelRms(true) was called before it
+uint16_t LoudnessMeter::getChannelRms(uint8_t input) {
+  if (input >= inputCount) return 0;
+  return channels[input].window.deviation();
+}
@@ -2,14 +2,27 @@
 #define LOUDNESSMETER_H
 
 #define MAX_SIGNAL 4095
+#define CLIP_MARGIN 16
+#define MAX_MIC_INPUTS 4
 
 #include "Arduino.h"
+#include "AdcFrontEnd.h"
+#include "FilterChain.h"
+#include "ShortTermLoudness.h"
+#include "WindowStats.h"
+#include "PeakToPeakSampler.h"
 
 class LoudnessMeter {
 public:
   enum Mode {
     RMS,
-    PEAK_TO_PEAK
+    PEAK_TO_PEAK,
+    LOUDNESS
+  };
+  enum Combiner {
+    COMBINE_MAX,
+    COMBINE_MEAN,
+    COMBINE_SPATIAL
   };
   enum Gain {
     HIGH_GAIN,
@@ -23,32 +36,87 @@ public:
     uint16_t defaultRmsLow, uint16_t defaultRmsHigh
   );
 
+  void setInputs(const uint8_t pins[], uint8_t count);
   void begin();
   void readAudioSample();
   void setLow(uint16_t low);
   void setHigh(uint16_t high);
   void setGain(Gain gain);
   void setMode(Mode mode);
+  Mode getMode();
+  void setFrontEnd(bool enabled);
+  bool isFrontEndEnabled();
+  void setFilterBand(FilterChain::Band band);
+  FilterChain::Band getFilterBand();
+  void setCombiner(Combiner combiner);
+  Combiner getCombiner();
+  void setGainStep(uint16_t numerator, uint16_t denominator);
+  bool thresholdsFit(Gain gain);
   uint16_t getSignal();
   uint16_t getLow();
   uint16_t getHigh();
+  Gain getGain();
+  uint16_t getClipCount();
+  uint16_t getSampleCount();
+  uint8_t getInputCount();
+  uint16_t getSampleRate();
+  void startCapture(uint16_t* buffer, uint16_t capacity);
+  void stopCapture();
+  uint16_t getCaptureLength();
+  uint16_t getChannelSignal(uint8_t input);
+  void setChannelRms(bool enabled);
+  uint16_t getChannelRms(uint8_t input);
 
 private:
+  struct Channel {
+    WindowStats window;
+    PeakToPeakSampler envelope;
+    uint16_t signal;
+  };
+
+  void captureWindow();
+  uint16_t combine();
   void samplePeakToPeak();
   void sampleEnvelope();
-  uint8_t micOut;
+  void sampleLoudness();
+  void countClip(uint16_t sample);
+  uint16_t nextSample(uint8_t input);
+  void finishWindow(uint16_t numSamples);
+  uint32_t& lowThreshold();
+  uint32_t& highThreshold();
+  uint16_t atGain(uint32_t threshold, Gain gain);
+  uint32_t fromGain(uint16_t value, Gain gain);
+  uint8_t micOut[MAX_MIC_INPUTS];
+  uint8_t inputCount;
+  Combiner combiner;
   uint8_t micGain;
   uint32_t micSampleWindowMicros;
   uint16_t signal;
-  uint16_t peakToPeakLow;
-  uint16_t peakToPeakHigh;
-  uint16_t rmsLow;
-  uint16_t rmsHigh;
+  // Thresholds at HIGH_GAIN scale, derived for the current gain on read
+  // so gain changes never lose them to clamping
+  uint32_t peakToPeakLow;
+  uint32_t peakToPeakHigh;
+  uint32_t rmsLow;
+  uint32_t rmsHigh;
+  uint32_t loudnessLow;
+  uint32_t loudnessHigh;
+  uint16_t gainStepNumerator;
+  uint16_t gainStepDenominator;
   Mode mode;
   Gain gain;
-
-  uint16_t prevFullMin;
-  uint16_t prevFullMax;
+  AdcFrontEnd frontEnd[MAX_MIC_INPUTS];
+  bool frontEndEnabled;
+  FilterChain filter[MAX_MIC_INPUTS];
+  Channel channels[MAX_MIC_INPUTS];
+  bool channelRms;
+  ShortTermLoudness loudness;
+  uint16_t clipCount;
+  uint16_t sampleCount;
+  uint16_t windowSamples;
+  uint16_t sampleRate;
+  uint16_t* captureBuffer;
+  uint16_t captureCapacity;
+  uint16_t captureLength;
 };
 
 #endif
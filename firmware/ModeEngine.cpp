@@ -0,0 +1,265 @@
+#include "ModeEngine.h"
+#include "WireMask.h"
+#include <string.h>
+
+// ---------------- MODE DEFINITIONS ----------------
+const Mode modes[] = {
+  { "rPulse", ModeType::Reactive, &ModeEngine::reactivePulse, nullptr },
+  { "rPulseDecay", ModeType::Reactive, &ModeEngine::reactivePulseWithDecay, nullptr },
+  { "rBeatPulseDecay", ModeType::Reactive, &ModeEngine::reactiveBeatPulseDecay, nullptr },
+  { "rRandom", ModeType::Reactive, &ModeEngine::reactiveRandomSimple, nullptr },
+  { "rRandomSwap", ModeType::Reactive, &ModeEngine::reactiveRandomSwap, nullptr },
+  { "rRandomHL", ModeType::Reactive, &ModeEngine::reactiveRandomHighLow, nullptr },
+  { "rLinearSweep", ModeType::Reactive, &ModeEngine::reactiveLinearSweep, nullptr },
+  { "pPulseUp", ModeType::Periodic, &ModeEngine::periodicPulseUp, &ModeEngine::periodicEnter },
+  { "pPulseUpDown", ModeType::Periodic, &ModeEngine::periodicPulseUpDown, &ModeEngine::periodicEnter },
+  { "pFlash", ModeType::Periodic, &ModeEngine::periodicFlash, &ModeEngine::periodicEnter },
+  { "pFlashDecay", ModeType::Periodic, &ModeEngine::periodicFlashWithDecay, &ModeEngine::periodicEnter },
+  { "pRandom", ModeType::Periodic, &ModeEngine::periodicRandom, &ModeEngine::periodicEnter },
+};
+
+uint8_t getModeCount() {
+  return (uint8_t)(sizeof(modes) / sizeof(modes[0]));
+}
+
+bool isReactive(uint8_t idx) {
+  if (idx >= getModeCount()) return false;
+  return modes[idx].type == ModeType::Reactive;
+}
+
+const ModeParamInfo modeParams[MODE_PARAM_COUNT] = {
+  { "beat", 0, 8, 6 },
+  { "sweep", 0, 8, 6 },
+  { "random", 0, 8, 6 },
+  { "swap", 0, 8, 6 },
+  { "hlMed", 0, 8, 2 },
+  { "hlHigh", 0, 8, 7 },
+  { "hlCool", 0, 60000, 1000 },
+};
+
+// Index of the named parameter, or -1
+int8_t findModeParam(const char* name) {
+  for (uint8_t i = 0; i < MODE_PARAM_COUNT; i++) {
+    if (strcmp(modeParams[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+ModeEngine::ModeEngine(uint8_t channelCount, uint16_t attackMsPerLevel)
+  : envelope(attackMsPerLevel, 0), beatEnvelope(attackMsPerLevel, 0) {
+  this->channelCount = channelCount > WIRE_MASK_MAX_CHANNELS ? WIRE_MASK_MAX_CHANNELS : channelCount;
+  this->mode = 0;
+  this->numWires = this->channelCount;
+  this->delayMs = 1;
+  this->mask = 0;
+  this->tapTempo = nullptr;
+  this->periodicAnchorMs = 0;
+  this->lastPeriodicStep = UINT32_MAX;
+  this->lastRandomLevel = 0;
+  this->lastSwapLevel = 0;
+  this->lastSwapNumWires = 0;
+  this->lastHighLowLevel = 0;
+  this->lastHighMs = 0;
+  this->lastSweepLevel = 0;
+  this->sweepStart = 0;
+  resetParams();
+}
+
+void ModeEngine::seed(uint32_t seed) {
+  rng.seed(seed);
+}
+
+void ModeEngine::setMode(uint8_t mode, uint32_t nowMs) {
+  this->mode = mode < getModeCount() ? mode : 0;
+  if (modes[this->mode].onEnter) (this->*modes[this->mode].onEnter)(nowMs);
+}
+
+void ModeEngine::setNumWires(uint8_t numWires) {
+  this->numWires = numWires;
+}
+
+// Step length of periodic modes and release rate of the decay modes
+void ModeEngine::setDelay(uint16_t delayMs) {
+  this->delayMs = delayMs ? delayMs : 1;
+}
+
+// With a tempo set, periodic modes follow its beat grid instead
+void ModeEngine::setTapTempo(const TapTempo* tapTempo) {
+  this->tapTempo = tapTempo;
+}
+
+// The next periodic run draws its step even if the grid did not move
+void ModeEngine::restartPeriodic() {
+  lastPeriodicStep = UINT32_MAX;
+}
+
+bool ModeEngine::run(uint8_t level, uint32_t nowMs) {
+  return (this->*modes[mode].run)(level, nowMs);
+}
+
+// For masks drawn outside the modes (spatial drive), so modes that build
+// on the lit wires see what is actually shown
+void ModeEngine::setMask(uint8_t mask) {
+  this->mask = mask & WireMask::fullMask(channelCount);
+}
+
+// Clamped to the parameter's range; returns the value in effect
+uint16_t ModeEngine::setParam(uint8_t param, uint16_t value) {
+  if (param >= MODE_PARAM_COUNT) return 0;
+  const ModeParamInfo& info = modeParams[param];
+  if (value < info.minValue) value = info.minValue;
+  if (value > info.maxValue) value = info.maxValue;
+  params[param] = value;
+  return value;
+}
+
+uint16_t ModeEngine::getParam(uint8_t param) const {
+  return param < MODE_PARAM_COUNT ? params[param] : 0;
+}
+
+void ModeEngine::resetParams() {
+  for (uint8_t i = 0; i < MODE_PARAM_COUNT; i++) {
+    params[i] = modeParams[i].defaultValue;
+  }
+}
+
+bool ModeEngine::show(uint8_t mask) {
+  setMask(mask);
+  return true;
+}
+
+uint8_t ModeEngine::firstWires(uint8_t num) const {
+  return WireMask::fullMask(num < channelCount ? num : channelCount);
+}
+
+// The num wires ending at wire wireNum (1-based), i.e. a bar of length
+// num whose top follows the level
+uint8_t ModeEngine::wiresUpTo(uint8_t num, uint8_t wireNum) const {
+  return firstWires(wireNum) & (uint8_t)~firstWires(wireNum > num ? wireNum - num : 0);
+}
+
+bool ModeEngine::reactivePulse(uint8_t level, uint32_t) {
+  if (numWires == 1) {
+    return show(level > 0 ? (uint8_t)(1U << (level - 1)) : 0);
+  } else if (numWires == channelCount) {
+    return show(firstWires(level));
+  }
+  return show(wiresUpTo(numWires, level));
+}
+
+bool ModeEngine::reactivePulseWithDecay(uint8_t level, uint32_t nowMs) {
+  envelope.setRelease(delayMs);
+  return show(wiresUpTo(numWires, envelope.update(level, nowMs)));
+}
+
+bool ModeEngine::reactiveBeatPulseDecay(uint8_t level, uint32_t nowMs) {
+  beatEnvelope.setRelease(delayMs);
+  uint8_t target = level >= params[PARAM_BEAT_THRESHOLD] ? level : 0;
+  return show(wiresUpTo(numWires, beatEnvelope.update(target, nowMs)));
+}
+
+bool ModeEngine::reactiveRandomSimple(uint8_t level, uint32_t) {
+  bool rising = level > lastRandomLevel;
+  lastRandomLevel = level;
+  if (!rising || level <= params[PARAM_RANDOM_THRESHOLD]) return false;
+  return show(WireMask::randomMask(rng, channelCount, numWires));
+}
+
+bool ModeEngine::reactiveRandomSwap(uint8_t level, uint32_t) {
+  bool rising = level > lastSwapLevel;
+  lastSwapLevel = level;
+  if (!rising || level <= params[PARAM_SWAP_THRESHOLD]) return false;
+
+  uint8_t litCount = WireMask::popcount(mask);
+
+  // If wrong number of wires lit or numWires changed, start fresh
+  if (litCount != numWires || lastSwapNumWires != numWires) {
+    lastSwapNumWires = numWires;
+    return show(WireMask::randomMask(rng, channelCount, numWires));
+  }
+
+  // Calculate how many to swap based on available wires
+  uint8_t darkCount = channelCount - litCount;
+  uint8_t swapCount = (litCount >= 2 && darkCount >= 2) ? 2 : 1;
+  return show(WireMask::swapBits(rng, mask, channelCount, swapCount));
+}
+
+bool ModeEngine::reactiveRandomHighLow(uint8_t level, uint32_t nowMs) {
+  bool rising = level > lastHighLowLevel;
+  lastHighLowLevel = level;
+
+  if (!rising) return false;
+
+  if (level >= params[PARAM_HL_HIGH]) {
+    lastHighMs = nowMs;
+    return show(WireMask::randomMask(rng, channelCount, numWires));
+  }
+
+  if (level >= params[PARAM_HL_MEDIUM] && (nowMs - lastHighMs) >= params[PARAM_HL_COOLDOWN_MS]) {
+    return show(WireMask::randomMask(rng, channelCount, 1));
+  }
+  return false;
+}
+
+bool ModeEngine::reactiveLinearSweep(uint8_t level, uint32_t) {
+  bool rising = level > lastSweepLevel;
+  lastSweepLevel = level;
+
+  if (!rising || level <= params[PARAM_SWEEP_THRESHOLD]) return false;
+
+  uint8_t pattern = 0;
+  for (uint8_t k = 0; k < numWires; k++) {
+    pattern |= (uint8_t)(1U << ((sweepStart + k) % channelCount));
+  }
+  sweepStart = (sweepStart + 1) % channelCount;
+  return show(pattern);
+}
+
+// Periodic modes draw a step whenever the step grid moves on and return
+// at once. With a tapped tempo, one pattern cycle spans a beat; without,
+// every step lasts the delay.
+bool ModeEngine::periodicStepDue(uint32_t nowMs, uint8_t cycleLength, uint8_t& step) {
+  uint32_t index = tapTempo && tapTempo->hasTempo()
+    ? tapTempo->position(nowMs, cycleLength)
+    : (nowMs - periodicAnchorMs) / delayMs;
+  if (index == lastPeriodicStep) return false;
+  lastPeriodicStep = index;
+  step = index % cycleLength;
+  return true;
+}
+
+void ModeEngine::periodicEnter(uint32_t nowMs) {
+  periodicAnchorMs = nowMs;
+  lastPeriodicStep = UINT32_MAX;
+}
+
+bool ModeEngine::periodicPulseUp(uint8_t, uint32_t nowMs) {
+  uint8_t step;
+  if (!periodicStepDue(nowMs, channelCount + 1, step)) return false;
+  return show(step < channelCount ? (uint8_t)(1U << step) : 0);
+}
+
+// Up through every wire, then back down without repeating the ends
+bool ModeEngine::periodicPulseUpDown(uint8_t, uint32_t nowMs) {
+  uint8_t step;
+  if (!periodicStepDue(nowMs, 2 * channelCount - 2, step)) return false;
+  return show((uint8_t)(1U << (step < channelCount ? step : 2 * channelCount - 2 - step)));
+}
+
+bool ModeEngine::periodicFlash(uint8_t, uint32_t nowMs) {
+  uint8_t step;
+  if (!periodicStepDue(nowMs, 2, step)) return false;
+  return show(step == 0 ? firstWires(channelCount) : 0);
+}
+
+bool ModeEngine::periodicFlashWithDecay(uint8_t, uint32_t nowMs) {
+  uint8_t step;
+  if (!periodicStepDue(nowMs, channelCount + 1, step)) return false;
+  return show(firstWires(channelCount - step));
+}
+
+bool ModeEngine::periodicRandom(uint8_t, uint32_t nowMs) {
+  uint8_t step;
+  if (!periodicStepDue(nowMs, 1, step)) return false;
+  return show((uint8_t)(rng.next() >> 24));
+}
@@ -0,0 +1,97 @@
+#ifndef MODE_ENGINE_H
+#define MODE_ENGINE_H
+
+#include <stdint.h>
+#include "ModeRegistry.h"
+#include "EnvelopeFollower.h"
+#include "FastRandom.h"
+#include "TapTempo.h"
+
+// Tunables read by the reactive modes at run time, so presets (e.g. from
+// the simulator's tune-modes) apply without reflashing
+enum ModeParam : uint8_t {
+  PARAM_BEAT_THRESHOLD, // rBeatPulseDecay: lowest level that pulses
+  PARAM_SWEEP_THRESHOLD, // rLinearSweep: rising above this steps the sweep
+  PARAM_RANDOM_THRESHOLD, // rRandom: rising above this redraws
+  PARAM_SWAP_THRESHOLD, // rRandomSwap: rising above this swaps wires
+  PARAM_HL_MEDIUM, // rRandomHL: lowest level for a single wire
+  PARAM_HL_HIGH, // rRandomHL: lowest level for numWires wires
+  PARAM_HL_COOLDOWN_MS, // rRandomHL: single wires only this long after a high
+  MODE_PARAM_COUNT
+};
+
+struct ModeParamInfo {
+  const char* name;
+  uint16_t minValue;
+  uint16_t maxValue;
+  uint16_t defaultValue;
+};
+
+extern const ModeParamInfo modeParams[MODE_PARAM_COUNT];
+int8_t findModeParam(const char* name);
+
+// The light modes as pure logic: each run turns the quantized level (or,
+// for periodic modes, the clock) into a wire mask. Nothing here touches
+// pins or millis(), so the firmware and the simulator run the same code;
+// the caller shows getMask() whenever run() reports a new one.
+class ModeEngine {
+public:
+  ModeEngine(uint8_t channelCount, uint16_t attackMsPerLevel);
+
+  void seed(uint32_t seed);
+  void setMode(uint8_t mode, uint32_t nowMs);
+  uint8_t getMode() const { return mode; }
+  void setNumWires(uint8_t numWires);
+  uint8_t getNumWires() const { return numWires; }
+  void setDelay(uint16_t delayMs);
+  uint16_t getDelay() const { return delayMs; }
+  void setTapTempo(const TapTempo* tapTempo);
+  void restartPeriodic();
+  bool run(uint8_t level, uint32_t nowMs);
+  void setMask(uint8_t mask);
+  uint8_t getMask() const { return mask; }
+  uint16_t setParam(uint8_t param, uint16_t value);
+  uint16_t getParam(uint8_t param) const;
+  void resetParams();
+
+  bool reactivePulse(uint8_t level, uint32_t nowMs);
+  bool reactivePulseWithDecay(uint8_t level, uint32_t nowMs);
+  bool reactiveBeatPulseDecay(uint8_t level, uint32_t nowMs);
+  bool reactiveRandomSimple(uint8_t level, uint32_t nowMs);
+  bool reactiveRandomSwap(uint8_t level, uint32_t nowMs);
+  bool reactiveRandomHighLow(uint8_t level, uint32_t nowMs);
+  bool reactiveLinearSweep(uint8_t level, uint32_t nowMs);
+  bool periodicPulseUp(uint8_t level, uint32_t nowMs);
+  bool periodicPulseUpDown(uint8_t level, uint32_t nowMs);
+  bool periodicFlash(uint8_t level, uint32_t nowMs);
+  bool periodicFlashWithDecay(uint8_t level, uint32_t nowMs);
+  bool periodicRandom(uint8_t level, uint32_t nowMs);
+  void periodicEnter(uint32_t nowMs);
+
+private:
+  bool show(uint8_t mask);
+  uint8_t firstWires(uint8_t num) const;
+  uint8_t wiresUpTo(uint8_t num, uint8_t wireNum) const;
+  bool periodicStepDue(uint32_t nowMs, uint8_t cycleLength, uint8_t& step);
+  uint8_t channelCount;
+  uint8_t mode;
+  uint8_t numWires;
+  uint16_t delayMs;
+  uint8_t mask;
+  FastRandom rng;
+  EnvelopeFollower envelope;
+  EnvelopeFollower beatEnvelope;
+  const TapTempo* tapTempo;
+  uint16_t params[MODE_PARAM_COUNT];
+  uint32_t periodicAnchorMs;
+  uint32_t lastPeriodicStep;
+  uint8_t lastRandomLevel;
+  uint8_t lastSwapLevel;
+  uint8_t lastSwapNumWires;
+  uint8_t lastHighLowLevel;
+  uint32_t lastHighMs;
+  uint8_t lastSweepLevel;
+  uint8_t sweepStart;
+};
+
+#endif
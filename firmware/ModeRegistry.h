@@ -1,17 +1,20 @@
 #ifndef MODE_REGISTRY_H
 #define MODE_REGISTRY_H
-#include "Arduino.h"
+#include <stdint.h>
+
+class ModeEngine;
 
 enum class ModeType : uint8_t {
   Reactive = 0,
   Periodic = 1
 };
 
+// run() returns true when the mode drew a new wire mask
 struct Mode {
   const char* label;
   ModeType type;
-  void (*run)();
-  void (*onEnter)();
+  bool (ModeEngine::*run)(uint8_t level, uint32_t nowMs);
+  void (ModeEngine::*onEnter)(uint32_t nowMs);
 };
 
 extern const Mode modes[];
@@ -0,0 +1,44 @@
+#include "PanelState.h"
+
+// keys holds the receive char of each field, in field order
+PanelState::PanelState(const char* keys) {
+  this->keys = keys;
+  this->count = min(strlen(keys), (size_t)PANEL_STATE_MAX_FIELDS);
+  this->dirty = 0;
+  for (uint8_t i = 0; i < PANEL_STATE_MAX_FIELDS; i++) {
+    known[i] = false;
+  }
+}
+
+void PanelState::mark(uint8_t field) {
+  if (field < count) dirty |= 1U << field;
+}
+
+// Forgets what the phone has, so the next collect() is a full snapshot
+void PanelState::markAll() {
+  for (uint8_t i = 0; i < count; i++) {
+    known[i] = false;
+  }
+  dirty = (1U << count) - 1;
+}
+
+bool PanelState::isDirty() {
+  return dirty != 0;
+}
+
+String PanelState::collect(String (*valueOf)(uint8_t field)) {
+  String frame = "";
+  for (uint8_t i = 0; i < count && dirty; i++) {
+    if (!(dirty & (1U << i))) continue;
+    dirty &= ~(1U << i);
+    String value = valueOf(i);
+    if (known[i] && value == sent[i]) continue;
+    frame += "*";
+    frame += keys[i];
+    frame += value;
+    frame += "*";
+    sent[i] = value;
+    known[i] = true;
+  }
+  return frame;
+}
@@ -0,0 +1,28 @@
+#ifndef PANEL_STATE_H
+#define PANEL_STATE_H
+
+#include "Arduino.h"
+
+#define PANEL_STATE_MAX_FIELDS 16
+
+// Tracks which panel values changed since they were last sent. Setters
+// mark their field dirty; collect() then emits one "*<key><value>*" token
+// per dirty field whose value actually differs from the last one sent,
+// so repeated changes between two sends cost a single token.
+class PanelState {
+public:
+  explicit PanelState(const char* keys);
+  void mark(uint8_t field);
+  void markAll();
+  bool isDirty();
+  String collect(String (*valueOf)(uint8_t field));
+
+private:
+  const char* keys;
+  uint8_t count;
+  uint16_t dirty;
+  String sent[PANEL_STATE_MAX_FIELDS];
+  bool known[PANEL_STATE_MAX_FIELDS];
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "PanelSync.h"
+#include <Preferences.h>
+
+PanelSync::PanelSync(const char* panel, uint32_t hash) {
+  this->panel = panel;
+  this->hash = hash;
+  this->length = strlen(panel);
+  this->requested = false;
+  this->forced = false;
+  this->pushing = false;
+  this->awaitingFlush = false;
+  this->peerKey[0] = '\0';
+}
+
+// Restarts from the beginning, e.g. after a reconnect cut a push short.
+// The peer is looked up on the next update(), once the link is up.
+void PanelSync::requestPush(bool force) {
+  requested = true;
+  forced = force;
+  pushing = false;
+  awaitingFlush = false;
+}
+
+void PanelSync::update(BluetoothElectronics& bluetooth) {
+  if (requested) {
+    start(bluetooth);
+  }
+  if (awaitingFlush) {
+    // Only counts as delivered once the queue has written it all out
+    if (bluetooth.hasQueueSpace(TX_QUEUE_MAX_BYTES, TX_QUEUE_SLOTS)) {
+      storeHash();
+      awaitingFlush = false;
+    }
+    return;
+  }
+  uint8_t chunks = (length + PANEL_SYNC_CHUNK - 1) / PANEL_SYNC_CHUNK;
+  if (!pushing || !bluetooth.hasQueueSpace(length + 8, chunks + 2)) return;
+
+  bluetooth.sendRaw(KWL_BEGIN "\n");
+  char chunk[PANEL_SYNC_CHUNK + 1];
+  for (uint16_t offset = 0; offset < length; offset += PANEL_SYNC_CHUNK) {
+    uint16_t n = min((uint16_t)(length - offset), (uint16_t)PANEL_SYNC_CHUNK);
+    memcpy(chunk, panel + offset, n);
+    chunk[n] = '\0';
+    bluetooth.sendRaw(chunk);
+  }
+  bluetooth.sendRaw("\n" KWL_END);
+  pushing = false;
+  awaitingFlush = true;
+}
+
+// The NVS key is the peer address in hex, 12 characters (the limit is 15)
+void PanelSync::start(BluetoothElectronics& bluetooth) {
+  static const char digits[] = "0123456789abcdef";
+  requested = false;
+  uint8_t address[6];
+  if (!bluetooth.getPeerAddress(address)) {
+    peerKey[0] = '\0';
+    pushing = true;
+    return;
+  }
+  for (uint8_t i = 0; i < 6; i++) {
+    peerKey[i * 2] = digits[address[i] >> 4];
+    peerKey[i * 2 + 1] = digits[address[i] & 0x0F];
+  }
+  peerKey[12] = '\0';
+  if (forced) {
+    pushing = true;
+    return;
+  }
+  Preferences preferences;
+  preferences.begin(PANEL_SYNC_NAMESPACE, true);
+  pushing = preferences.getUInt(peerKey, 0) != hash;
+  preferences.end();
+}
+
+bool PanelSync::isPushing() {
+  return requested || pushing || awaitingFlush;
+}
+
+// Bulk senders hold back meanwhile, or they could keep the queue too
+// full for the panel to ever go out
+bool PanelSync::isWaitingForRoom() {
+  return requested || pushing;
+}
+
+void PanelSync::storeHash() {
+  if (peerKey[0] == '\0') return;
+  Preferences preferences;
+  preferences.begin(PANEL_SYNC_NAMESPACE, false);
+  if (preferences.getUInt(peerKey, 0) != hash) {
+    preferences.putUInt(peerKey, hash);
+  }
+  preferences.end();
+}
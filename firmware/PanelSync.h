@@ -0,0 +1,37 @@
+#ifndef PANEL_SYNC_H
+#define PANEL_SYNC_H
+
+#include "Arduino.h"
+#include "BluetoothElectronics.h"
+
+#define PANEL_SYNC_CHUNK 256
+#define PANEL_SYNC_NAMESPACE "kwl"
+
+// Pushes the Bluetooth Electronics panel to the phone as a *.kwl
+// message. The whole message is queued in one go, once the output queue
+// has room for it, so no other line can land inside it. The hash of the
+// panel last sent to each phone is kept in NVS under the phone's address;
+// on connect the push is skipped only when that phone already has this
+// panel. Links without a peer address always get it.
+class PanelSync {
+public:
+  PanelSync(const char* panel, uint32_t hash);
+  void requestPush(bool force);
+  void update(BluetoothElectronics& bluetooth);
+  bool isPushing();
+  bool isWaitingForRoom();
+
+private:
+  const char* panel;
+  uint32_t hash;
+  uint16_t length;
+  bool requested;
+  bool forced;
+  bool pushing;
+  bool awaitingFlush;
+  char peerKey[13];
+  void start(BluetoothElectronics& bluetooth);
+  void storeHash();
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "PeakToPeakSampler.h"
+
+PeakToPeakSampler::PeakToPeakSampler(bool doubleWindow) {
+  this->doubleWindow = doubleWindow;
+  reset();
+}
+
+void PeakToPeakSampler::setDoubleWindow(bool doubleWindow) {
+  this->doubleWindow = doubleWindow;
+}
+
+void PeakToPeakSampler::reset() {
+  primed = false;
+  prevMin = 0;
+  prevMax = 0;
+}
+
+uint16_t PeakToPeakSampler::feed(uint16_t windowMin, uint16_t windowMax) {
+  uint16_t low = windowMin;
+  uint16_t high = windowMax;
+  if (doubleWindow && primed) {
+    if (prevMin < low) low = prevMin;
+    if (prevMax > high) high = prevMax;
+  }
+  prevMin = windowMin;
+  prevMax = windowMax;
+  primed = true;
+  return high > low ? high - low : 0;
+}
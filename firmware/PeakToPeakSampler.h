@@ -0,0 +1,26 @@
+#ifndef PEAK_TO_PEAK_SAMPLER_H
+#define PEAK_TO_PEAK_SAMPLER_H
+
+#include <stdint.h>
+
+// Peak-to-peak of a window's min and max. In double-window mode the span
+// also covers the previous window, which holds short peaks one window
+// longer (the RMS sampling mode). The first window after a reset has no
+// predecessor and is measured alone.
+class PeakToPeakSampler {
+public:
+  explicit PeakToPeakSampler(bool doubleWindow = false);
+
+  void setDoubleWindow(bool doubleWindow);
+  bool isDoubleWindow() const { return doubleWindow; }
+  void reset();
+  uint16_t feed(uint16_t windowMin, uint16_t windowMax);
+
+private:
+  bool doubleWindow;
+  bool primed;
+  uint16_t prevMin;
+  uint16_t prevMax;
+};
+
+#endif
@@ -1,54 +1,192 @@
 #include "PushButtons.h"
+#include <atomic>
 
 namespace {
+  struct Edge {
+    uint8_t button;
+    uint8_t level;
+    uint32_t timeMs;
+  };
+
+  enum class Phase : uint8_t {
+    Idle,      // released, no click pending
+    Held,      // pressed
+    Released,  // one click done, waiting for a second
+    Consumed   // gesture already reported; ignore until released
+  };
+
+  struct Button {
+    uint8_t pin;
+    uint8_t rawLevel;
+    uint8_t stableLevel;
+    uint32_t lastEdgeMs;
+    uint32_t burstStartMs;
+    Phase phase;
+    bool secondClick;
+    uint32_t pressMs;
+    uint32_t releaseMs;
+  };
+
   struct State {
-    uint8_t pin = 0;
+    Button buttons[MAX_PUSH_BUTTONS];
+    uint8_t count = 0;
     uint32_t debounceMs = 5;
-    uint32_t pauseMs = 1000;
-    volatile bool pressed = false;
-    volatile uint32_t lastPressTime = 0;
-    volatile uint32_t lastEdgeTime = 0;
+    uint32_t doubleClickMs = 300;
+    uint32_t longPressMs = 600;
+
+    // Single producer (the button ISRs, which do not nest) and single
+    // consumer (the loop); each index is written by one side only. The
+    // release store of an index publishes the entry written before it.
+    Edge edges[BUTTON_EDGE_QUEUE];
+    std::atomic<uint8_t> edgeHead{ 0 };
+    std::atomic<uint8_t> edgeTail{ 0 };
+
+    ButtonEvent events[BUTTON_EVENT_QUEUE];
+    uint8_t eventHead = 0;
+    uint8_t eventCount = 0;
   } s;
 
-  void IRAM_ATTR isrFalling() {
-    uint32_t now = millis();
-    if (now - s.lastEdgeTime > s.debounceMs) {
-      s.pressed = true;
-      s.lastPressTime = now;
+  void IRAM_ATTR isrChange(void* arg) {
+    uint8_t button = (uint8_t)(uintptr_t)arg;
+    uint8_t head = s.edgeHead.load(std::memory_order_relaxed);
+    if ((uint8_t)(head - s.edgeTail.load(std::memory_order_acquire)) >= BUTTON_EDGE_QUEUE) return;
+    Edge& e = s.edges[head % BUTTON_EDGE_QUEUE];
+    e.button = button;
+    e.level = digitalRead(s.buttons[button].pin);
+    e.timeMs = millis();
+    s.edgeHead.store(head + 1, std::memory_order_release);
+  }
+
+  void emit(ButtonGesture gesture, uint8_t button, uint32_t timeMs) {
+    if (s.eventCount == BUTTON_EVENT_QUEUE) return;
+    s.events[(s.eventHead + s.eventCount) % BUTTON_EVENT_QUEUE] = { gesture, button, timeMs };
+    s.eventCount++;
+  }
+
+  uint8_t heldMask() {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < s.count; i++) {
+      if (s.buttons[i].stableLevel == LOW) mask |= 1 << i;
     }
-    s.lastEdgeTime = now;
+    return mask;
   }
 
-  void IRAM_ATTR isrRising() {
-    s.lastEdgeTime = millis();
+  // Withdraws Press events of the given buttons not yet polled
+  void dropPresses(uint8_t mask) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < s.eventCount; i++) {
+      const ButtonEvent& e = s.events[(s.eventHead + i) % BUTTON_EVENT_QUEUE];
+      if (e.gesture == ButtonGesture::Press && (mask & (1 << e.button))) continue;
+      s.events[(s.eventHead + kept) % BUTTON_EVENT_QUEUE] = e;
+      kept++;
+    }
+    s.eventCount = kept;
   }
-}
 
-void pushButtonsBegin(uint8_t pin, uint32_t debounceMs, uint32_t pauseMs) {
-  s.pin = pin;
-  s.debounceMs = debounceMs;
-  s.pauseMs = pauseMs;
-  pinMode(s.pin, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(s.pin), isrFalling, FALLING);
-  attachInterrupt(digitalPinToInterrupt(s.pin), isrRising, RISING);
-}
+  void onPress(uint8_t index, uint32_t timeMs) {
+    Button& b = s.buttons[index];
+    uint8_t mask = heldMask();
+    if (mask != (1 << index)) {
+      // A chord is not a tap: no Press for it, from any of its buttons
+      dropPresses(mask);
+      emit(ButtonGesture::Chord, mask, timeMs);
+      for (uint8_t i = 0; i < s.count; i++) {
+        if (mask & (1 << i)) s.buttons[i].phase = Phase::Consumed;
+      }
+      return;
+    }
+    emit(ButtonGesture::Press, index, timeMs);
+    b.secondClick = b.phase == Phase::Released && timeMs - b.releaseMs <= s.doubleClickMs;
+    b.phase = Phase::Held;
+    b.pressMs = timeMs;
+  }
+
+  void onRelease(uint8_t index, uint32_t timeMs) {
+    Button& b = s.buttons[index];
+    if (b.phase != Phase::Held) {
+      b.phase = Phase::Idle;
+      return;
+    }
+    if (b.secondClick) {
+      emit(ButtonGesture::DoubleClick, index, b.pressMs);
+      b.phase = Phase::Idle;
+    } else {
+      b.phase = Phase::Released;
+      b.releaseMs = timeMs;
+    }
+  }
+
+  // A level counts once the pin has been quiet for debounceMs; the
+  // transition is dated to the first edge of its bounce burst.
+  void debounce(uint8_t index, uint32_t nowMs) {
+    Button& b = s.buttons[index];
+    if (b.rawLevel == b.stableLevel || nowMs - b.lastEdgeMs < s.debounceMs) return;
+    b.stableLevel = b.rawLevel;
+    if (b.stableLevel == LOW) {
+      onPress(index, b.burstStartMs);
+    } else {
+      onRelease(index, b.burstStartMs);
+    }
+  }
 
-void pushButtonsUpdate(uint32_t) {
+  void checkTimers(uint8_t index, uint32_t nowMs) {
+    Button& b = s.buttons[index];
+    if (b.phase == Phase::Held && !b.secondClick && nowMs - b.pressMs >= s.longPressMs) {
+      emit(ButtonGesture::LongPress, index, b.pressMs);
+      b.phase = Phase::Consumed;
+    } else if (b.phase == Phase::Released && nowMs - b.releaseMs > s.doubleClickMs) {
+      emit(ButtonGesture::Click, index, b.pressMs);
+      b.phase = Phase::Idle;
+    }
+  }
 }
 
-bool pushButtonsShouldSkipLoop() {
-  uint32_t now = millis();
-  return (now - s.lastPressTime) <= s.pauseMs;
+void pushButtonsBegin(const uint8_t pins[], uint8_t count, uint32_t debounceMs,
+                      uint32_t doubleClickMs, uint32_t longPressMs) {
+  s.count = min(count, (uint8_t)MAX_PUSH_BUTTONS);
+  s.debounceMs = debounceMs;
+  s.doubleClickMs = doubleClickMs;
+  s.longPressMs = longPressMs;
+  for (uint8_t i = 0; i < s.count; i++) {
+    Button& b = s.buttons[i];
+    b.pin = pins[i];
+    pinMode(b.pin, INPUT_PULLUP);
+    b.rawLevel = HIGH;
+    b.stableLevel = HIGH;
+    b.lastEdgeMs = 0;
+    b.burstStartMs = 0;
+    b.phase = Phase::Idle;
+    b.secondClick = false;
+    attachInterruptArg(digitalPinToInterrupt(b.pin), isrChange, (void*)(uintptr_t)i, CHANGE);
+  }
 }
 
-bool pushButtonConsumePressed() {
-  if (s.pressed) {
-    s.pressed = false;
-    return true;
+void pushButtonsUpdate(uint32_t nowMs) {
+  uint8_t tail = s.edgeTail.load(std::memory_order_relaxed);
+  uint8_t head = s.edgeHead.load(std::memory_order_acquire);
+  while (tail != head) {
+    const Edge& e = s.edges[tail % BUTTON_EDGE_QUEUE];
+    Button& b = s.buttons[e.button];
+    // Settle the previous level first if it was stable before this edge
+    debounce(e.button, e.timeMs);
+    if (e.timeMs - b.lastEdgeMs >= s.debounceMs) {
+      b.burstStartMs = e.timeMs;
+    }
+    b.rawLevel = e.level;
+    b.lastEdgeMs = e.timeMs;
+    tail++;
+    s.edgeTail.store(tail, std::memory_order_release);
+  }
+  for (uint8_t i = 0; i < s.count; i++) {
+    debounce(i, nowMs);
+    checkTimers(i, nowMs);
   }
-  return false;
 }
 
-uint32_t pushButtonLastPressTime() {
-  return s.lastPressTime;
+bool pushButtonsPoll(ButtonEvent& event) {
+  if (s.eventCount == 0) return false;
+  event = s.events[s.eventHead];
+  s.eventHead = (s.eventHead + 1) % BUTTON_EVENT_QUEUE;
+  s.eventCount--;
+  return true;
 }
@@ -3,10 +3,31 @@
 
 #include "Arduino.h"
 
-void pushButtonsBegin(uint8_t pin, uint32_t debounceMs, uint32_t pauseMs);
+#define MAX_PUSH_BUTTONS 4
+#define BUTTON_EDGE_QUEUE 32 // power of two
+#define BUTTON_EVENT_QUEUE 8
+
+enum class ButtonGesture : uint8_t {
+  Press,       // debounced press, reported at once (e.g. for tapping);
+               // withdrawn if a Chord forms before it is polled
+  Click,       // released before longPressMs, no second click followed
+  DoubleClick, // second click within doubleClickMs
+  LongPress,   // held for longPressMs, reported while still held
+  Chord        // buttons pressed together; button holds the mask
+};
+
+struct ButtonEvent {
+  ButtonGesture gesture;
+  uint8_t button; // index, or bit mask for Chord
+  uint32_t timeMs; // ISR time of the edge that started the gesture
+};
+
+// Pins are active low with pull-ups. The ISRs only timestamp raw edges
+// into a lock-free queue; debouncing and gesture detection run in
+// pushButtonsUpdate(), which must be called every loop.
+void pushButtonsBegin(const uint8_t pins[], uint8_t count, uint32_t debounceMs,
+                      uint32_t doubleClickMs, uint32_t longPressMs);
 void pushButtonsUpdate(uint32_t nowMs);
-bool pushButtonsShouldSkipLoop();
-bool pushButtonConsumePressed();
-uint32_t pushButtonLastPressTime();
+bool pushButtonsPoll(ButtonEvent& event);
 
 #endif // PUSH_BUTTONS_H
@@ -0,0 +1,94 @@
+#include "RiceCodec.h"
+
+namespace {
+  struct BitWriter {
+    uint8_t* out;
+    uint16_t capacity;
+    uint16_t length;
+    uint32_t bits;
+    uint8_t pending;
+    bool overflow;
+
+    void put(uint32_t value, uint8_t count) {
+      while (count > 0) {
+        uint8_t take = count > 16 ? 16 : count;
+        count -= take;
+        bits = (bits << take) | ((value >> count) & ((1UL << take) - 1));
+        pending += take;
+        while (pending >= 8) {
+          pending -= 8;
+          byte((uint8_t)(bits >> pending));
+        }
+      }
+    }
+
+    void ones(uint8_t count) {
+      put((1UL << count) - 1, count);
+    }
+
+    void byte(uint8_t b) {
+      if (length < capacity) {
+        out[length++] = b;
+      } else {
+        overflow = true;
+      }
+    }
+
+    void flush() {
+      if (pending > 0) {
+        byte((uint8_t)(bits << (8 - pending)));
+        pending = 0;
+      }
+    }
+  };
+
+  inline uint16_t zigzag(int32_t delta) {
+    return (uint16_t)((delta << 1) ^ (delta >> 31));
+  }
+}
+
+// Returns the frame length, or 0 if it did not fit in maxLength.
+uint16_t RiceCodec::encode(const uint16_t* samples, uint16_t count, uint16_t sampleRate, uint8_t* out, uint16_t maxLength) {
+  BitWriter w = { out, maxLength, 0, 0, 0, false };
+  w.put(count & 0xFF, 8);
+  w.put(count >> 8, 8);
+  w.put(sampleRate & 0xFF, 8);
+  w.put(sampleRate >> 8, 8);
+  uint16_t first = count ? samples[0] : 0;
+  w.put(first & 0xFF, 8);
+  w.put(first >> 8, 8);
+
+  uint16_t residuals[RICE_BLOCK_SAMPLES];
+  uint16_t previous = first;
+  for (uint16_t start = 1; start < count; start += RICE_BLOCK_SAMPLES) {
+    uint16_t n = count - start < RICE_BLOCK_SAMPLES ? count - start : RICE_BLOCK_SAMPLES;
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < n; i++) {
+      uint16_t sample = samples[start + i];
+      residuals[i] = zigzag((int32_t)sample - (int32_t)previous);
+      previous = sample;
+      sum += residuals[i];
+    }
+
+    // Smallest k with n * 2^k covering the residual sum (~log2 of the mean)
+    uint8_t k = 0;
+    while (k < 15 && ((uint32_t)n << k) < sum) {
+      k++;
+    }
+    w.put(k, 4);
+
+    for (uint16_t i = 0; i < n; i++) {
+      uint16_t q = residuals[i] >> k;
+      if (q >= RICE_ESCAPE_QUOTIENT) {
+        w.ones(RICE_ESCAPE_QUOTIENT);
+        w.put(residuals[i], 16);
+      } else {
+        w.ones((uint8_t)q);
+        w.put(0, 1);
+        w.put(residuals[i], k);
+      }
+    }
+  }
+  w.flush();
+  return w.overflow ? 0 : w.length;
+}
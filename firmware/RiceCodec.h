@@ -0,0 +1,21 @@
+#ifndef RICE_CODEC_H
+#define RICE_CODEC_H
+
+#include <stdint.h>
+
+#define RICE_BLOCK_SAMPLES 32
+#define RICE_ESCAPE_QUOTIENT 16
+
+// Lossless codec for ADC sample windows: first-order delta, zigzag, then
+// Rice coding with the parameter k chosen per block of 32 residuals.
+//
+// Frame: sample count (u16 LE), sample rate Hz (u16 LE), first sample
+// (u16 LE), then an MSB-first bit stream. Each block starts with k in
+// 4 bits; each residual is the quotient in unary (ones, closed by a zero)
+// and the k low bits. Quotients of RICE_ESCAPE_QUOTIENT or more are sent
+// as that many ones followed by the residual in 16 plain bits.
+namespace RiceCodec {
+  uint16_t encode(const uint16_t* samples, uint16_t count, uint16_t sampleRate, uint8_t* out, uint16_t maxLength);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#include "SerialTransport.h"
+
+SerialTransport::SerialTransport(HardwareSerial& serial, uint32_t baudRate)
+  : serial(serial) {
+  this->baudRate = baudRate;
+}
+
+void SerialTransport::begin(const char* deviceName) {
+  serial.begin(baudRate);
+  serial.print("Using Serial for input: ");
+  serial.println(deviceName);
+}
+
+int SerialTransport::available() {
+  return serial.available();
+}
+
+int SerialTransport::read() {
+  return serial.read();
+}
+
+// Accepts only what fits in the UART's TX buffer, as HardwareSerial::write
+// waits for room otherwise
+size_t SerialTransport::write(const uint8_t* data, size_t length) {
+  int room = serial.availableForWrite();
+  if (room <= 0) return 0;
+  if (length > (size_t)room) length = room;
+  return serial.write(data, length);
+}
+
+bool SerialTransport::isConnected() {
+  return true;
+}
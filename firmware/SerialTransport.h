@@ -0,0 +1,22 @@
+#ifndef SERIAL_TRANSPORT_H
+#define SERIAL_TRANSPORT_H
+
+#include "Arduino.h"
+#include "Transport.h"
+
+// USB serial, for driving the firmware from a terminal without a phone
+class SerialTransport : public Transport {
+public:
+  SerialTransport(HardwareSerial& serial, uint32_t baudRate);
+  void begin(const char* deviceName) override;
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  bool isConnected() override;
+
+private:
+  HardwareSerial& serial;
+  uint32_t baudRate;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "ShortTermLoudness.h"
+
+// K-weighting: head-related high shelf followed by the RLB high-pass
+#define K_SHELF_HZ 1681.97f
+#define K_SHELF_Q 0.7072f
+#define K_SHELF_GAIN_DB 4.0f
+#define K_HIGHPASS_HZ 38.14f
+#define K_HIGHPASS_Q 0.5003f
+
+namespace {
+  uint32_t isqrt64(uint64_t v) {
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+      if (v >= result + bit) {
+        v -= result + bit;
+        result = (result >> 1) + bit;
+      } else {
+        result >>= 1;
+      }
+      bit >>= 2;
+    }
+    return (uint32_t)result;
+  }
+}
+
+ShortTermLoudness::ShortTermLoudness(uint8_t hopMillis) {
+  uint16_t hops = hopMillis ? (SHORT_TERM_BLOCK_MS + hopMillis / 2) / hopMillis : 1;
+  hopCount = hops > SHORT_TERM_MAX_HOPS ? SHORT_TERM_MAX_HOPS : (hops ? hops : 1);
+  sampleRateHz = 20000;
+  design();
+  reset();
+}
+
+void ShortTermLoudness::configure(uint32_t sampleRateHz) {
+  if (sampleRateHz == 0) return;
+  uint32_t diff = sampleRateHz > this->sampleRateHz ? sampleRateHz - this->sampleRateHz : this->sampleRateHz - sampleRateHz;
+  if (diff <= (this->sampleRateHz >> 5)) return;
+  this->sampleRateHz = sampleRateHz;
+  design();
+}
+
+void ShortTermLoudness::design() {
+  float fs = (float)sampleRateHz;
+  stage1.designHighShelf(fs, K_SHELF_HZ, K_SHELF_Q, K_SHELF_GAIN_DB);
+  stage2.designHighPass(fs, K_HIGHPASS_HZ, K_HIGHPASS_Q);
+}
+
+void ShortTermLoudness::reset() {
+  stage1.reset();
+  stage2.reset();
+  for (uint8_t i = 0; i < SHORT_TERM_MAX_HOPS; i++) {
+    ringSquares[i] = 0;
+    ringSamples[i] = 0;
+  }
+  head = 0;
+  hopSquares = 0;
+  totalSquares = 0;
+  totalSamples = 0;
+  level = 0;
+}
+
+void ShortTermLoudness::endHop(uint16_t numSamples) {
+  totalSquares += hopSquares - ringSquares[head];
+  totalSamples += (uint32_t)numSamples - ringSamples[head];
+  ringSquares[head] = hopSquares;
+  ringSamples[head] = numSamples;
+  head = (head + 1) % hopCount;
+  hopSquares = 0;
+
+  if (totalSamples == 0) {
+    level = 0;
+    return;
+  }
+  // p2p of a sine is 2 * sqrt(2) * RMS, i.e. sqrt(8 * mean square)
+  uint32_t amplitude = isqrt64(totalSquares * 8 / totalSamples);
+  level = (uint16_t)(amplitude > 0xFFFF ? 0xFFFF : amplitude);
+}
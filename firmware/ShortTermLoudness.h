@@ -0,0 +1,44 @@
+#ifndef SHORT_TERM_LOUDNESS_H
+#define SHORT_TERM_LOUDNESS_H
+
+#include <stdint.h>
+#include "Biquad.h"
+
+#define SHORT_TERM_BLOCK_MS 400
+#define SHORT_TERM_MAX_HOPS 64
+
+// K-weighted short-term loudness (BS.1770 style) over a sliding 400 ms
+// block. Each hop's sum of squares is kept in a ring, so advancing the
+// block adds the new hop and drops the oldest: O(hop) per window. The
+// result is reported as a peak-to-peak equivalent amplitude (2*sqrt(2)
+// times RMS) in ADC counts so it shares a scale with the other modes.
+class ShortTermLoudness {
+public:
+  explicit ShortTermLoudness(uint8_t hopMillis);
+
+  void configure(uint32_t sampleRateHz);
+  void reset();
+
+  void push(int32_t centeredSample) {
+    int32_t x = stage2.process(stage1.process(centeredSample));
+    hopSquares += (uint64_t)((int64_t)x * x);
+  }
+  void endHop(uint16_t numSamples);
+  uint16_t value() const { return level; }
+
+private:
+  void design();
+  uint8_t hopCount;
+  uint8_t head;
+  uint32_t sampleRateHz;
+  Biquad stage1;
+  Biquad stage2;
+  uint64_t hopSquares;
+  uint64_t ringSquares[SHORT_TERM_MAX_HOPS];
+  uint16_t ringSamples[SHORT_TERM_MAX_HOPS];
+  uint64_t totalSquares;
+  uint32_t totalSamples;
+  uint16_t level;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#include "SppTransport.h"
+
+std::atomic<uint32_t> SppTransport::inFlight(0);
+std::atomic<bool> SppTransport::congested(false);
+uint8_t SppTransport::peer[6];
+
+void SppTransport::begin(const char* deviceName) {
+  serialBT.register_callback(onSppEvent);
+  serialBT.begin(deviceName, false);
+}
+
+int SppTransport::available() {
+  return serialBT.available();
+}
+
+int SppTransport::read() {
+  return serialBT.read();
+}
+
+// Accepts only what fits under SPP_TX_IN_FLIGHT, and nothing while the
+// link reports congestion, so the call never waits on the stack
+size_t SppTransport::write(const uint8_t* data, size_t length) {
+  if (congested.load()) return 0;
+  uint32_t pending = inFlight.load();
+  if (pending >= SPP_TX_IN_FLIGHT) return 0;
+  if (length > SPP_TX_IN_FLIGHT - pending) length = SPP_TX_IN_FLIGHT - pending;
+  inFlight += length;
+  size_t sent = serialBT.write(data, length);
+  if (sent < length) inFlight -= length - sent;
+  return sent;
+}
+
+bool SppTransport::isConnected() {
+  return serialBT.hasClient();
+}
+
+// Set before the connection becomes visible through isConnected()
+bool SppTransport::getPeerAddress(uint8_t address[6]) {
+  memcpy(address, peer, sizeof(peer));
+  return true;
+}
+
+void SppTransport::onSppEvent(esp_spp_cb_event_t event, esp_spp_cb_param_t* param) {
+  switch (event) {
+    case ESP_SPP_WRITE_EVT: {
+      uint32_t done = param->write.len > 0 ? (uint32_t)param->write.len : 0;
+      uint32_t pending = inFlight.load();
+      while (!inFlight.compare_exchange_weak(pending, pending > done ? pending - done : 0)) {
+      }
+      congested = param->write.cong;
+      break;
+    }
+    case ESP_SPP_CONG_EVT:
+      congested = param->cong.cong;
+      break;
+    case ESP_SPP_SRV_OPEN_EVT:
+      memcpy(peer, param->srv_open.rem_bda, sizeof(peer));
+      inFlight = 0;
+      congested = false;
+      break;
+    case ESP_SPP_CLOSE_EVT:
+      inFlight = 0;
+      congested = false;
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef SPP_TRANSPORT_H
+#define SPP_TRANSPORT_H
+
+#include <atomic>
+#include "Arduino.h"
+#include "BluetoothSerial.h"
+#include "Transport.h"
+
+// Bytes handed to BluetoothSerial but not yet confirmed written by the
+// stack. BluetoothSerial::write() blocks once its queue is full, so
+// writes stop at this bound instead.
+#define SPP_TX_IN_FLIGHT 1024
+
+// Bluetooth Classic serial port profile, as used by the Kewlsoft panel
+class SppTransport : public Transport {
+public:
+  void begin(const char* deviceName) override;
+  int available() override;
+  int read() override;
+  size_t write(const uint8_t* data, size_t length) override;
+  bool isConnected() override;
+  bool getPeerAddress(uint8_t address[6]) override;
+
+private:
+  BluetoothSerial serialBT;
+  // Updated from the Bluetooth task through a plain function callback,
+  // so there is one set per sketch
+  static std::atomic<uint32_t> inFlight;
+  static std::atomic<bool> congested;
+  static uint8_t peer[6];
+  static void onSppEvent(esp_spp_cb_event_t event, esp_spp_cb_param_t* param);
+};
+
+#endif
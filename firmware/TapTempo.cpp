@@ -0,0 +1,95 @@
+#include "TapTempo.h"
+
+TapTempo::TapTempo(uint16_t minPeriodMs, uint16_t maxPeriodMs) {
+  this->minPeriodMs = minPeriodMs;
+  this->maxPeriodMs = maxPeriodMs;
+  clear();
+}
+
+void TapTempo::clear() {
+  tapCount = 0;
+  baseMs = 0;
+  anchorQ8 = 0;
+  periodQ8 = 0;
+}
+
+// Returns true once a tempo is known
+bool TapTempo::tap(uint32_t timeMs) {
+  if (tapCount > 0 && timeMs - taps[tapCount - 1] > 2UL * maxPeriodMs) {
+    tapCount = 0;
+  }
+  if (tapCount == TAP_HISTORY) {
+    for (uint8_t i = 1; i < TAP_HISTORY; i++) {
+      taps[i - 1] = taps[i];
+    }
+    tapCount--;
+  }
+  taps[tapCount++] = timeMs;
+  if (tapCount >= TAP_MIN_TAPS) {
+    estimate();
+  }
+  return hasTempo();
+}
+
+void TapTempo::estimate() {
+  uint32_t intervals[TAP_HISTORY - 1];
+  uint8_t n = tapCount - 1;
+  for (uint8_t i = 0; i < n; i++) {
+    uint32_t d = taps[i + 1] - taps[i];
+    uint8_t j = i;
+    for (; j > 0 && intervals[j - 1] > d; j--) {
+      intervals[j] = intervals[j - 1];
+    }
+    intervals[j] = d;
+  }
+  uint32_t median = intervals[n / 2];
+  if (median == 0) return;
+
+  // Beat index per accepted tap, relative to the first tap
+  int64_t sumK = 0, sumT = 0, sumKK = 0, sumKT = 0;
+  uint8_t used = 1;
+  uint32_t lastT = 0;
+  int32_t lastK = 0;
+  for (uint8_t i = 1; i < tapCount; i++) {
+    uint32_t t = taps[i] - taps[0];
+    uint32_t d = t - lastT;
+    uint32_t beats = (d + median / 2) / median;
+    if (beats == 0) continue;
+    int32_t error = (int32_t)d - (int32_t)(beats * median);
+    if (error < 0) error = -error;
+    if ((uint32_t)error * 100 > median * TAP_TOLERANCE_PERCENT) continue;
+    lastK += beats;
+    lastT = t;
+    sumK += lastK;
+    sumT += t;
+    sumKK += (int64_t)lastK * lastK;
+    sumKT += (int64_t)lastK * t;
+    used++;
+  }
+  if (used < TAP_MIN_TAPS) return;
+
+  int64_t denominator = used * sumKK - sumK * sumK;
+  if (denominator <= 0) return;
+  int64_t period = ((used * sumKT - sumK * sumT) << 8) / denominator;
+  if (period < ((int64_t)minPeriodMs << 8) || period > ((int64_t)maxPeriodMs << 8)) return;
+  periodQ8 = (uint32_t)period;
+  baseMs = taps[0];
+  anchorQ8 = ((sumT << 8) - period * sumK) / used;
+}
+
+uint16_t TapTempo::getPeriodMs() const {
+  return (uint16_t)((periodQ8 + 128) >> 8);
+}
+
+uint16_t TapTempo::getBpm() const {
+  if (!hasTempo()) return 0;
+  return (uint16_t)((60000ULL * 256 + periodQ8 / 2) / periodQ8);
+}
+
+// Number of 1/divisions beats since beat 0 of the grid (0 before it)
+uint32_t TapTempo::position(uint32_t nowMs, uint8_t divisions) const {
+  if (!hasTempo() || divisions == 0) return 0;
+  int64_t sinceAnchor = ((int64_t)(int32_t)(nowMs - baseMs) << 8) - anchorQ8;
+  if (sinceAnchor < 0) return 0;
+  return (uint32_t)(sinceAnchor * divisions / periodQ8);
+}
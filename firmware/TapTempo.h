@@ -0,0 +1,39 @@
+#ifndef TAP_TEMPO_H
+#define TAP_TEMPO_H
+
+#include <stdint.h>
+
+#define TAP_HISTORY 8
+#define TAP_MIN_TAPS 3
+#define TAP_TOLERANCE_PERCENT 20
+
+// Beat period and phase from tapped timestamps. Intervals are checked
+// against their median: taps off the grid by more than the tolerance
+// (double taps, stumbles) are dropped, a missed beat counts as two. The
+// remaining taps get a least-squares line, whose slope is the period and
+// whose intercept anchors the beat grid. A pause longer than two maximum
+// periods starts a new sequence; the old tempo holds until the new one
+// has enough taps.
+class TapTempo {
+public:
+  TapTempo(uint16_t minPeriodMs, uint16_t maxPeriodMs);
+
+  void clear();
+  bool tap(uint32_t timeMs);
+  bool hasTempo() const { return periodQ8 != 0; }
+  uint16_t getPeriodMs() const;
+  uint16_t getBpm() const;
+  uint32_t position(uint32_t nowMs, uint8_t divisions) const;
+
+private:
+  void estimate();
+  uint16_t minPeriodMs;
+  uint16_t maxPeriodMs;
+  uint32_t taps[TAP_HISTORY];
+  uint8_t tapCount;
+  uint32_t baseMs;
+  int64_t anchorQ8; // beat 0, in 1/256 ms after baseMs
+  uint32_t periodQ8;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte link under BluetoothElectronics. Implementations must not block:
+// read() is only called while available() > 0, and write() may accept
+// fewer bytes than offered when the link is congested. Links that can
+// identify the connected device report its 6-byte address.
+class Transport {
+public:
+  virtual ~Transport() {}
+  virtual void begin(const char* deviceName) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual size_t write(const uint8_t* data, size_t length) = 0;
+  virtual bool isConnected() = 0;
+  virtual bool getPeerAddress(uint8_t address[6]) { return false; }
+};
+
+#endif
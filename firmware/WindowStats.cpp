@@ -0,0 +1,30 @@
+#include "WindowStats.h"
+#include <math.h>
+
+void WindowStats::reset() {
+  min = UINT16_MAX;
+  max = 0;
+  sum = 0;
+  sumSquares = 0;
+  count = 0;
+}
+
+void WindowStats::addBlock(const uint16_t* samples, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    addSquared(samples[i]);
+  }
+}
+
+// 0 for an empty window
+uint16_t WindowStats::peakToPeak() const {
+  return max > min ? max - min : 0;
+}
+
+// Standard deviation in ADC counts
+uint16_t WindowStats::deviation() const {
+  if (count == 0) return 0;
+  uint64_t meanSquare = sumSquares / count;
+  uint64_t mean = sum / count;
+  uint64_t variance = meanSquare > mean * mean ? meanSquare - mean * mean : 0;
+  return (uint16_t)sqrtf((float)variance);
+}
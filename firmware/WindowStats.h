@@ -0,0 +1,31 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <stdint.h>
+
+// Single-pass reduction of one window of ADC samples: min, max, sum and,
+// only through addSquared(), the sum of squares the deviation needs.
+struct WindowStats {
+  uint16_t min;
+  uint16_t max;
+  uint32_t sum;
+  uint64_t sumSquares;
+  uint16_t count;
+
+  void reset();
+  void add(uint16_t sample) {
+    if (sample < min) min = sample;
+    if (sample > max) max = sample;
+    sum += sample;
+    count++;
+  }
+  void addSquared(uint16_t sample) {
+    add(sample);
+    sumSquares += (uint32_t)sample * sample;
+  }
+  void addBlock(const uint16_t* samples, uint16_t length);
+  uint16_t peakToPeak() const;
+  uint16_t deviation() const;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "WireMask.h"
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+  // All 8-bit masks ordered by popcount, ascending within each popcount.
+  // Masks confined to the low n bits form a prefix of their popcount group,
+  // so the first binomial(n, k) entries after maskOffset[k] are exactly the
+  // k-of-n subsets.
+  const uint8_t masksByPopcount[256] = {
+    0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x03, 0x05, 0x06, 0x09, 0x0A, 0x0C, 0x11,
+    0x12, 0x14, 0x18, 0x21, 0x22, 0x24, 0x28, 0x30, 0x41, 0x42, 0x44, 0x48, 0x50, 0x60, 0x81, 0x82,
+    0x84, 0x88, 0x90, 0xA0, 0xC0, 0x07, 0x0B, 0x0D, 0x0E, 0x13, 0x15, 0x16, 0x19, 0x1A, 0x1C, 0x23,
+    0x25, 0x26, 0x29, 0x2A, 0x2C, 0x31, 0x32, 0x34, 0x38, 0x43, 0x45, 0x46, 0x49, 0x4A, 0x4C, 0x51,
+    0x52, 0x54, 0x58, 0x61, 0x62, 0x64, 0x68, 0x70, 0x83, 0x85, 0x86, 0x89, 0x8A, 0x8C, 0x91, 0x92,
+    0x94, 0x98, 0xA1, 0xA2, 0xA4, 0xA8, 0xB0, 0xC1, 0xC2, 0xC4, 0xC8, 0xD0, 0xE0, 0x0F, 0x17, 0x1B,
+    0x1D, 0x1E, 0x27, 0x2B, 0x2D, 0x2E, 0x33, 0x35, 0x36, 0x39, 0x3A, 0x3C, 0x47, 0x4B, 0x4D, 0x4E,
+    0x53, 0x55, 0x56, 0x59, 0x5A, 0x5C, 0x63, 0x65, 0x66, 0x69, 0x6A, 0x6C, 0x71, 0x72, 0x74, 0x78,
+    0x87, 0x8B, 0x8D, 0x8E, 0x93, 0x95, 0x96, 0x99, 0x9A, 0x9C, 0xA3, 0xA5, 0xA6, 0xA9, 0xAA, 0xAC,
+    0xB1, 0xB2, 0xB4, 0xB8, 0xC3, 0xC5, 0xC6, 0xC9, 0xCA, 0xCC, 0xD1, 0xD2, 0xD4, 0xD8, 0xE1, 0xE2,
+    0xE4, 0xE8, 0xF0, 0x1F, 0x2F, 0x37, 0x3B, 0x3D, 0x3E, 0x4F, 0x57, 0x5B, 0x5D, 0x5E, 0x67, 0x6B,
+    0x6D, 0x6E, 0x73, 0x75, 0x76, 0x79, 0x7A, 0x7C, 0x8F, 0x97, 0x9B, 0x9D, 0x9E, 0xA7, 0xAB, 0xAD,
+    0xAE, 0xB3, 0xB5, 0xB6, 0xB9, 0xBA, 0xBC, 0xC7, 0xCB, 0xCD, 0xCE, 0xD3, 0xD5, 0xD6, 0xD9, 0xDA,
+    0xDC, 0xE3, 0xE5, 0xE6, 0xE9, 0xEA, 0xEC, 0xF1, 0xF2, 0xF4, 0xF8, 0x3F, 0x5F, 0x6F, 0x77, 0x7B,
+    0x7D, 0x7E, 0x9F, 0xAF, 0xB7, 0xBB, 0xBD, 0xBE, 0xCF, 0xD7, 0xDB, 0xDD, 0xDE, 0xE7, 0xEB, 0xED,
+    0xEE, 0xF3, 0xF5, 0xF6, 0xF9, 0xFA, 0xFC, 0x7F, 0xBF, 0xDF, 0xEF, 0xF7, 0xFB, 0xFD, 0xFE, 0xFF
+  };
+
+  const uint8_t maskOffset[WIRE_MASK_MAX_CHANNELS + 1] = { 0, 1, 9, 37, 93, 163, 219, 247, 255 };
+
+  const uint8_t binomials[WIRE_MASK_MAX_CHANNELS + 1][WIRE_MASK_MAX_CHANNELS + 1] = {
+    { 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+    { 1, 2, 1, 0, 0, 0, 0, 0, 0 },
+    { 1, 3, 3, 1, 0, 0, 0, 0, 0 },
+    { 1, 4, 6, 4, 1, 0, 0, 0, 0 },
+    { 1, 5, 10, 10, 5, 1, 0, 0, 0 },
+    { 1, 6, 15, 20, 15, 6, 1, 0, 0 },
+    { 1, 7, 21, 35, 35, 21, 7, 1, 0 },
+    { 1, 8, 28, 56, 70, 56, 28, 8, 1 }
+  };
+}
+
+uint8_t WireMask::fullMask(uint8_t count) {
+  if (count >= WIRE_MASK_MAX_CHANNELS) return 0xFF;
+  return (uint8_t)((1U << count) - 1);
+}
+
+uint8_t WireMask::popcount(uint8_t mask) {
+#if defined(__GNUC__)
+  return (uint8_t)__builtin_popcount(mask);
+#else
+  // Host builds with other compilers (the simulator's extension on MSVC)
+  uint8_t count = 0;
+  for (; mask; mask &= (uint8_t)(mask - 1)) count++;
+  return count;
+#endif
+}
+
+uint8_t WireMask::binomial(uint8_t n, uint8_t k) {
+  if (n > WIRE_MASK_MAX_CHANNELS || k > n) return 0;
+  return binomials[n][k];
+}
+
+// Uniformly chosen mask with exactly k of the low `count` bits set.
+uint8_t WireMask::randomMask(FastRandom& rng, uint8_t count, uint8_t k) {
+  if (count > WIRE_MASK_MAX_CHANNELS) count = WIRE_MASK_MAX_CHANNELS;
+  if (k > count) k = count;
+  return masksByPopcount[maskOffset[k] + rng.below(binomials[count][k])];
+}
+
+// Scatters the low bits of src onto the set bits of mask, lowest first
+// (pdep). Bounded by the eight mask bits, so it runs in constant time.
+uint8_t WireMask::depositBits(uint8_t src, uint8_t mask) {
+#if defined(__BMI2__)
+  return (uint8_t)_pdep_u32(src, mask);
+#else
+  uint8_t out = 0;
+  while (mask) {
+    uint8_t lowest = mask & (uint8_t)-mask;
+    if (src & 1) out |= lowest;
+    src >>= 1;
+    mask &= (uint8_t)(mask - 1);
+  }
+  return out;
+#endif
+}
+
+// Turns off k uniformly chosen lit wires and turns on k uniformly chosen
+// dark wires, keeping the lit count. k is clamped to what is available.
+uint8_t WireMask::swapBits(FastRandom& rng, uint8_t mask, uint8_t count, uint8_t k) {
+  uint8_t full = fullMask(count);
+  mask &= full;
+  uint8_t dark = full & (uint8_t)~mask;
+  uint8_t litCount = popcount(mask);
+  uint8_t darkCount = popcount(dark);
+  if (k > litCount) k = litCount;
+  if (k > darkCount) k = darkCount;
+
+  uint8_t turnOff = depositBits(randomMask(rng, litCount, k), mask);
+  uint8_t turnOn = depositBits(randomMask(rng, darkCount, k), dark);
+  return mask ^ turnOff ^ turnOn;
+}
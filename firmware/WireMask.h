@@ -0,0 +1,19 @@
+#ifndef WIRE_MASK_H
+#define WIRE_MASK_H
+
+#include <stdint.h>
+#include "FastRandom.h"
+
+// Bit i of a wire mask is channel i in sequencer order.
+#define WIRE_MASK_MAX_CHANNELS 8
+
+namespace WireMask {
+  uint8_t fullMask(uint8_t count);
+  uint8_t popcount(uint8_t mask);
+  uint8_t binomial(uint8_t n, uint8_t k);
+  uint8_t randomMask(FastRandom& rng, uint8_t count, uint8_t k);
+  uint8_t depositBits(uint8_t src, uint8_t mask);
+  uint8_t swapBits(FastRandom& rng, uint8_t mask, uint8_t count, uint8_t k);
+}
+
+#endif
@@ -5,6 +5,7 @@
 // LoudnessMeter
 #include "LoudnessMeter.h"
 #define MIC_OUT 35
+#define MIC_INPUTS 1 // up to MAX_MIC_INPUTS, listed in micInputs
 #define MIC_GAIN 32
 #define MIC_SAMPLE_WINDOW 14 // ms
 #define DEFAULT_P2P_LOW 800
@@ -16,16 +17,59 @@ LoudnessMeter mic = LoudnessMeter(
   MIC_OUT, MIC_GAIN, MIC_SAMPLE_WINDOW,
   DEFAULT_P2P_LOW, DEFAULT_P2P_HIGH,
   DEFAULT_RMS_LOW, DEFAULT_RMS_HIGH);
+#include "LevelQuantizer.h"
+#define LEVEL_HYSTERESIS 25 // % of a step
+LevelQuantizer quantizer = LevelQuantizer(MAX_MAPPED_VALUE, LEVEL_HYSTERESIS);
+const uint8_t micInputs[MIC_INPUTS] = { MIC_OUT };
 uint16_t mappedSignal;
 
+// Automatic gain control
+#include "AutoGain.h"
+#define AGC_PERIOD_MS 3000
+#define AGC_MAX_CLIP_PERMILLE 5
+#define AGC_RAISE_HEADROOM 2800 // peak must stay below this after raising
+#define GAIN_STEP_NUMERATOR 3162 // 10 dB per MAX9814 gain step
+#define GAIN_STEP_DENOMINATOR 1000
+AutoGain agc = AutoGain(
+  AGC_PERIOD_MS, AGC_MAX_CLIP_PERMILLE, AGC_RAISE_HEADROOM,
+  GAIN_STEP_NUMERATOR, GAIN_STEP_DENOMINATOR);
+boolean autoGainEnabled = false;
+
 // Bluetooth
 #include "BluetoothElectronics.h"
 #define DEVICE_NAME "LOLIN32 Lite"
-BluetoothElectronics bluetooth = BluetoothElectronics(DEVICE_NAME);
+#define TX_COALESCED_KEYS "GSMLH" // only the latest queued value is sent
+#define USE_BLE 0 // BLE GATT (Nordic UART) via NimBLE-Arduino instead of Classic SPP
+#define USE_SERIAL_INPUT 0 // commands and telemetry over USB serial instead
+#if USE_SERIAL_INPUT
+#include "SerialTransport.h"
+SerialTransport transport = SerialTransport(Serial, DEBUG_BAUD_RATE);
+#elif USE_BLE
+#include "BleTransport.h"
+BleTransport transport;
+#else
+#include "SppTransport.h"
+SppTransport transport;
+#endif
+BluetoothElectronics bluetooth = BluetoothElectronics(DEVICE_NAME, transport);
+#include "KwlPanel.h" // generate-kwl-panel output
+#include "PanelSync.h"
+PanelSync panelSync = PanelSync(KWL_PANEL, KWL_PANEL_HASH);
+static_assert(sizeof(KWL_PANEL) + 8 <= TX_QUEUE_MAX_BYTES
+  && (sizeof(KWL_PANEL) + PANEL_SYNC_CHUNK - 1) / PANEL_SYNC_CHUNK + 2 <= TX_QUEUE_SLOTS,
+  "the panel must fit in the Bluetooth output queue in one piece");
+#include "PanelState.h"
+enum PanelField : uint8_t {
+  FIELD_MODE, FIELD_SETTING, FIELD_GAIN, FIELD_SAMPLING, FIELD_LOW, FIELD_HIGH,
+  FIELD_TELEMETRY, FIELD_AUTO_GAIN, FIELD_FRONT_END, FIELD_CURVE, FIELD_BAND, FIELD_COMBINER,
+  FIELD_TEMPO
+};
+#define PANEL_FIELD_KEYS "MSNPLHDAFCBXY" // receive char per PanelField
+PanelState panelState = PanelState(PANEL_FIELD_KEYS);
 
 // EL Sequencer
 #include "ELSequencer.h"
-#include "ModeRegistry.h"
+#include "WireMask.h"
 #define CHANNEL_A 13
 #define CHANNEL_B 15
 #define CHANNEL_C 2
@@ -39,20 +83,55 @@ const uint8_t channelOrder[ACTIVE_CHANNELS] = {
   CHANNEL_C, CHANNEL_D, CHANNEL_B, CHANNEL_A, CHANNEL_H, CHANNEL_G, CHANNEL_E, CHANNEL_F
 };
 ELSequencer sequencer = ELSequencer(channelOrder, ACTIVE_CHANNELS);
-uint8_t mode = 0;
-uint8_t numWires = 8;
 #define NUM_DELAYS 10
 uint16_t periodicModeDelays[NUM_DELAYS] = { 10, 25, 33, 50, 66, 100, 166, 250, 500, 1000 };
 uint8_t currentDelayIndex = 1;
 uint32_t timer = 0;
 #define ADDITIONAL_GND_PIN 18
 
+// Tap tempo for periodic modes
+#include "TapTempo.h"
+#define TAP_MIN_PERIOD_MS 200 // 300 BPM
+#define TAP_MAX_PERIOD_MS 1500 // 40 BPM
+TapTempo tapTempo = TapTempo(TAP_MIN_PERIOD_MS, TAP_MAX_PERIOD_MS);
+
+// Light modes, shared with the simulator
+#include "ModeEngine.h"
+#define ENVELOPE_ATTACK_MS 0 // decay modes, per level, 0 = jump to peaks
+ModeEngine engine = ModeEngine(ACTIVE_CHANNELS, ENVELOPE_ATTACK_MS);
+
+// Flight recorder
+#include "FlightRecorder.h"
+#define FLIGHT_RECORDER_BLOCKS 128 // x FLIGHT_BLOCK_SIZE bytes of RAM
+#define FLIGHT_DUMP_CHUNK 48 // bytes per Bluetooth line while dumping
+FlightRecorder recorder = FlightRecorder(FLIGHT_RECORDER_BLOCKS);
+uint16_t lastLoopMs = 0;
+
+// Waveform capture
+#include "RiceCodec.h"
+#define CAPTURE_MAX_SAMPLES 1024 // per window
+#define CAPTURE_MAX_FRAME 2048
+// Base64 capture needs ~25 KB/s, so the send-rate limit is lifted to this
+// while it runs and restored afterwards
+#define CAPTURE_BYTES_PER_SECOND 32000
+uint16_t captureSamples[CAPTURE_MAX_SAMPLES];
+boolean captureToBluetooth = false;
+uint16_t sendRateBeforeCapture = 0;
+uint16_t captureSkipped = 0;
+
 // Push-Buttons
 #if USE_PUSH_BUTTONS
 #include "PushButtons.h"
 #define BUTTON_1_PIN 25
+#define BUTTON_2_PIN 26
+#define PUSH_BUTTONS 2 // up to MAX_PUSH_BUTTONS, listed in buttonPins
 #define DEBOUNCE_MS 5
-#define BUTTON_PAUSE_MS 1000
+#define DOUBLE_CLICK_MS 300
+#define LONG_PRESS_MS 600
+#define TAP_BUTTON 1
+const uint8_t buttonPins[] = { BUTTON_1_PIN, BUTTON_2_PIN };
+static_assert(PUSH_BUTTONS <= sizeof(buttonPins) && PUSH_BUTTONS <= MAX_PUSH_BUTTONS, "a pin for every push button");
+static_assert(TAP_BUTTON < PUSH_BUTTONS, "the tap button must be one of the push buttons");
 #endif
 
 void setup() {
@@ -60,15 +139,24 @@ void setup() {
   Serial.begin(DEBUG_BAUD_RATE);
 #endif
   registerBluetoothCommands();
+  bluetooth.setInputListener(recordCommand);
+  bluetooth.setCoalescedKeys(TX_COALESCED_KEYS);
+  bluetooth.setConnectListener(onBluetoothConnect);
   bluetooth.begin();
+  mic.setInputs(micInputs, MIC_INPUTS);
+  mic.setGainStep(GAIN_STEP_NUMERATOR, GAIN_STEP_DENOMINATOR);
   mic.begin();
+  updateQuantizerRange();
 #if USE_RADIO
   initRadio();
 #endif
 #if USE_PUSH_BUTTONS
-  pushButtonsBegin(BUTTON_1_PIN, DEBOUNCE_MS, BUTTON_PAUSE_MS);
+  pushButtonsBegin(buttonPins, PUSH_BUTTONS, DEBOUNCE_MS, DOUBLE_CLICK_MS, LONG_PRESS_MS);
 #endif
   sequencer.begin();
+  engine.seed(esp_random());
+  engine.setDelay(currentDelay());
+  engine.setTapTempo(&tapTempo);
   pinMode(ADDITIONAL_GND_PIN, OUTPUT);
   digitalWrite(ADDITIONAL_GND_PIN, LOW);
 #if DEBUG
@@ -80,339 +168,354 @@ boolean outputToBluetooth = false;
 uint32_t loopBegin = 0;
 
 void loop() {
-  loopBegin = millis();
+  uint32_t now = millis();
+  lastLoopMs = (uint16_t)min(now - loopBegin, (uint32_t)0xFFFF);
+  loopBegin = now;
 #if USE_PUSH_BUTTONS
   pushButtonsUpdate(loopBegin);
-  if (pushButtonsShouldSkipLoop()) {
-    if (pushButtonConsumePressed()) {
-      periodicFlashWithDecay();
-    }
-    return;
-  }
+  handleButtonEvents();
 #endif
   bluetooth.handleInput();
-  if (isReactive(mode)) {
+  panelSync.update(bluetooth);
+  if (!panelSync.isPushing()) {
+    sendPanelState();
+  }
+  bool panelWaiting = panelSync.isWaitingForRoom();
+  if (recorder.isDumping() && !panelWaiting && bluetooth.hasQueueSpace(FLIGHT_DUMP_CHUNK * 2 + 16, 2)) {
+    sendFlightRecorderChunk();
+  }
+  if (isReactive(engine.getMode())) {
     mic.readAudioSample();
+    if (autoGainEnabled) {
+      runAutoGain();
+    }
     processSample();
-    modes[mode].run();
-    if (outputToBluetooth) {
+    if (mic.getCombiner() == LoudnessMeter::COMBINE_SPATIAL) {
+      runSpatial();
+    } else {
+      runMode();
+    }
+    if (captureToBluetooth) {
+      sendCapturedWindow();
+    }
+    recorder.recordWindow(loopBegin, mic.getSignal(), mappedSignal, sequencer.getCurrentMask(), lastLoopMs);
+    if (outputToBluetooth && !panelWaiting) {
       printToBluetooth();
     }
 #if DEBUG
     printToSerialMonitor();
 #endif
   } else {
-    modes[mode].run();
+    runMode();
   }
 }
 
-// ---------------- MODE DEFINITIONS ----------------
-const Mode modes[] = {
-  { "rPulse", ModeType::Reactive, reactivePulse, nullptr },
-  { "rPulseDecay", ModeType::Reactive, reactivePulseWithDecay, nullptr },
-  { "rBeatPulseDecay", ModeType::Reactive, reactiveBeatPulseDecay, nullptr },
-  { "rRandom", ModeType::Reactive, reactiveRandomSimple, nullptr },
-  { "rRandomSwap", ModeType::Reactive, reactiveRandomSwap, nullptr },
-  { "rRandomHL", ModeType::Reactive, reactiveRandomHighLow, nullptr },
-  { "rLinearSweep", ModeType::Reactive, reactiveLinearSweep, nullptr },
-  { "pPulseUp", ModeType::Periodic, periodicPulseUp, nullptr },
-  { "pPulseUpDown", ModeType::Periodic, periodicPulseUpDown, nullptr },
-  { "pFlash", ModeType::Periodic, periodicFlash, nullptr },
-  { "pFlashDecay", ModeType::Periodic, periodicFlashWithDecay, nullptr },
-  { "pRandom", ModeType::Periodic, periodicRandom, nullptr },
-};
+// ---------------- MODES ----------------
+void runMode() {
+  if (engine.run(mappedSignal, millis())) {
+    sequencer.lightWiresByMask(engine.getMask());
+  }
+}
 
-uint8_t getModeCount() {
-  return (uint8_t)(sizeof(modes) / sizeof(modes[0]));
+// Each microphone input drives its own group of wires as a level bar
+void runSpatial() {
+  uint8_t inputs = mic.getInputCount();
+  uint8_t groupSize = ACTIVE_CHANNELS / inputs;
+  uint8_t mask = 0;
+  for (uint8_t g = 0; g < inputs; g++) {
+    uint8_t level = quantizer.levelFor(mic.getChannelSignal(g));
+    uint8_t lit = (level * groupSize + MAX_MAPPED_VALUE - 1) / MAX_MAPPED_VALUE;
+    mask |= (uint8_t)(WireMask::fullMask(lit) << (g * groupSize));
+  }
+  engine.setMask(mask);
+  sequencer.lightWiresByMask(mask);
 }
 
-bool isReactive(uint8_t idx) {
-  if (idx >= getModeCount()) return false;
-  return modes[idx].type == ModeType::Reactive;
+void tapBeat(uint32_t timeMs) {
+  tapTempo.tap(timeMs);
+  panelState.mark(FIELD_TEMPO);
 }
 
-void reactivePulse() {
-  if (numWires == 1) {
-    mappedSignal > 0 ? sequencer.lightWiresAtIndex(mappedSignal - 1) : sequencer.lightNumWires(0);
-  } else if (numWires == ACTIVE_CHANNELS) {
-    sequencer.lightNumWires(mappedSignal);
-  } else {
-    sequencer.lightNumWiresUpToWire(numWires, mappedSignal);
-  }
+void clearTempo() {
+  tapTempo.clear();
+  engine.restartPeriodic();
+  panelState.mark(FIELD_TEMPO);
 }
 
-uint16_t displayLevel = 0;
-uint32_t lastDecayMs = 0;
-void reactivePulseWithDecay() {
-  if (mappedSignal > displayLevel) {
-    displayLevel = mappedSignal;
-    lastDecayMs = millis();
-  } else {
-    if (displayLevel > 0) {
-      uint32_t now = millis();
-      uint16_t releaseMs = currentDelay();
-      if (releaseMs == 0) {
-        releaseMs = MIC_SAMPLE_WINDOW;
-      }
-      if (now - lastDecayMs >= releaseMs) {
-        displayLevel -= 1;
-        lastDecayMs = now;
+// ---------------- PUSH BUTTONS ----------------
+#if USE_PUSH_BUTTONS
+// Button 1: click for the next mode, double click for the next setting,
+// long press for the previous one. Button 2 is the tap-tempo button: each
+// press is a tap (with its ISR time), a long press drops the tempo.
+// Pressing both toggles AGC.
+void handleButtonEvents() {
+  ButtonEvent event;
+  while (pushButtonsPoll(event)) {
+    if (event.button == TAP_BUTTON && event.gesture != ButtonGesture::Chord) {
+      if (event.gesture == ButtonGesture::Press) {
+        tapBeat(event.timeMs);
+      } else if (event.gesture == ButtonGesture::LongPress) {
+        clearTempo();
       }
+      continue;
+    }
+    switch (event.gesture) {
+      case ButtonGesture::Click:
+        nextMode();
+        break;
+      case ButtonGesture::DoubleClick:
+        nextSetting();
+        break;
+      case ButtonGesture::LongPress:
+        prevSetting();
+        break;
+      case ButtonGesture::Chord:
+        if (autoGainEnabled) {
+          cmdAutoGainOff("");
+        } else {
+          cmdAutoGainOn("");
+        }
+        break;
+      case ButtonGesture::Press:
+        break;
     }
   }
-  sequencer.lightNumWiresUpToWire(numWires, displayLevel);
 }
+#endif
 
-uint16_t beatDisplayLevel = 0;
-uint32_t beatLastDecayMs = 0;
-void reactiveBeatPulseDecay() {
-  const uint8_t THRESHOLD = 6;
-
-  if (mappedSignal >= THRESHOLD && mappedSignal > beatDisplayLevel) {
-    beatDisplayLevel = mappedSignal;
-    beatLastDecayMs = millis();
-  } else {
-    if (beatDisplayLevel > 0) {
-      uint32_t now = millis();
-      uint16_t releaseMs = currentDelay();
-      if (releaseMs == 0) {
-        releaseMs = MIC_SAMPLE_WINDOW;
-      }
-      if (now - beatLastDecayMs >= releaseMs) {
-        beatDisplayLevel -= 1;
-        beatLastDecayMs = now;
-      }
-    }
-  }
+// ---------------- BLUETOOTH COMMANDS ----------------
+constexpr KwlCommand bluetoothCommandList[] = {
+  { "L", cmdSetLow, true },
+  { "H", cmdSetHigh, true },
+  { "D", cmdDebugOn, false },
+  { "d", cmdDebugOff, false },
+  { "S", cmdSetSamplingP2P, false },
+  { "s", cmdSetSamplingRMS, false },
+  { "K", cmdSetSamplingLoudness, false },
+  { "N", cmdSetGain, true },
+  { "C", cmdSetCurve, true },
+  { "A", cmdAutoGainOn, false },
+  { "a", cmdAutoGainOff, false },
+  { "F", cmdFrontEndOn, false },
+  { "f", cmdFrontEndOff, false },
+  { "B", cmdSetFilterBand, true },
+  { "X", cmdSetCombiner, true },
+  { "R", cmdDumpRecorder, false },
+  { "r", cmdClearRecorder, false },
+  { "W", cmdCaptureOn, false },
+  { "w", cmdCaptureOff, false },
+  { "T", cmdSetSendRate, true },
+  { "t", cmdSendStats, false },
+  { "U", cmdPushPanel, false },
+  { "Y", cmdTapTempo, false },
+  { "y", cmdClearTempo, false },
+  { "V", cmdSetModeParam, false },
+  { "v", cmdSendModeParams, false },
+  { "1", cmdUp, false },
+  { "3", cmdDown, false },
+  { "2", cmdRight, false },
+  { "4", cmdLeft, false },
+};
+constexpr auto bluetoothCommands = makeCommandTable(bluetoothCommandList);
 
-  sequencer.lightNumWiresUpToWire(numWires, beatDisplayLevel);
+void registerBluetoothCommands() {
+  bluetooth.setCommands(bluetoothCommands.index());
 }
 
-void reactiveRandomSimple() {
-  static uint16_t last = 0;
-  bool rising = mappedSignal > last;
-  last = mappedSignal;
-  if (rising && mappedSignal > 6) {
-    sequencer.lightNumRandomWires(numWires);
-  }
+void cmdSetLow(const String& p) {
+  uint16_t v = p.toInt();
+  if (v >= mic.getHigh()) v = mic.getHigh() - 1;
+  mic.setLow(v);
+  updateQuantizerRange();
+  panelState.mark(FIELD_LOW);
 }
 
-void reactiveRandomSwap() {
-  static uint16_t last = 0;
-  static uint8_t lastNumWires = 0;
-  
-  bool rising = mappedSignal > last;
-  last = mappedSignal;
-  
-  if (rising && mappedSignal > 6) {
-    // Get current pattern
-    uint8_t pattern[ACTIVE_CHANNELS];
-    sequencer.getCurrentPattern(pattern);
-    
-    // Count lit wires
-    uint8_t litCount = 0;
-    for (uint8_t i = 0; i < ACTIVE_CHANNELS; i++) {
-      if (pattern[i] == 1) litCount++;
-    }
-    
-    // If wrong number of wires lit or numWires changed, start fresh
-    if (litCount != numWires || lastNumWires != numWires) {
-      sequencer.lightNumRandomWires(numWires);
-      lastNumWires = numWires;
-      return;
-    }
-    
-    // Calculate how many to swap based on available wires
-    uint8_t darkCount = ACTIVE_CHANNELS - litCount;
-    uint8_t swapCount = (litCount >= 2 && darkCount >= 2) ? 2 : 1;
-    
-    // Pick positions to turn on (from dark wires)
-    uint8_t newOn[2];
-    for (uint8_t i = 0; i < swapCount; i++) {
-      newOn[i] = random(ACTIVE_CHANNELS);
-      uint8_t attempts = 0;
-      while (pattern[newOn[i]] == 1 && attempts++ < ACTIVE_CHANNELS) {
-        newOn[i] = (newOn[i] + 1) % ACTIVE_CHANNELS;
-      }
-      // Mark as occupied so next one doesn't pick it
-      if (i == 0 && swapCount == 2) pattern[newOn[i]] = 2;
-    }
-    if (swapCount == 2) pattern[newOn[0]] = 1; // Restore original value
-    
-    // Pick positions to turn off (from lit wires)
-    uint8_t newOff[2];
-    for (uint8_t i = 0; i < swapCount; i++) {
-      newOff[i] = random(ACTIVE_CHANNELS);
-      uint8_t attempts = 0;
-      while (pattern[newOff[i]] == 0 && attempts++ < ACTIVE_CHANNELS) {
-        newOff[i] = (newOff[i] + 1) % ACTIVE_CHANNELS;
-      }
-      // Mark as occupied so next one doesn't pick it
-      if (i == 0 && swapCount == 2) pattern[newOff[i]] = 0;
-    }
-    if (swapCount == 2) pattern[newOff[0]] = 1; // Restore original value
-    
-    // Apply changes
-    for (uint8_t i = 0; i < swapCount; i++) {
-      pattern[newOn[i]] = 1;
-      pattern[newOff[i]] = 0;
-    }
-    
-    // Set the new pattern
-    sequencer.lightWiresByPattern(pattern);
-  }
+void cmdSetHigh(const String& p) {
+  uint16_t v = p.toInt();
+  if (v <= mic.getLow()) v = mic.getLow() + 1;
+  mic.setHigh(v);
+  updateQuantizerRange();
+  panelState.mark(FIELD_HIGH);
 }
 
-void reactiveRandomHighLow() {
-  static uint16_t last = 0;
-  static uint32_t lastHighMs = 0;
+void cmdDebugOn(const String&) {
+  outputToBluetooth = true;
+  panelState.mark(FIELD_TELEMETRY);
+}
 
-  const uint8_t TH_MED = 2;
-  const uint8_t TH_HIGH = 7;
-  const uint32_t LOW_MODE_COOLDOWN_MS = 1000;
+void cmdDebugOff(const String&) {
+  outputToBluetooth = false;
+  panelState.mark(FIELD_TELEMETRY);
+}
 
-  uint16_t cur = mappedSignal;
-  uint32_t now = millis();
-  bool rising = cur > last;
-  last = cur;
+void cmdSetSamplingP2P(const String&) {
+  mic.setMode(LoudnessMeter::PEAK_TO_PEAK);
+  updateQuantizerRange();
+  markSamplingChanged();
+}
 
-  if (!rising) return;
+void cmdSetSamplingRMS(const String&) {
+  mic.setMode(LoudnessMeter::RMS);
+  updateQuantizerRange();
+  markSamplingChanged();
+}
 
-  if (cur >= TH_HIGH) {
-    lastHighMs = now;
-    uint8_t k = (numWires > ACTIVE_CHANNELS) ? ACTIVE_CHANNELS : numWires;
-    sequencer.lightNumRandomWires(k);
-    return;
-  }
+void cmdSetSamplingLoudness(const String&) {
+  mic.setMode(LoudnessMeter::LOUDNESS);
+  updateQuantizerRange();
+  markSamplingChanged();
+}
 
-  if (cur >= TH_MED && (now - lastHighMs) >= LOW_MODE_COOLDOWN_MS) {
-    sequencer.lightNumRandomWires(1);
+void cmdSetGain(const String& parameter) {
+  int gain = parameter.toInt();
+  if (gain == 1) {
+    mic.setGain(LoudnessMeter::LOW_GAIN);
+  } else if (gain == 2) {
+    mic.setGain(LoudnessMeter::MEDIUM_GAIN);
+  } else if (gain == 3) {
+    mic.setGain(LoudnessMeter::HIGH_GAIN);
   }
+  agc.reset(millis());
+  updateQuantizerRange();
+  panelState.mark(FIELD_GAIN);
+  panelState.mark(FIELD_LOW);
+  panelState.mark(FIELD_HIGH);
 }
 
-void reactiveLinearSweep() {
-  static uint16_t last = 0;
-  static uint8_t startIndex = 0;
-
-  const uint8_t THRESHOLD = 6;
+void cmdAutoGainOn(const String&) {
+  autoGainEnabled = true;
+  agc.reset(millis());
+  panelState.mark(FIELD_AUTO_GAIN);
+}
 
-  uint16_t cur = mappedSignal;
-  bool rising = cur > last;
-  last = cur;
+void cmdAutoGainOff(const String&) {
+  autoGainEnabled = false;
+  panelState.mark(FIELD_AUTO_GAIN);
+}
 
-  if (!rising || cur <= THRESHOLD) return;
+void cmdFrontEndOn(const String&) {
+  mic.setFrontEnd(true);
+  panelState.mark(FIELD_FRONT_END);
+}
 
-  uint8_t pattern[ACTIVE_CHANNELS];
-  for (uint8_t i = 0; i < ACTIVE_CHANNELS; i++) {
-    pattern[i] = 0;
-  }
+void cmdFrontEndOff(const String&) {
+  mic.setFrontEnd(false);
+  panelState.mark(FIELD_FRONT_END);
+}
 
-  for (uint8_t k = 0; k < numWires; k++) {
-    uint8_t idx = (startIndex + k) % ACTIVE_CHANNELS;
-    pattern[idx] = 1;
+void cmdSetFilterBand(const String& parameter) {
+  int band = parameter.toInt();
+  if (band == 0) {
+    mic.setFilterBand(FilterChain::OFF);
+  } else if (band == 1) {
+    mic.setFilterBand(FilterChain::WIDEBAND);
+  } else if (band == 2) {
+    mic.setFilterBand(FilterChain::BASS);
   }
-
-  startIndex = (startIndex + 1) % ACTIVE_CHANNELS;
-
-  sequencer.lightWiresByPattern(pattern);
+  panelState.mark(FIELD_BAND);
 }
 
-void periodicPulseUp() {
-  for (int i = 0; i <= ACTIVE_CHANNELS; i++) {
-    sequencer.lightWiresAtIndex(i);
-    delay(currentDelay());
+void cmdSetCombiner(const String& parameter) {
+  int combiner = parameter.toInt();
+  if (combiner == 1) {
+    mic.setCombiner(LoudnessMeter::COMBINE_MAX);
+  } else if (combiner == 2) {
+    mic.setCombiner(LoudnessMeter::COMBINE_MEAN);
+  } else if (combiner == 3) {
+    mic.setCombiner(LoudnessMeter::COMBINE_SPATIAL);
   }
+  panelState.mark(FIELD_COMBINER);
 }
 
-void periodicPulseUpDown() {
-  for (int i = 0; i <= ACTIVE_CHANNELS - 1; i++) {
-    sequencer.lightWiresAtIndex(i);
-    delay(currentDelay());
-  }
-  for (int i = ACTIVE_CHANNELS - 2; i >= 1; i--) {
-    sequencer.lightWiresAtIndex(i);
-    delay(currentDelay());
+void cmdDumpRecorder(const String&) {
+  recorder.beginDump();
+  if (!recorder.isDumping()) {
+    bluetooth.sendKwlString("END", "R");
   }
 }
 
-void periodicFlash() {
-  sequencer.lightAll();
-  delay(currentDelay());
-  sequencer.lightNone();
-  delay(currentDelay());
+void cmdClearRecorder(const String&) {
+  recorder.clear();
 }
 
-void periodicFlashWithDecay() {
-  sequencer.lightAll();
-  delay(currentDelay());
-  for (int i = ACTIVE_CHANNELS - 1; i >= 0; i--) {
-    sequencer.lightNumWires(i);
-    delay(currentDelay());
+void cmdCaptureOn(const String&) {
+  if (!captureToBluetooth) {
+    sendRateBeforeCapture = bluetooth.getMaxSendRate();
+    if (sendRateBeforeCapture != 0 && sendRateBeforeCapture < CAPTURE_BYTES_PER_SECOND) {
+      bluetooth.setMaxSendRate(CAPTURE_BYTES_PER_SECOND);
+    }
   }
+  captureToBluetooth = true;
+  captureSkipped = 0;
+  mic.startCapture(captureSamples, CAPTURE_MAX_SAMPLES);
 }
 
-void periodicRandom() {
-  sequencer.lightRandomWires();
-  delay(currentDelay());
+void cmdCaptureOff(const String&) {
+  if (captureToBluetooth) {
+    bluetooth.setMaxSendRate(sendRateBeforeCapture);
+  }
+  captureToBluetooth = false;
+  mic.stopCapture();
 }
 
-// ---------------- BLUETOOTH COMMANDS ----------------
-void registerBluetoothCommands() {
-  bluetooth.registerCommand("L", cmdSetLow);
-  bluetooth.registerCommand("H", cmdSetHigh);
-  bluetooth.registerCommand("D", cmdDebugOn);
-  bluetooth.registerCommand("d", cmdDebugOff);
-  bluetooth.registerCommand("S", cmdSetSamplingP2P);
-  bluetooth.registerCommand("s", cmdSetSamplingRMS);
-  bluetooth.registerCommand("N", cmdSetGain);
-  bluetooth.registerCommand("1", cmdUp);
-  bluetooth.registerCommand("3", cmdDown);
-  bluetooth.registerCommand("2", cmdRight);
-  bluetooth.registerCommand("4", cmdLeft);
+// Max Bluetooth send rate in bytes per second, 0 = unlimited
+void cmdSetSendRate(const String& parameter) {
+  if (parameter.length() > 0) {
+    bluetooth.setMaxSendRate((uint16_t)constrain(parameter.toInt(), 0, 0xFFFF));
+  }
+  bluetooth.sendKwlValue(bluetooth.getMaxSendRate(), "T");
 }
 
-void cmdSetLow(const String& p) {
-  uint16_t v = p.toInt();
-  if (v >= mic.getHigh()) v = mic.getHigh() - 1;
-  mic.setLow(v);
-  bluetooth.sendKwlValue(mic.getLow(), "L");
+void cmdSendStats(const String&) {
+  String stats = String(bluetooth.getDroppedCount()) + "," + String(bluetooth.getCoalescedCount());
+  bluetooth.sendKwlString(stats, "t");
 }
 
-void cmdSetHigh(const String& p) {
-  uint16_t v = p.toInt();
-  if (v <= mic.getLow()) v = mic.getLow() + 1;
-  mic.setHigh(v);
-  bluetooth.sendKwlValue(mic.getHigh(), "H");
+void cmdTapTempo(const String&) {
+  tapBeat(millis());
 }
 
-void cmdDebugOn(const String&) {
-  outputToBluetooth = true;
+void cmdClearTempo(const String&) {
+  clearTempo();
 }
 
-void cmdDebugOff(const String&) {
-  outputToBluetooth = false;
+// V<name>=<value> sets a mode parameter (clamped to its range), V<name>
+// reads it; both answer *V<name>=<value>*. A preset is one batch frame.
+void cmdSetModeParam(const String& parameter) {
+  int eq = parameter.indexOf('=');
+  String name = eq < 0 ? parameter : parameter.substring(0, eq);
+  int8_t param = findModeParam(name.c_str());
+  if (param < 0) return;
+  if (eq >= 0) {
+    engine.setParam(param, (uint16_t)constrain(parameter.substring(eq + 1).toInt(), 0, 0xFFFF));
+  }
+  bluetooth.sendKwlString(name + "=" + String(engine.getParam(param)), "V");
 }
 
-void cmdSetSamplingP2P(const String&) {
-  mic.setMode(LoudnessMeter::PEAK_TO_PEAK);
-  bluetooth.sendKwlString("P2P", "P");
+void cmdSendModeParams(const String&) {
+  String list = "";
+  for (uint8_t i = 0; i < MODE_PARAM_COUNT; i++) {
+    if (i > 0) list += ",";
+    list += String(modeParams[i].name) + "=" + String(engine.getParam(i));
+  }
+  bluetooth.sendKwlString(list, "v");
 }
 
-void cmdSetSamplingRMS(const String&) {
-  mic.setMode(LoudnessMeter::RMS);
-  bluetooth.sendKwlString("RMS", "P");
+void cmdPushPanel(const String&) {
+  panelSync.requestPush(true);
+  panelState.markAll();
 }
 
-void cmdSetGain(const String& parameter) {
-  int gain = parameter.toInt();
-  if (gain == 1) {
-    mic.setGain(LoudnessMeter::LOW_GAIN);
-  } else if (gain == 2) {
-    mic.setGain(LoudnessMeter::MEDIUM_GAIN);
-  } else if (gain == 3) {
-    mic.setGain(LoudnessMeter::HIGH_GAIN);
+void cmdSetCurve(const String& parameter) {
+  int curve = parameter.toInt();
+  if (curve == 1) {
+    quantizer.setCurve(LevelQuantizer::LINEAR);
+  } else if (curve == 2) {
+    quantizer.setCurve(LevelQuantizer::PERCEPTUAL);
+  } else if (curve == 3) {
+    quantizer.setCurve(LevelQuantizer::DECIBEL);
   }
-  bluetooth.sendKwlValue(gain, "N");
+  panelState.mark(FIELD_CURVE);
 }
 
 void cmdUp(const String&) {
@@ -432,55 +535,220 @@ void cmdLeft(const String&) {
 }
 
 void nextMode() {
-  mode = (mode + 1) % getModeCount();
-  if (modes[mode].onEnter) modes[mode].onEnter();
-  printMode();
+  engine.setMode((engine.getMode() + 1) % getModeCount(), millis());
+  markModeChanged();
 }
 
 void prevMode() {
-  mode = (mode == 0) ? (getModeCount() - 1) : (mode - 1);
-  if (modes[mode].onEnter) modes[mode].onEnter();
-  printMode();
+  uint8_t mode = engine.getMode();
+  engine.setMode((mode == 0) ? (getModeCount() - 1) : (mode - 1), millis());
+  markModeChanged();
 }
 
 void nextSetting() {
-  if (isReactive(mode)) {
-    if (++numWires > ACTIVE_CHANNELS) {
-      numWires = 1;
-    }
-    bluetooth.sendKwlValue(numWires, "S");
+  if (isReactive(engine.getMode())) {
+    uint8_t numWires = engine.getNumWires() + 1;
+    engine.setNumWires(numWires > ACTIVE_CHANNELS ? 1 : numWires);
+    panelState.mark(FIELD_SETTING);
   } else {
     currentDelayIndex = (currentDelayIndex + 1) % NUM_DELAYS;
-    bluetooth.sendKwlValue(currentDelay(), "S");
+    engine.setDelay(currentDelay());
+    panelState.mark(FIELD_SETTING);
+    clearTempo();
   }
 }
 
 void prevSetting() {
-  if (isReactive(mode)) {
-    numWires = numWires - 1;
-    if (numWires == 0) {
-      numWires = ACTIVE_CHANNELS;
-    }
-    bluetooth.sendKwlValue(numWires, "S");
+  if (isReactive(engine.getMode())) {
+    uint8_t numWires = engine.getNumWires() - 1;
+    engine.setNumWires(numWires == 0 ? ACTIVE_CHANNELS : numWires);
+    panelState.mark(FIELD_SETTING);
   } else {
     if (currentDelayIndex == 0) {
       currentDelayIndex = NUM_DELAYS - 1;
     } else {
       currentDelayIndex--;
     }
-    bluetooth.sendKwlValue(currentDelay(), "S");
+    engine.setDelay(currentDelay());
+    panelState.mark(FIELD_SETTING);
+    clearTempo();
   }
 }
 
-void printMode() {
-  bluetooth.sendKwlString(modes[mode].label, "M");
-  if (isReactive(mode)) {
-    bluetooth.sendKwlValue(numWires, "S");
-  } else {
-    bluetooth.sendKwlValue(currentDelay(), "S");
+void markModeChanged() {
+  panelState.mark(FIELD_MODE);
+  panelState.mark(FIELD_SETTING);
+}
+
+// Sampling modes keep their own thresholds
+void markSamplingChanged() {
+  panelState.mark(FIELD_SAMPLING);
+  panelState.mark(FIELD_LOW);
+  panelState.mark(FIELD_HIGH);
+}
+
+// Sends the changed panel values as one line, after any panel push
+void sendPanelState() {
+  if (!panelState.isDirty()) return;
+  String frame = panelState.collect(panelValue);
+  if (frame.length() > 0) {
+    bluetooth.sendRaw(frame + "\r\n");
+  }
+}
+
+String panelValue(uint8_t field) {
+  switch (field) {
+    case FIELD_MODE:
+      return modes[engine.getMode()].label;
+    case FIELD_SETTING:
+      return String(isReactive(engine.getMode()) ? engine.getNumWires() : currentDelay());
+    case FIELD_GAIN:
+      return gainLabel();
+    case FIELD_SAMPLING:
+      return samplingLabel();
+    case FIELD_LOW:
+      return String(mic.getLow());
+    case FIELD_HIGH:
+      return String(mic.getHigh());
+    case FIELD_TELEMETRY:
+      return outputToBluetooth ? "ON" : "OFF";
+    case FIELD_AUTO_GAIN:
+      return autoGainEnabled ? "AGC" : "MAN";
+    case FIELD_FRONT_END:
+      return mic.isFrontEndEnabled() ? "FILT" : "RAW";
+    case FIELD_CURVE:
+      return curveLabel();
+    case FIELD_BAND:
+      return filterBandLabel();
+    case FIELD_COMBINER:
+      return combinerLabel();
+    case FIELD_TEMPO:
+      return tapTempo.hasTempo() ? String(tapTempo.getBpm()) : "-";
+  }
+  return "";
+}
+
+String gainLabel() {
+  switch (mic.getGain()) {
+    case LoudnessMeter::LOW_GAIN:
+      return "1";
+    case LoudnessMeter::MEDIUM_GAIN:
+      return "2";
+    case LoudnessMeter::HIGH_GAIN:
+    default:
+      return "3";
+  }
+}
+
+String samplingLabel() {
+  switch (mic.getMode()) {
+    case LoudnessMeter::RMS:
+      return "RMS";
+    case LoudnessMeter::LOUDNESS:
+      return "LOUD";
+    case LoudnessMeter::PEAK_TO_PEAK:
+    default:
+      return "P2P";
+  }
+}
+
+String curveLabel() {
+  switch (quantizer.getCurve()) {
+    case LevelQuantizer::PERCEPTUAL:
+      return "PER";
+    case LevelQuantizer::DECIBEL:
+      return "dB";
+    case LevelQuantizer::LINEAR:
+    default:
+      return "LIN";
+  }
+}
+
+String filterBandLabel() {
+  switch (mic.getFilterBand()) {
+    case FilterChain::WIDEBAND:
+      return "WIDE";
+    case FilterChain::BASS:
+      return "BASS";
+    case FilterChain::OFF:
+    default:
+      return "OFF";
+  }
+}
+
+String combinerLabel() {
+  switch (mic.getCombiner()) {
+    case LoudnessMeter::COMBINE_MEAN:
+      return "MEAN";
+    case LoudnessMeter::COMBINE_SPATIAL:
+      return "SPAT";
+    case LoudnessMeter::COMBINE_MAX:
+    default:
+      return "MAX";
   }
 }
 
+void sendFlightRecorderChunk() {
+  static const char digits[] = "0123456789ABCDEF";
+  uint8_t chunk[FLIGHT_DUMP_CHUNK];
+  uint16_t n = recorder.readDump(chunk, FLIGHT_DUMP_CHUNK);
+  String hex = "";
+  hex.reserve(n * 2);
+  for (uint16_t i = 0; i < n; i++) {
+    hex += digits[chunk[i] >> 4];
+    hex += digits[chunk[i] & 0x0F];
+  }
+  bluetooth.sendKwlString(hex, "R");
+  if (!recorder.isDumping()) {
+    bluetooth.sendKwlString("END", "R");
+  }
+}
+
+void sendCapturedWindow() {
+  static uint8_t frame[CAPTURE_MAX_FRAME];
+  uint16_t length = RiceCodec::encode(captureSamples, mic.getCaptureLength(), mic.getSampleRate(), frame, CAPTURE_MAX_FRAME);
+  if (length == 0) return;
+  // A window that does not fit is skipped whole, and the number skipped
+  // goes out as *w<count>* ahead of the next frame so the gap is visible
+  String line = toBase64(frame, length);
+  if (panelSync.isWaitingForRoom() || !bluetooth.hasQueueSpace(line.length() + 16, captureSkipped ? 2 : 1)) {
+    captureSkipped++;
+    return;
+  }
+  if (captureSkipped) {
+    bluetooth.sendKwlValue(captureSkipped, "w");
+    captureSkipped = 0;
+  }
+  bluetooth.sendKwlString(line, "W");
+}
+
+String toBase64(const uint8_t* data, uint16_t length) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  String out = "";
+  out.reserve((length + 2) / 3 * 4);
+  for (uint16_t i = 0; i < length; i += 3) {
+    uint32_t triple = (uint32_t)data[i] << 16;
+    if (i + 1 < length) triple |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < length) triple |= data[i + 2];
+    out += alphabet[(triple >> 18) & 0x3F];
+    out += alphabet[(triple >> 12) & 0x3F];
+    out += (i + 1 < length) ? alphabet[(triple >> 6) & 0x3F] : '=';
+    out += (i + 2 < length) ? alphabet[triple & 0x3F] : '=';
+  }
+  return out;
+}
+
+// The panel (if pushed) goes first, then one snapshot of every value
+void onBluetoothConnect() {
+  panelSync.requestPush(false);
+  panelState.markAll();
+}
+
+void recordCommand(const String& input) {
+  // Same clock as the window records, which are stamped with loopBegin
+  recorder.recordCommand(loopBegin, input.c_str(), input.length());
+}
+
 void printToBluetooth() {
   String data = String(mic.getSignal()) + "," + String(mic.getLow()) + "," + String(mic.getHigh());
   bluetooth.sendKwlString(data, "G");
@@ -492,8 +760,28 @@ void processSample() {
   Serial.print(mic.getSignal());
   Serial.print(",");
 #endif
-  uint16_t constrainedSignal = constrain(mic.getSignal(), mic.getLow(), mic.getHigh());
-  mappedSignal = map(constrainedSignal, mic.getLow(), mic.getHigh(), 0, ACTIVE_CHANNELS);
+  mappedSignal = quantizer.quantize(mic.getSignal());
+}
+
+void updateQuantizerRange() {
+  quantizer.setRange(mic.getLow(), mic.getHigh());
+}
+
+void runAutoGain() {
+  // Gain enum runs from HIGH_GAIN (0) to LOW_GAIN (2); the thresholds
+  // follow the gain, so a raise is only taken while they still fit
+  LoudnessMeter::Gain gain = mic.getGain();
+  bool canRaise = gain != LoudnessMeter::HIGH_GAIN && mic.thresholdsFit((LoudnessMeter::Gain)(gain - 1));
+  AutoGain::Step step = agc.update(
+    millis(), mic.getSignal(), mic.getClipCount(), mic.getSampleCount(),
+    canRaise, gain != LoudnessMeter::LOW_GAIN);
+  if (step == AutoGain::KEEP) return;
+
+  mic.setGain((LoudnessMeter::Gain)(step == AutoGain::RAISE ? gain - 1 : gain + 1));
+  updateQuantizerRange();
+  panelState.mark(FIELD_GAIN);
+  panelState.mark(FIELD_LOW);
+  panelState.mark(FIELD_HIGH);
 }
 
 uint16_t currentDelay() {
@@ -0,0 +1,290 @@
+#include <initializer_list>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "AdcFrontEnd.h"
+#include "BluetoothElectronics.h"
+#include "FastRandom.h"
+#include "FilterChain.h"
+#include "FlightRecorder.h"
+#include "LevelQuantizer.h"
+#include "LoudnessMeter.h"
+#include "ModeEngine.h"
+#include "PeakToPeakSampler.h"
+#include "RiceCodec.h"
+#include "WindowStats.h"
+#include "WireMask.h"
+
+// Host throughput of the firmware's hot paths. Absolute numbers are for
+// comparing changes on one machine; the ESP32 is one to two orders of
+// magnitude slower.
+
+#define WINDOW_SAMPLES 280
+
+static volatile uint32_t sink;
+
+template <typename F>
+static double nanosPer(unsigned count, F body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+// Microphone-like windows: a drifting envelope over noise around the bias
+static std::vector<uint16_t> corpus(unsigned windows) {
+  std::vector<uint16_t> samples((size_t)windows * WINDOW_SAMPLES);
+  FastRandom rng(1);
+  for (size_t i = 0; i < samples.size(); i++) {
+    double envelope = 0.5 + 0.5 * sin(i / 20000.0 * 2 * M_PI);
+    samples[i] = (uint16_t)(2048 + ((int)rng.below(2001) - 1000) * envelope);
+  }
+  return samples;
+}
+
+// Random wire selections per second, against the former shuffle through
+// libc rand()
+static void benchRandomMasks() {
+  const unsigned n = 2000000;
+  FastRandom rng(1);
+  double masks = nanosPer(n, [&] {
+    for (unsigned i = 0; i < n; i++) sink += WireMask::randomMask(rng, 8, (uint8_t)(i & 7));
+  });
+  double swaps = nanosPer(n, [&] {
+    uint8_t mask = 0x0F;
+    for (unsigned i = 0; i < n; i++) mask = WireMask::swapBits(rng, mask, 8, 2);
+    sink += mask;
+  });
+  double shuffle = nanosPer(n, [&] {
+    uint8_t order[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    for (unsigned i = 0; i < n; i++) {
+      for (uint8_t a = 0; a < 8; a++) {
+        uint8_t b = (uint8_t)(rand() % 8);
+        uint8_t t = order[a];
+        order[a] = order[b];
+        order[b] = t;
+      }
+      uint8_t mask = 0;
+      for (uint8_t k = 0; k < (i & 7); k++) mask |= 1 << order[k];
+      sink += mask;
+    }
+  });
+  printf("random masks: %.1f M triggers/s (swap %.1f M/s), rand() shuffle %.1f M/s\n",
+    1e3 / masks, 1e3 / swaps, 1e3 / shuffle);
+}
+
+// Per-window quantizer cost and the level histogram of the linear and dB
+// curves over the same windows
+static void benchQuantizer(const std::vector<uint16_t>& audio) {
+  unsigned windows = audio.size() / WINDOW_SAMPLES;
+  std::vector<uint16_t> signals(windows);
+  for (unsigned w = 0; w < windows; w++) {
+    WindowStats s;
+    s.reset();
+    s.addBlock(&audio[(size_t)w * WINDOW_SAMPLES], WINDOW_SAMPLES);
+    signals[w] = s.peakToPeak();
+  }
+  for (LevelQuantizer::Curve curve : { LevelQuantizer::LINEAR, LevelQuantizer::DECIBEL }) {
+    LevelQuantizer q(8, 25);
+    q.setCurve(curve);
+    q.setRange(100, 2000);
+    unsigned histogram[9] = {};
+    double ns = nanosPer(windows, [&] {
+      for (uint16_t s : signals) histogram[q.quantize(s)]++;
+    });
+    printf("quantizer %-7s %.1f ns/window, levels:", curve == LevelQuantizer::LINEAR ? "linear" : "dB", ns);
+    for (unsigned h : histogram) printf(" %4.1f%%", 100.0 * h / windows);
+    printf("\n");
+  }
+}
+
+// Front end per raw read
+static void benchFrontEnd(const std::vector<uint16_t>& audio) {
+  AdcFrontEnd frontEnd;
+  double ns = nanosPer(audio.size(), [&] {
+    for (uint16_t s : audio) {
+      if (frontEnd.push(s)) sink += frontEnd.value();
+    }
+  });
+  printf("front end %.2f ns/raw read\n", ns);
+}
+
+// Pre-filter throughput per sample
+static void benchFilterChain(const std::vector<uint16_t>& audio) {
+  FilterChain chain;
+  chain.setBand(FilterChain::WIDEBAND);
+  chain.configure(20000);
+  double ns = nanosPer(audio.size(), [&] {
+    for (uint16_t s : audio) sink += chain.process(s);
+  });
+  printf("filter chain %.1f M samples/s\n", 1e3 / ns);
+}
+
+// A window's cost per sample stays flat with the input count
+static uint16_t benchTone(uint8_t pin) {
+  return (uint16_t)(2048 + ((Host::nowMicros * 7 + pin * 13) % 1000));
+}
+
+static void benchInputs() {
+  Host::analogSource = benchTone;
+  Host::analogReadMicros = 50;
+  printf("loudness meter:");
+  for (uint8_t inputs = 1; inputs <= MAX_MIC_INPUTS; inputs++) {
+    const uint8_t pins[] = { 32, 33, 34, 35 };
+    LoudnessMeter mic(pins[0], 25, 14, 800, 1950, 800, 1950);
+    mic.setInputs(pins, inputs);
+    mic.begin();
+    const unsigned windows = 5000;
+    double ns = nanosPer(windows, [&] {
+      for (unsigned w = 0; w < windows; w++) {
+        mic.readAudioSample();
+        sink += mic.getSignal();
+      }
+    });
+    printf(" %u input%s %.0f ns/window (%.1f ns/sample)", inputs, inputs > 1 ? "s" : "", ns, ns / mic.getSampleCount());
+  }
+  printf("\n");
+}
+
+// Recorder write per window
+static void benchRecorder() {
+  FlightRecorder recorder(64);
+  const unsigned n = 1000000;
+  FastRandom rng(3);
+  double ns = nanosPer(n, [&] {
+    for (unsigned i = 0; i < n; i++) {
+      recorder.recordWindow(i * 14, (uint16_t)(1000 + rng.below(200)), (uint8_t)rng.below(9), (uint8_t)rng.next(), 14);
+    }
+  });
+  printf("flight recorder %.1f ns/window\n", ns);
+}
+
+// Capture compression per window, and its size against 16-bit samples
+static void benchCodec(const std::vector<uint16_t>& audio) {
+  unsigned windows = audio.size() / WINDOW_SAMPLES;
+  uint8_t frame[WINDOW_SAMPLES * 3];
+  uint64_t bytes = 0;
+  double ns = nanosPer(windows, [&] {
+    for (unsigned w = 0; w < windows; w++) {
+      bytes += RiceCodec::encode(&audio[(size_t)w * WINDOW_SAMPLES], WINDOW_SAMPLES, 20000, frame, sizeof(frame));
+    }
+  });
+  printf("rice codec %.2f us/window, %.2f of 16-bit size\n", ns / 1000, (double)bytes / (windows * WINDOW_SAMPLES * 2));
+}
+
+// Dispatch across the firmware's command set, and plain against batched
+// slider updates over a link
+class NullTransport : public Transport {
+public:
+  std::string input;
+  size_t position = 0;
+  size_t end = 0; // readable up to here
+  size_t written = 0;
+  bool nextLine() {
+    end = input.find('\n', position);
+    end = end == std::string::npos ? input.size() : end + 1;
+    return end > position;
+  }
+  void begin(const char* deviceName) override {}
+  int available() override { return (int)(end - position); }
+  int read() override { return (uint8_t)input[position++]; }
+  size_t write(const uint8_t* data, size_t length) override { written += length; return length; }
+  bool isConnected() override { return true; }
+};
+
+static void act(const String& parameter) { sink += parameter.length(); }
+
+static const KwlCommand firmwareCommands[] = {
+  { "L", act, true }, { "H", act, true }, { "D", act, false }, { "d", act, false },
+  { "S", act, false }, { "s", act, false }, { "K", act, false }, { "N", act, true },
+  { "C", act, true }, { "A", act, false }, { "a", act, false }, { "F", act, false },
+  { "f", act, false }, { "B", act, true }, { "X", act, true }, { "R", act, false },
+  { "r", act, false }, { "W", act, false }, { "w", act, false }, { "T", act, true },
+  { "t", act, false }, { "U", act, false }, { "Y", act, false }, { "y", act, false },
+  { "V", act, false }, { "v", act, false }, { "1", act, false }, { "3", act, false },
+  { "2", act, false }, { "4", act, false },
+};
+static const auto firmwareTable = makeCommandTable(firmwareCommands);
+
+static void benchCommands() {
+  const size_t count = sizeof(firmwareCommands) / sizeof(firmwareCommands[0]);
+  std::vector<String> inputs;
+  for (const KwlCommand& c : firmwareCommands) inputs.push_back(String(c.receiveChar) + "1234");
+  const unsigned rounds = 200000;
+  CommandIndex index = firmwareTable.index();
+  double dispatchNs = nanosPer(rounds * count, [&] {
+    for (unsigned r = 0; r < rounds; r++) {
+      for (const String& input : inputs) {
+        const KwlCommand* c = findCommand(index, input.c_str());
+        if (c) c->action(input);
+      }
+    }
+  });
+
+  const unsigned updates = 160000;
+  NullTransport plainLink, batchLink;
+  for (unsigned i = 0; i < updates; i++) {
+    plainLink.input += "L" + std::to_string(800 + i % 100) + "\n";
+  }
+  for (unsigned i = 0; i < updates; i += 16) {
+    batchLink.input += "#" + std::to_string(i / 16) + "|";
+    for (unsigned j = 0; j < 16; j++) batchLink.input += (j ? ";L" : "L") + std::to_string(800 + j);
+    batchLink.input += "\n";
+  }
+  BluetoothElectronics plain("bench", plainLink), batched("bench", batchLink);
+  plain.setCommands(index);
+  batched.setCommands(index);
+  plain.setMaxSendRate(0);
+  batched.setMaxSendRate(0);
+  plainLink.end = plainLink.input.size();
+  double plainNs = nanosPer(updates, [&] { plain.handleInput(); });
+  // One frame per loop, so every ack fits the queue
+  double batchNs = nanosPer(updates, [&] {
+    while (batchLink.nextLine()) batched.handleInput();
+    batched.flushOutput();
+  });
+  printf("dispatch %.1f ns over %zu commands; %.2f M commands/s plain, %.2f M/s batched, %.2f ack bytes per batched command\n",
+    dispatchNs, count, 1e3 / plainNs, 1e3 / batchNs, (double)batchLink.written / updates);
+}
+
+// The mode engine over pre-quantized windows, all modes
+static void benchModes(const std::vector<uint16_t>& audio) {
+  unsigned windows = audio.size() / WINDOW_SAMPLES;
+  std::vector<uint8_t> levels(windows);
+  PeakToPeakSampler sampler;
+  LevelQuantizer q(8, 25);
+  q.setRange(800, 1950);
+  for (unsigned w = 0; w < windows; w++) {
+    WindowStats s;
+    s.reset();
+    s.addBlock(&audio[(size_t)w * WINDOW_SAMPLES], WINDOW_SAMPLES);
+    levels[w] = q.quantize(sampler.feed(s.min, s.max));
+  }
+  double ns = nanosPer(windows * getModeCount(), [&] {
+    for (uint8_t m = 0; m < getModeCount(); m++) {
+      ModeEngine engine(8, 0);
+      engine.setMode(m, 0);
+      for (unsigned w = 0; w < windows; w++) {
+        engine.run(levels[w], (w + 1) * 14);
+        sink += engine.getMask();
+      }
+    }
+  });
+  printf("mode engine %.1f M mode-windows/s (%.0fx real time per mode)\n", 1e3 / ns, 14e6 / ns);
+}
+
+int main() {
+  std::vector<uint16_t> audio = corpus(20000);
+  benchRandomMasks();
+  benchQuantizer(audio);
+  benchFrontEnd(audio);
+  benchFilterChain(audio);
+  benchInputs();
+  benchRecorder();
+  benchCodec(audio);
+  benchCommands();
+  benchModes(audio);
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BluetoothElectronics.h"
+#include "HostTransport.h"
+#include "KwlPanel.h"
+
+// Command handling over the localhost stand-in for the Bluetooth link,
+// and connect-to-ready time of the panel push: a client thread talks to
+// BluetoothElectronics running the loop on the main thread, as a phone
+// would.
+//   bench_transport [port]
+
+#define ROUND_TRIPS 2000
+#define PIPELINED_COMMANDS 100000
+
+static BluetoothElectronics* bt;
+static std::atomic<bool> done{ false };
+static unsigned applied = 0;
+
+static uint32_t realMicros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void cmdLow(const String& parameter) {
+  applied++;
+  bt->sendKwlValue(parameter.toInt(), "L");
+}
+
+static void cmdCount(const String&) {
+  bt->sendKwlValue(applied, "Z");
+  applied = 0;
+}
+
+static void onConnect() {
+  bt->sendKwlCode(KWL_PANEL);
+}
+
+static const KwlCommand commandList[] = {
+  { "L", cmdLow, true },
+  { "Z", cmdCount, false },
+};
+static const auto commandTable = makeCommandTable(commandList);
+
+// Blocking client helpers
+static void sendAll(int fd, const std::string& text) {
+  size_t sent = 0;
+  while (sent < text.size()) {
+    ssize_t n = send(fd, text.data() + sent, text.size() - sent, 0);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+static bool readUntil(int fd, std::string& buffer, const std::string& marker) {
+  size_t found;
+  while ((found = buffer.find(marker)) == std::string::npos) {
+    char chunk[4096];
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) return false;
+    buffer.append(chunk, n);
+  }
+  buffer.erase(0, found + marker.size());
+  return true;
+}
+
+static void client(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  std::string buffer;
+
+  uint32_t start = realMicros();
+  if (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+    perror("connect");
+    done = true;
+    return;
+  }
+  bool ready = readUntil(fd, buffer, std::string(KWL_PANEL).substr(sizeof(KWL_PANEL) - 40) + "\n*");
+  printf("connect to ready: %.1f ms for the %zu-byte panel at %u B/s\n",
+    (realMicros() - start) / 1000.0, sizeof(KWL_PANEL) - 1, TX_DEFAULT_BYTES_PER_SECOND);
+
+  std::vector<double> trips;
+  for (int i = 0; ready && i < ROUND_TRIPS; i++) {
+    std::string value = std::to_string(800 + i % 1000);
+    uint32_t t = realMicros();
+    sendAll(fd, "L" + value + "\n");
+    if (!readUntil(fd, buffer, "*L" + value + "*\r\n")) break;
+    trips.push_back(realMicros() - t);
+  }
+  if (!trips.empty()) {
+    std::sort(trips.begin(), trips.end());
+    double sum = 0;
+    for (double t : trips) sum += t;
+    printf("round trip: mean %.0f us, median %.0f us, p99 %.0f us\n",
+      sum / trips.size(), trips[trips.size() / 2], trips[trips.size() * 99 / 100]);
+  }
+
+  // Zero the applied count the round trips left behind
+  sendAll(fd, "Z\n");
+  readUntil(fd, buffer, "*Z" + std::to_string(trips.size()) + "*\r\n");
+
+  std::string burst;
+  for (int i = 0; i < PIPELINED_COMMANDS; i++) burst += "L" + std::to_string(800 + i % 1000) + "\n";
+  burst += "Z\n";
+  uint32_t t = realMicros();
+  std::thread writer([&] { sendAll(fd, burst); });
+  bool counted = readUntil(fd, buffer, "*Z" + std::to_string(PIPELINED_COMMANDS) + "*");
+  double seconds = (realMicros() - t) / 1e6;
+  writer.join();
+  if (counted) {
+    printf("pipelined: %.0f commands/s\n", PIPELINED_COMMANDS / seconds);
+  }
+  close(fd);
+  done = true;
+}
+
+int main(int argc, char** argv) {
+  uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : HOST_TRANSPORT_PORT;
+  HostTransport link(port);
+  BluetoothElectronics electronics("bench", link);
+  bt = &electronics;
+  electronics.setCommands(commandTable.index());
+  electronics.setConnectListener(onConnect);
+  electronics.setCoalescedKeys("L");
+  electronics.begin();
+
+  std::thread phone(client, port);
+  while (!done) {
+    Host::nowMicros = realMicros();
+    electronics.handleInput();
+    electronics.flushOutput();
+  }
+  phone.join();
+  return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal assertions for the host tests: failures are printed and
+// counted, and main() returns checkResult() so ctest sees them.
+
+#include <stdio.h>
+
+inline int& checkFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+inline bool checkReport(bool ok, const char* file, int line, const char* what) {
+  if (!ok) {
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    checkFailures()++;
+  }
+  return ok;
+}
+
+#define CHECK(condition) checkReport((condition), __FILE__, __LINE__, #condition)
+
+#define CHECK_EQ(actual, expected)                                                 \
+  do {                                                                             \
+    long long a_ = (long long)(actual), e_ = (long long)(expected);                \
+    if (!checkReport(a_ == e_, __FILE__, __LINE__, #actual " == " #expected)) {    \
+      fprintf(stderr, "  got %lld, expected %lld\n", a_, e_);                      \
+    }                                                                              \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                    \
+  do {                                                                             \
+    double a_ = (double)(actual), e_ = (double)(expected);                         \
+    double d_ = a_ > e_ ? a_ - e_ : e_ - a_;                                       \
+    if (!checkReport(d_ <= (tolerance), __FILE__, __LINE__,                        \
+                     #actual " ~= " #expected " +- " #tolerance)) {                \
+      fprintf(stderr, "  got %g, expected %g\n", a_, e_);                          \
+    }                                                                              \
+  } while (0)
+
+inline int checkResult() {
+  if (checkFailures()) {
+    fprintf(stderr, "%d check(s) failed\n", checkFailures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "Arduino.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+String::String(double value, unsigned decimals) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+  text = buffer;
+}
+
+int String::indexOf(char c, unsigned from) const {
+  size_t p = text.find(c, from);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+int String::indexOf(const String& s, unsigned from) const {
+  size_t p = text.find(s.text, from);
+  return p == std::string::npos ? -1 : (int)p;
+}
+
+String String::substring(unsigned from) const {
+  return from < text.size() ? String(text.substr(from)) : String();
+}
+
+String String::substring(unsigned from, unsigned to) const {
+  if (to > text.size()) to = text.size();
+  return from < to ? String(text.substr(from, to - from)) : String();
+}
+
+void String::trim() {
+  size_t first = text.find_first_not_of(" \t\r\n\f\v");
+  if (first == std::string::npos) {
+    text.clear();
+    return;
+  }
+  size_t last = text.find_last_not_of(" \t\r\n\f\v");
+  text = text.substr(first, last - first + 1);
+}
+
+namespace {
+  uint8_t levels[HOST_PIN_COUNT];
+  void (*handlers[HOST_PIN_COUNT])(void*);
+  void* handlerArgs[HOST_PIN_COUNT];
+
+  uint16_t midScale(uint8_t pin) {
+    return 2048;
+  }
+}
+
+namespace Host {
+  uint32_t nowMicros = 0;
+  uint32_t analogReadMicros = 0;
+  uint16_t (*analogSource)(uint8_t pin) = midScale;
+
+  void setMillis(uint32_t ms) {
+    nowMicros = ms * 1000UL;
+  }
+
+  void advanceMillis(uint32_t ms) {
+    nowMicros += ms * 1000UL;
+  }
+
+  uint8_t pinLevel(uint8_t pin) {
+    return levels[pin % HOST_PIN_COUNT];
+  }
+
+  void setPin(uint8_t pin, uint8_t level) {
+    pin %= HOST_PIN_COUNT;
+    levels[pin] = level;
+    if (handlers[pin]) handlers[pin](handlerArgs[pin]);
+  }
+}
+
+uint32_t millis() {
+  return Host::nowMicros / 1000UL;
+}
+
+uint32_t micros() {
+  return Host::nowMicros;
+}
+
+void delay(uint32_t ms) {
+  Host::advanceMillis(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+  Host::nowMicros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (mode == INPUT_PULLUP) levels[pin % HOST_PIN_COUNT] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  levels[pin % HOST_PIN_COUNT] = level;
+}
+
+int digitalRead(uint8_t pin) {
+  return levels[pin % HOST_PIN_COUNT];
+}
+
+uint16_t analogRead(uint8_t pin) {
+  Host::nowMicros += Host::analogReadMicros;
+  return Host::analogSource(pin);
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+  return pin;
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode) {
+  handlers[pin % HOST_PIN_COUNT] = isr;
+  handlerArgs[pin % HOST_PIN_COUNT] = arg;
+}
+
+void detachInterrupt(uint8_t pin) {
+  handlers[pin % HOST_PIN_COUNT] = nullptr;
+}
+
+uint32_t esp_random() {
+  return 0x9E3779B9UL;
+}
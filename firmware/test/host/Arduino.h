@@ -0,0 +1,145 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the firmware's portable modules
+// on a desktop. Time, pins and the ADC are driven by the tests through the
+// Host namespace below. ARDUINO stays undefined, so host-only code such as
+// HostTransport builds as well.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define IRAM_ATTR
+#define PROGMEM
+
+#define HOST_PIN_COUNT 64
+
+typedef bool boolean;
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class String {
+public:
+  String(const char* text = "") : text(text ? text : "") {}
+  String(const std::string& text) : text(text) {}
+  explicit String(char c) : text(1, c) {}
+  String(int value) : text(std::to_string(value)) {}
+  String(unsigned value) : text(std::to_string(value)) {}
+  String(long value) : text(std::to_string(value)) {}
+  String(unsigned long value) : text(std::to_string(value)) {}
+  String(double value, unsigned decimals = 2);
+
+  unsigned length() const { return text.size(); }
+  bool isEmpty() const { return text.empty(); }
+  const char* c_str() const { return text.c_str(); }
+  char charAt(unsigned i) const { return i < text.size() ? text[i] : 0; }
+  char operator[](unsigned i) const { return charAt(i); }
+  bool reserve(unsigned size) { text.reserve(size); return true; }
+
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  bool equals(const String& other) const { return text == other.text; }
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator!=(const String& other) const { return text != other.text; }
+  int indexOf(char c, unsigned from = 0) const;
+  int indexOf(const String& s, unsigned from = 0) const;
+  String substring(unsigned from) const;
+  String substring(unsigned from, unsigned to) const;
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return (float)atof(text.c_str()); }
+  void trim();
+  void remove(unsigned index) { if (index < text.size()) text.erase(index); }
+  void remove(unsigned index, unsigned count) { if (index < text.size()) text.erase(index, count); }
+
+  String& operator+=(const String& other) { text += other.text; return *this; }
+  String& operator+=(const char* other) { text += other; return *this; }
+  String& operator+=(char c) { text += c; return *this; }
+
+  friend String operator+(const String& a, const String& b) { return String(a.text + b.text); }
+  friend String operator+(const String& a, const char* b) { return String(a.text + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.text); }
+  friend String operator+(const String& a, char b) { return String(a.text + b); }
+
+private:
+  std::string text;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) { return write(&c, 1); }
+  virtual size_t write(const uint8_t* data, size_t length) { return length; }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value) { return print(String(value)); }
+  size_t print(unsigned value) { return print(String(value)); }
+  size_t print(long value) { return print(String(value)); }
+  size_t print(unsigned long value) { return print(String(value)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+  size_t println() { return print("\r\n"); }
+  template <typename T> size_t println(T value) { return print(value) + println(); }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int availableForWrite() { return 64; }
+  void flush() {}
+};
+
+// Output is discarded: tests check return values and state, not logs
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud) {}
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+uint32_t esp_random();
+
+namespace Host {
+  // Virtual clock read by millis() and micros(); only delay() and the
+  // ADC advance it besides the tests
+  extern uint32_t nowMicros;
+  // Each analogRead() takes this long, so a sampling loop timed with
+  // micros() finishes its window
+  extern uint32_t analogReadMicros;
+  // Returns the ADC reading for a pin; defaults to mid-scale
+  extern uint16_t (*analogSource)(uint8_t pin);
+
+  void setMillis(uint32_t ms);
+  void advanceMillis(uint32_t ms);
+  uint8_t pinLevel(uint8_t pin);
+  // Drives an input pin and fires its interrupt, as a level change would
+  void setPin(uint8_t pin, uint8_t level);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include <initializer_list>
+#include <math.h>
+#include "check.h"
+#include "AdcFrontEnd.h"
+#include "FastRandom.h"
+
+#define RAW_PER_OUTPUT (1 << ADC_FRONT_END_OVERSAMPLE_SHIFT)
+#define WINDOW_RAW_READS 1120 // 280 outputs
+
+static uint16_t sine(unsigned i) {
+  return (uint16_t)lround(2048 + 300 * sin(i * 2 * M_PI / 160));
+}
+
+// Peak-to-peak of one window of raw reads, with or without the front end
+static uint16_t windowPeakToPeak(const uint16_t* raw, unsigned count, bool frontEnd) {
+  AdcFrontEnd f;
+  uint16_t lo = 4095, hi = 0;
+  for (unsigned i = 0; i < count; i++) {
+    uint16_t v = raw[i];
+    if (frontEnd) {
+      if (!f.push(raw[i])) continue;
+      v = f.value();
+    }
+    if (v < lo) lo = v;
+    if (v > hi) hi = v;
+  }
+  return hi - lo;
+}
+
+static void testPassThroughAndDecimation() {
+  // No calibration off target: reads are only averaged
+  CHECK(!AdcFrontEnd::calibrate());
+  AdcFrontEnd f;
+  // The median holds back its first outputs until it has three samples
+  for (int output = 0; output < ADC_FRONT_END_PRIMING_OUTPUTS; output++) {
+    for (int i = 0; i < RAW_PER_OUTPUT; i++) CHECK(!f.push(i == RAW_PER_OUTPUT - 1 ? 6 : 0));
+  }
+  CHECK(!f.push(0));
+  CHECK(!f.push(0));
+  CHECK(!f.push(0));
+  CHECK(f.push(6));
+  CHECK_EQ(f.value(), 2); // (6 + 2) >> 2, rounded
+  for (int i = 0; i < RAW_PER_OUTPUT - 1; i++) CHECK(!f.push(1000));
+  CHECK(f.push(1000));
+}
+
+static void testSpikeRejection() {
+  FastRandom rng(31);
+  uint16_t clean[WINDOW_RAW_READS];
+  uint16_t spiked[WINDOW_RAW_READS];
+  unsigned worstExcess = 0;
+  for (unsigned window = 0; window < 200; window++) {
+    for (unsigned i = 0; i < WINDOW_RAW_READS; i++) {
+      clean[i] = spiked[i] = sine(window * 37 + i);
+    }
+    // Single-read spikes to either rail, at least three outputs apart, every
+    // other window starting on its very first read
+    unsigned first = window % 2 ? 0 : rng.below(12);
+    for (unsigned i = first; i < WINDOW_RAW_READS; i += 3 * RAW_PER_OUTPUT + rng.below(40)) {
+      spiked[i] = rng.below(2) ? 4095 : 0;
+    }
+    uint16_t reference = windowPeakToPeak(clean, WINDOW_RAW_READS, true);
+    uint16_t filtered = windowPeakToPeak(spiked, WINDOW_RAW_READS, true);
+    unsigned excess = filtered > reference ? filtered - reference : 0;
+    if (excess > worstExcess) worstExcess = excess;
+    CHECK(windowPeakToPeak(spiked, WINDOW_RAW_READS, false) >= 4000);
+  }
+  printf("spiked windows: p2p at most %u above the clean signal's\n", worstExcess);
+  CHECK(worstExcess <= 8);
+}
+
+// A rail spike on a window's very first read never reaches the output
+static void testSpikeAtWindowStart() {
+  for (uint16_t rail : { 0, 4095 }) {
+    AdcFrontEnd f;
+    uint16_t lo = 4095, hi = 0;
+    for (unsigned i = 0; i < WINDOW_RAW_READS; i++) {
+      if (!f.push(i == 0 ? rail : 2048)) continue;
+      if (f.value() < lo) lo = f.value();
+      if (f.value() > hi) hi = f.value();
+    }
+    CHECK_EQ(lo, 2048);
+    CHECK_EQ(hi, 2048);
+  }
+}
+
+static void testResetDropsHistory() {
+  AdcFrontEnd f;
+  for (int i = 0; i < 10 * RAW_PER_OUTPUT; i++) f.push(3000);
+  CHECK_EQ(f.value(), 3000);
+  // A new window starts elsewhere: its first output must not be held
+  // back by the previous window's samples
+  f.reset();
+  const int reads = (ADC_FRONT_END_PRIMING_OUTPUTS + 1) * RAW_PER_OUTPUT;
+  for (int i = 0; i < reads - 1; i++) CHECK(!f.push(1000));
+  CHECK(f.push(1000));
+  CHECK_EQ(f.value(), 1000);
+}
+
+int main() {
+  testPassThroughAndDecimation();
+  testSpikeRejection();
+  testSpikeAtWindowStart();
+  testResetDropsHistory();
+  return checkResult();
+}
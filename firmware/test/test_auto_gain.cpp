@@ -0,0 +1,94 @@
+#include <math.h>
+#include "check.h"
+#include "AutoGain.h"
+#include "LevelQuantizer.h"
+#include "LoudnessMeter.h"
+
+// As configured in firmware.ino
+#define MIC_OUT 35
+#define MIC_GAIN 32
+#define WINDOW_MS 14
+#define AGC_PERIOD_MS 3000
+#define AGC_MAX_CLIP_PERMILLE 5
+#define AGC_RAISE_HEADROOM 2800
+#define GAIN_STEP_NUMERATOR 3162
+#define GAIN_STEP_DENOMINATOR 1000
+
+static LoudnessMeter mic(MIC_OUT, MIC_GAIN, WINDOW_MS, 800, 1950, 800, 1950);
+static LevelQuantizer quantizer(8, 25);
+static AutoGain agc(AGC_PERIOD_MS, AGC_MAX_CLIP_PERMILLE, AGC_RAISE_HEADROOM, GAIN_STEP_NUMERATOR, GAIN_STEP_DENOMINATOR);
+
+// Tone amplitude at high gain; the microphone divides it per gain step
+static double sourceAmplitude = 100;
+
+static uint16_t microphone(uint8_t pin) {
+  double a = sourceAmplitude;
+  for (int g = LoudnessMeter::HIGH_GAIN; g < mic.getGain(); g++) {
+    a = a * GAIN_STEP_DENOMINATOR / GAIN_STEP_NUMERATOR;
+  }
+  double v = 2048 + a * sin(2 * M_PI * 250 * Host::nowMicros / 1e6);
+  return (uint16_t)(v < 0 ? 0 : (v > 4095 ? 4095 : lround(v)));
+}
+
+// runAutoGain() from firmware.ino
+static bool runAutoGain() {
+  LoudnessMeter::Gain gain = mic.getGain();
+  bool canRaise = gain != LoudnessMeter::HIGH_GAIN && mic.thresholdsFit((LoudnessMeter::Gain)(gain - 1));
+  AutoGain::Step step = agc.update(
+    millis(), mic.getSignal(), mic.getClipCount(), mic.getSampleCount(),
+    canRaise, gain != LoudnessMeter::LOW_GAIN);
+  if (step == AutoGain::KEEP) return false;
+  mic.setGain((LoudnessMeter::Gain)(step == AutoGain::RAISE ? gain - 1 : gain + 1));
+  quantizer.setRange(mic.getLow(), mic.getHigh());
+  return true;
+}
+
+int main() {
+  Host::analogSource = microphone;
+  Host::analogReadMicros = 50;
+  mic.begin();
+  mic.setGainStep(GAIN_STEP_NUMERATOR, GAIN_STEP_DENOMINATOR);
+  quantizer.setRange(mic.getLow(), mic.getHigh());
+  agc.reset(millis());
+
+  // 40 dB up over a minute, a loud plateau, and back down
+  const unsigned rampWindows = 60000 / WINDOW_MS, plateauWindows = 20000 / WINDOW_MS;
+  const unsigned total = 2 * rampWindows + plateauWindows + 10000 / WINDOW_MS;
+  unsigned changes = 0, worstJump = 0, plateauClips = 0;
+  LoudnessMeter::Gain loudestGain = LoudnessMeter::HIGH_GAIN;
+  uint8_t level = 0;
+  for (unsigned w = 0; w < total; w++) {
+    double db;
+    if (w < rampWindows) db = 40.0 * w / rampWindows;
+    else if (w < rampWindows + plateauWindows) db = 40;
+    else if (w < 2 * rampWindows + plateauWindows) db = 40 - 40.0 * (w - rampWindows - plateauWindows) / rampWindows;
+    else db = 0;
+    sourceAmplitude = 200 * pow(10, db / 20);
+
+    mic.readAudioSample();
+    uint8_t previous = level;
+    level = quantizer.quantize(mic.getSignal());
+    if (w > rampWindows + plateauWindows / 2 && w < rampWindows + plateauWindows) {
+      plateauClips += mic.getClipCount();
+    }
+    if (runAutoGain()) {
+      changes++;
+      // The mapped level carries on across the switch
+      mic.readAudioSample();
+      level = quantizer.quantize(mic.getSignal());
+      unsigned jump = level > previous ? level - previous : previous - level;
+      if (jump > worstJump) worstJump = jump;
+      printf("%6.1f s: gain %d, level %u -> %u\n", millis() / 1000.0, mic.getGain(), previous, level);
+    }
+    if (mic.getGain() > loudestGain) loudestGain = mic.getGain();
+  }
+  CHECK_EQ(loudestGain, LoudnessMeter::LOW_GAIN);
+  CHECK_EQ(mic.getGain(), LoudnessMeter::HIGH_GAIN);
+  CHECK_EQ(plateauClips, 0);
+  CHECK(changes <= 6);
+  CHECK(worstJump <= 1);
+  // The user's thresholds survive the round trip unchanged
+  CHECK_EQ(mic.getLow(), 800);
+  CHECK_EQ(mic.getHigh(), 1950);
+  return checkResult();
+}
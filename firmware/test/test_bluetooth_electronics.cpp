@@ -0,0 +1,152 @@
+#include <string>
+#include <vector>
+#include "check.h"
+#include "BluetoothElectronics.h"
+
+// In-memory link: input is queued by the test, output collected, and the
+// write size can be capped to act out a congested link
+class FakeTransport : public Transport {
+public:
+  std::string input;
+  std::string output;
+  bool connected = true;
+  size_t writeLimit = SIZE_MAX;
+
+  void begin(const char* deviceName) override {}
+  int available() override { return (int)input.size(); }
+  int read() override {
+    if (input.empty()) return -1;
+    char c = input[0];
+    input.erase(0, 1);
+    return (uint8_t)c;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    size_t n = length < writeLimit ? length : writeLimit;
+    output.append((const char*)data, n);
+    return n;
+  }
+  bool isConnected() override { return connected; }
+};
+
+static std::vector<std::string> ran;
+
+static void cmdLow(const String& p) { ran.push_back(std::string("L") + p.c_str()); }
+static void cmdHigh(const String& p) { ran.push_back(std::string("H") + p.c_str()); }
+static void cmdMode(const String& p) { ran.push_back(std::string("M") + p.c_str()); }
+static void cmdMax(const String& p) { ran.push_back(std::string("Mx") + p.c_str()); }
+
+static const KwlCommand commandList[] = {
+  { "L", cmdLow, true },
+  { "H", cmdHigh, true },
+  { "Mx", cmdMax, false },
+  { "M", cmdMode, false },
+};
+static const auto commandTable = makeCommandTable(commandList);
+
+static void testDispatch() {
+  FakeTransport link;
+  BluetoothElectronics bt("test", link);
+  bt.setCommands(commandTable.index());
+  ran.clear();
+  link.input = "L900\n  H1950 \r\nMx2\nM3\nZ1\n";
+  bt.handleInput();
+  CHECK((ran == std::vector<std::string>{ "L900", "H1950", "Mx2", "M3" }));
+}
+
+static void testBatch() {
+  FakeTransport link;
+  BluetoothElectronics bt("test", link);
+  bt.setCommands(commandTable.index());
+  bt.setMaxSendRate(0);
+  ran.clear();
+  // L1 is overwritten by L2 with only independent setters in between;
+  // L2 is not, since the mode switch M3 may change what it applies to
+  link.input = "#5|L1;H7;L2;M3;L4\n";
+  bt.handleInput();
+  bt.flushOutput();
+  CHECK((ran == std::vector<std::string>{ "H7", "L2", "M3", "L4" }));
+  CHECK(link.output == "*Q5*\r\n");
+
+  // A retransmission is only acknowledged again
+  ran.clear();
+  link.output.clear();
+  link.input = "#5|L1;H7;L2;M3;L4\n";
+  bt.handleInput();
+  bt.flushOutput();
+  CHECK(ran.empty());
+  CHECK(link.output == "*Q5*\r\n");
+
+  // A new client numbers from scratch, so seq 5 is new again
+  link.connected = false;
+  bt.flushOutput();
+  link.connected = true;
+  link.input = "#5|L9\n";
+  bt.handleInput();
+  CHECK((ran == std::vector<std::string>{ "L9" }));
+}
+
+static void testCoalescing() {
+  FakeTransport link;
+  BluetoothElectronics bt("test", link);
+  bt.setCoalescedKeys("GS");
+  for (int i = 0; i < 10; i++) {
+    bt.sendKwlValue(i, "G");
+    bt.sendKwlValue(100 + i, "T");
+  }
+  CHECK_EQ(bt.getCoalescedCount(), 9);
+  bt.setMaxSendRate(0);
+  bt.flushOutput();
+  CHECK_EQ(link.output.find("*G9*"), 0);
+  CHECK(link.output.find("*G0*") == std::string::npos);
+  CHECK(link.output.find("*T100*") != std::string::npos);
+  CHECK(link.output.find("*T109*") != std::string::npos);
+  CHECK_EQ(bt.getDroppedCount(), 0);
+}
+
+// Output never exceeds the send rate (plus one burst), and lines split by
+// partial writes arrive whole and in order
+static void testRateLimitAndPartialWrites() {
+  FakeTransport link;
+  link.writeLimit = 7;
+  BluetoothElectronics bt("test", link);
+  bt.setMaxSendRate(1000);
+  std::string expected;
+  for (int i = 0; i < 12; i++) {
+    String line = String("line ") + String(i) + " of text that is a little longer";
+    bt.sendRaw(line);
+    expected += line.c_str();
+  }
+  uint32_t start = millis();
+  bt.flushOutput();
+  while (link.output.size() < expected.size() && millis() - start < 5000) {
+    Host::advanceMillis(3);
+    bt.flushOutput();
+    uint32_t elapsed = millis() - start;
+    CHECK(link.output.size() <= elapsed * 1000 / 1000 + 1000 * TX_BURST_MS / 1000);
+  }
+  CHECK(link.output == expected);
+  CHECK_EQ(bt.getDroppedCount(), 0);
+}
+
+static void testQueueBounds() {
+  FakeTransport link;
+  BluetoothElectronics bt("test", link);
+  for (int i = 0; i < TX_QUEUE_SLOTS + 4; i++) bt.sendRaw("x");
+  CHECK_EQ(bt.getDroppedCount(), 4);
+  CHECK(!bt.hasQueueSpace(1));
+  // Nobody listening: the queue is dropped rather than kept stale
+  link.connected = false;
+  bt.flushOutput();
+  CHECK_EQ(bt.getDroppedCount(), 4 + TX_QUEUE_SLOTS);
+  CHECK(bt.hasQueueSpace(TX_QUEUE_MAX_BYTES, TX_QUEUE_SLOTS));
+}
+
+int main() {
+  Host::setMillis(1000);
+  testDispatch();
+  testBatch();
+  testCoalescing();
+  testRateLimitAndPartialWrites();
+  testQueueBounds();
+  return checkResult();
+}
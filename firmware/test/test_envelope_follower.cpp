@@ -0,0 +1,52 @@
+#include <initializer_list>
+#include <vector>
+#include "check.h"
+#include "EnvelopeFollower.h"
+#include "FastRandom.h"
+
+// Targets change on a grid every loop period below divides, so all runs
+// see the same input and must agree exactly at the grid points
+#define GRID_MS 231
+#define GRID_POINTS 400
+
+static std::vector<uint32_t> envelopeAt(uint32_t loopMs, const std::vector<uint8_t>& targets) {
+  EnvelopeFollower envelope(12, 45);
+  envelope.reset(0);
+  std::vector<uint32_t> values;
+  for (uint32_t now = 0; now < GRID_MS * GRID_POINTS; now += loopMs) {
+    envelope.update(targets[now / GRID_MS], now);
+    if (now % GRID_MS == 0) values.push_back(envelope.getValue());
+  }
+  return values;
+}
+
+static void testLoopRateIndependence() {
+  FastRandom rng(17);
+  std::vector<uint8_t> targets(GRID_POINTS);
+  for (auto& t : targets) t = (uint8_t)rng.below(9);
+  std::vector<uint32_t> reference = envelopeAt(1, targets);
+  for (uint32_t loopMs : { 3u, 7u, 11u, 21u, 33u, 77u }) {
+    CHECK(envelopeAt(loopMs, targets) == reference);
+  }
+}
+
+static void testRates() {
+  EnvelopeFollower envelope(10, 20);
+  envelope.reset(0);
+  envelope.update(8, 0);
+  CHECK_EQ(envelope.update(8, 79), 8); // rounded up: 7.9 levels
+  CHECK_EQ(envelope.getValue(), 79 * 256 / 10);
+  CHECK_EQ(envelope.update(0, 80), 8);
+  CHECK_EQ(envelope.getValue(), 8 * 256);
+  CHECK_EQ(envelope.update(0, 100), 7);
+  CHECK_EQ(envelope.update(0, 240), 0);
+  // Instant attack
+  envelope.setAttack(0);
+  CHECK_EQ(envelope.update(5, 250), 5);
+}
+
+int main() {
+  testLoopRateIndependence();
+  testRates();
+  return checkResult();
+}
@@ -0,0 +1,105 @@
+#include <initializer_list>
+#include <complex>
+#include <math.h>
+#include "check.h"
+#include "FilterChain.h"
+
+#define SAMPLE_RATE 20000
+#define AMPLITUDE 1000.0
+#define DC_BLOCKER_CUTOFF_HZ 10.0
+#define BUTTERWORTH_Q 0.7071
+
+typedef std::complex<double> Complex;
+
+// Float reference of the chain: the same DC blocker and RBJ low-pass,
+// evaluated on the unit circle in double precision
+static double referenceGainDb(FilterChain::Band band, double f) {
+  Complex z = std::polar(1.0, -2 * M_PI * f / SAMPLE_RATE); // z^-1
+  double r = 1 - 2 * M_PI * DC_BLOCKER_CUTOFF_HZ / SAMPLE_RATE;
+  Complex h = (1.0 - z) / (1.0 - r * z);
+  double cutoff = band == FilterChain::BASS ? 160 : 4000;
+  double w0 = 2 * M_PI * cutoff / SAMPLE_RATE;
+  double alpha = sin(w0) / (2 * BUTTERWORTH_Q);
+  double c = cos(w0);
+  Complex num = (1 - c) / 2 + (1 - c) * z + (1 - c) / 2 * z * z;
+  Complex den = (1 + alpha) - 2 * c * z + (1 - alpha) * z * z;
+  h *= num / den;
+  return 20 * log10(std::abs(h));
+}
+
+static double measuredGainDb(FilterChain::Band band, double f) {
+  FilterChain chain;
+  chain.setBand(band);
+  chain.configure(SAMPLE_RATE);
+  const unsigned settle = SAMPLE_RATE, measure = SAMPLE_RATE;
+  double squares = 0;
+  for (unsigned i = 0; i < settle + measure; i++) {
+    double x = 2048 + AMPLITUDE * sin(2 * M_PI * f * i / SAMPLE_RATE);
+    double y = (double)chain.process((uint16_t)lround(x)) - FILTER_ADC_MIDPOINT;
+    if (i >= settle) squares += y * y;
+  }
+  double amplitude = sqrt(2 * squares / measure);
+  return 20 * log10(amplitude / AMPLITUDE + 1e-9);
+}
+
+static void testFrequencyResponse() {
+  const double frequencies[] = { 20, 50, 100, 160, 300, 600, 1000, 2000, 4000, 6000, 8000 };
+  for (FilterChain::Band band : { FilterChain::WIDEBAND, FilterChain::BASS }) {
+    for (double f : frequencies) {
+      double expected = referenceGainDb(band, f);
+      double measured = measuredGainDb(band, f);
+      if (expected > -40) {
+        // 12-bit output rounding limits agreement deep in the skirt
+        CHECK_NEAR(measured, expected, expected > -20 ? 0.1 : 0.5);
+      } else {
+        CHECK(measured < -34);
+      }
+    }
+  }
+}
+
+static void testBlocksDc() {
+  FilterChain chain;
+  chain.setBand(FilterChain::WIDEBAND);
+  chain.configure(SAMPLE_RATE);
+  uint16_t y = 0;
+  for (unsigned i = 0; i < 2 * SAMPLE_RATE; i++) {
+    y = chain.process(2548);
+  }
+  CHECK_NEAR(y, FILTER_ADC_MIDPOINT, 1);
+}
+
+static void testOffPassesThrough() {
+  FilterChain chain;
+  bool same = true;
+  for (uint16_t s = 0; s < 4096; s++) same &= chain.process(s) == s;
+  CHECK(same);
+}
+
+// A redesign for a new sample rate keeps the state: no step in the output
+static void testRedesignKeepsState() {
+  FilterChain chain;
+  chain.setBand(FilterChain::BASS);
+  chain.configure(SAMPLE_RATE);
+  int previous = FILTER_ADC_MIDPOINT;
+  int largestStep = 0, switchStep = 0;
+  for (unsigned i = 0; i < 2 * SAMPLE_RATE; i++) {
+    if (i == SAMPLE_RATE) chain.configure(SAMPLE_RATE * 9 / 10);
+    double x = 2048 + AMPLITUDE * sin(2 * M_PI * 60 * i / SAMPLE_RATE);
+    int y = chain.process((uint16_t)lround(x));
+    int step = abs(y - previous);
+    if (i > SAMPLE_RATE / 2 && i < SAMPLE_RATE && step > largestStep) largestStep = step;
+    if (i == SAMPLE_RATE) switchStep = step;
+    previous = y;
+  }
+  CHECK(chain.getSampleRate() == SAMPLE_RATE * 9 / 10);
+  CHECK(switchStep <= largestStep + 2);
+}
+
+int main() {
+  testFrequencyResponse();
+  testBlocksDc();
+  testOffPassesThrough();
+  testRedesignKeepsState();
+  return checkResult();
+}
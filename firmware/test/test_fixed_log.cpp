@@ -0,0 +1,32 @@
+#include <math.h>
+#include "check.h"
+#include "FixedLog.h"
+
+// Q8.8: one LSB is 1/256 octave, about 0.024 dB
+#define MAX_ERROR_LSB 1.5
+
+int main() {
+  CHECK_EQ(FixedLog::log2Q8(0), 0);
+  CHECK_EQ(FixedLog::log2Q8(1), 0);
+  CHECK_EQ(FixedLog::log2Q8(4096), 12 * FIXED_LOG_ONE);
+
+  double worst = 0;
+  bool monotonic = true;
+  uint16_t previous = 0;
+  for (uint32_t x = 1; x <= (1UL << 20); x++) {
+    uint16_t y = FixedLog::log2Q8(x);
+    double error = fabs(y - log2((double)x) * FIXED_LOG_ONE);
+    if (error > worst) worst = error;
+    monotonic &= y >= previous;
+    previous = y;
+  }
+  // Above 2^20 only the top 13 bits matter; sample the rest of the range
+  for (uint32_t x = (1UL << 20); x < 0xFFFFFF00UL; x += 0x10001UL) {
+    double error = fabs(FixedLog::log2Q8(x) - log2((double)x) * FIXED_LOG_ONE);
+    if (error > worst) worst = error;
+  }
+  printf("log2Q8 worst error %.3f LSB (%.4f dB)\n", worst, worst * 20 * log10(2.0) / FIXED_LOG_ONE);
+  CHECK(worst <= MAX_ERROR_LSB);
+  CHECK(monotonic);
+  return checkResult();
+}
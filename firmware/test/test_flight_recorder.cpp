@@ -0,0 +1,173 @@
+#include <string.h>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "FastRandom.h"
+#include "FlightRecorder.h"
+
+// One decoded record; the same walk as simulator/src/vibelight/flight_log.py
+struct Record {
+  bool command;
+  uint32_t timeMs;
+  uint16_t signal;
+  uint8_t level;
+  uint8_t mask;
+  uint16_t loopMs;
+  std::string text;
+
+  bool operator==(const Record& o) const {
+    return command == o.command && timeMs == o.timeMs && text == o.text
+      && (command || (signal == o.signal && level == o.level && mask == o.mask && loopMs == o.loopMs));
+  }
+};
+
+static uint32_t getVarint(const uint8_t* block, unsigned& p) {
+  uint32_t value = 0;
+  for (unsigned shift = 0; p < FLIGHT_BLOCK_SIZE; shift += 7) {
+    uint8_t b = block[p++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return value;
+}
+
+static std::vector<Record> decode(const std::vector<uint8_t>& dump, std::vector<uint32_t>& sequences) {
+  std::vector<Record> records;
+  for (size_t start = 0; start + FLIGHT_BLOCK_SIZE <= dump.size(); start += FLIGHT_BLOCK_SIZE) {
+    const uint8_t* block = dump.data() + start;
+    if (block[0] != FLIGHT_BLOCK_MAGIC) break;
+    uint32_t sequence, timeMs;
+    uint16_t signal;
+    memcpy(&sequence, block + 1, 4);
+    memcpy(&timeMs, block + 5, 4);
+    memcpy(&signal, block + 9, 2);
+    uint8_t mask = block[11];
+    sequences.push_back(sequence);
+    unsigned p = FLIGHT_HEADER_SIZE;
+    while (p < FLIGHT_BLOCK_SIZE && block[p] != FLIGHT_RECORD_END) {
+      uint8_t header = block[p++];
+      Record r = {};
+      if ((header & 0xC0) == 0x40) {
+        uint8_t length = header & 0x3F;
+        timeMs += getVarint(block, p);
+        r.command = true;
+        r.timeMs = timeMs;
+        r.text.assign((const char*)block + p, length);
+        p += length;
+      } else {
+        timeMs += getVarint(block, p);
+        uint32_t z = getVarint(block, p);
+        signal = (uint16_t)(signal + (int32_t)((z >> 1) ^ -(int32_t)(z & 1)));
+        r.loopMs = (uint16_t)getVarint(block, p);
+        if (header & 0x20) mask = block[p++];
+        r.timeMs = timeMs;
+        r.signal = signal;
+        r.level = header & 0x0F;
+        r.mask = mask;
+      }
+      records.push_back(r);
+    }
+  }
+  return records;
+}
+
+static std::vector<uint8_t> dumpAll(FlightRecorder& recorder) {
+  std::vector<uint8_t> dump;
+  uint8_t chunk[48];
+  recorder.beginDump();
+  while (uint16_t n = recorder.readDump(chunk, sizeof(chunk))) {
+    dump.insert(dump.end(), chunk, chunk + n);
+  }
+  return dump;
+}
+
+// A show's worth of windows and commands, with the stamps the firmware
+// uses: windows at the loop start, commands a little later
+static std::vector<Record> record(FlightRecorder& recorder, unsigned windows) {
+  FastRandom rng(7);
+  std::vector<Record> expected;
+  uint32_t now = 123456;
+  uint16_t signal = 900;
+  uint8_t mask = 0;
+  const char* commands[] = { "L900", "H1950", "M3", "#12|G2;L850", "D40" };
+  for (unsigned w = 0; w < windows; w++) {
+    now += 14 + rng.below(3) + (rng.below(500) == 0 ? 70000 : 0);
+    signal = (uint16_t)(rng.below(8) == 0 ? rng.below(4096) : signal + rng.below(81) - 40) & 0x0FFF;
+    uint8_t level = (uint8_t)rng.below(9);
+    if (rng.below(4) == 0) mask = (uint8_t)rng.next();
+    uint16_t loopMs = (uint16_t)(14 + rng.below(3));
+    recorder.recordWindow(now, signal, level, mask, loopMs);
+    expected.push_back({ false, now, signal, level, mask, loopMs, "" });
+    if (rng.below(20) == 0) {
+      const char* text = commands[rng.below(5)];
+      recorder.recordCommand(now + 1, text, (uint8_t)strlen(text));
+      expected.push_back({ true, now + 1, 0, 0, 0, 0, text });
+    }
+  }
+  return expected;
+}
+
+static void testRoundTrip() {
+  FlightRecorder recorder(400);
+  std::vector<Record> expected = record(recorder, 5000);
+  std::vector<uint32_t> sequences;
+  std::vector<Record> decoded = decode(dumpAll(recorder), sequences);
+  CHECK_EQ(decoded.size(), expected.size());
+  CHECK(decoded == expected);
+  CHECK(!recorder.isDumping());
+}
+
+// After wrapping, the dump starts at the oldest surviving block and
+// decodes to the tail of what was recorded
+static void testWrap() {
+  FlightRecorder recorder(8);
+  std::vector<Record> expected = record(recorder, 5000);
+  std::vector<uint32_t> sequences;
+  std::vector<Record> decoded = decode(dumpAll(recorder), sequences);
+  CHECK_EQ(sequences.size(), 8);
+  bool consecutive = true;
+  for (size_t i = 1; i < sequences.size(); i++) consecutive &= sequences[i] == sequences[i - 1] + 1;
+  CHECK(consecutive);
+  CHECK(decoded.size() > 100);
+  CHECK(decoded.size() < expected.size());
+  std::vector<Record> tail(expected.end() - decoded.size(), expected.end());
+  CHECK(decoded == tail);
+}
+
+// A stamp older than the previous record must not wrap the unsigned delta
+static void testOlderStampClamps() {
+  FlightRecorder recorder(4);
+  recorder.recordWindow(1000, 500, 3, 0x0F, 14);
+  recorder.recordCommand(1016, "L900", 4);
+  recorder.recordWindow(1015, 510, 3, 0x0F, 15);
+  recorder.recordWindow(1030, 520, 4, 0x1F, 15);
+  std::vector<uint32_t> sequences;
+  std::vector<Record> decoded = decode(dumpAll(recorder), sequences);
+  CHECK_EQ(decoded.size(), 4);
+  if (decoded.size() == 4) {
+    CHECK_EQ(decoded[1].timeMs, 1016);
+    CHECK_EQ(decoded[2].timeMs, 1016);
+    CHECK_EQ(decoded[3].timeMs, 1030);
+  }
+}
+
+static void testDumpPausesRecording() {
+  FlightRecorder recorder(4);
+  recorder.recordWindow(1000, 500, 3, 0x0F, 14);
+  recorder.beginDump();
+  recorder.recordWindow(1014, 510, 3, 0x0F, 14);
+  uint8_t chunk[FLIGHT_BLOCK_SIZE];
+  CHECK_EQ(recorder.readDump(chunk, sizeof(chunk)), FLIGHT_BLOCK_SIZE);
+  CHECK(!recorder.isDumping());
+  std::vector<uint8_t> dump(chunk, chunk + FLIGHT_BLOCK_SIZE);
+  std::vector<uint32_t> sequences;
+  CHECK_EQ(decode(dump, sequences).size(), 1);
+}
+
+int main() {
+  testRoundTrip();
+  testWrap();
+  testOlderStampClamps();
+  testDumpPausesRecording();
+  return checkResult();
+}
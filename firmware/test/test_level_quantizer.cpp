@@ -0,0 +1,97 @@
+#include <initializer_list>
+#include <math.h>
+#include "check.h"
+#include "FastRandom.h"
+#include "LevelQuantizer.h"
+
+// What processSample() did before the quantizer
+static long mapLevel(long signal, long low, long high, long levels) {
+  long l = (signal - low) * levels / (high - low);
+  return l < 0 ? 0 : (l > levels ? levels : l);
+}
+
+static void testLinearMatchesMap() {
+  LevelQuantizer q(8, 0);
+  q.setRange(800, 1950);
+  bool same = true;
+  for (uint16_t s = 0; s < 4096; s++) {
+    same &= q.levelFor(s) == mapLevel(s, 800, 1950, 8);
+  }
+  CHECK(same);
+}
+
+static void testCurvesMonotonic() {
+  for (LevelQuantizer::Curve curve : { LevelQuantizer::LINEAR, LevelQuantizer::PERCEPTUAL, LevelQuantizer::DECIBEL }) {
+    LevelQuantizer q(8, 25);
+    q.setCurve(curve);
+    q.setRange(40, 3000);
+    bool monotonic = true;
+    uint8_t previous = 0;
+    for (uint16_t s = 0; s < 4096; s++) {
+      uint8_t l = q.levelFor(s);
+      monotonic &= l >= previous;
+      previous = l;
+    }
+    CHECK(monotonic);
+    CHECK_EQ(q.levelFor(39), 0);
+    CHECK_EQ(q.levelFor(3000), 8);
+  }
+}
+
+// A slow envelope with window-to-window noise narrower than the
+// hysteresis band (25% of a 144-wide step) stands in for a recorded track
+static unsigned countTransitions(uint8_t hysteresisPercent, unsigned& levelChanges) {
+  LevelQuantizer q(8, hysteresisPercent);
+  q.setRange(800, 1950);
+  FastRandom rng(5);
+  unsigned transitions = 0;
+  uint8_t previous = 0;
+  levelChanges = 0;
+  uint8_t previousTarget = 0;
+  for (unsigned w = 0; w < 20000; w++) {
+    double envelope = 1375 + 500 * sin(w * 2 * M_PI / 4000);
+    int noise = (int)rng.below(31) - 15;
+    uint16_t signal = (uint16_t)(envelope + noise);
+    uint8_t l = q.quantize(signal);
+    if (l != previous) transitions++;
+    previous = l;
+    uint8_t target = q.levelFor((uint16_t)envelope);
+    if (target != previousTarget) levelChanges++;
+    previousTarget = target;
+  }
+  return transitions;
+}
+
+static void testHysteresisTransitions() {
+  unsigned changes;
+  unsigned before = countTransitions(0, changes);
+  unsigned after = countTransitions(25, changes);
+  printf("transitions over 20000 windows: %u without hysteresis, %u with 25%%, %u in the clean envelope\n",
+    before, after, changes);
+  CHECK(after < before / 4);
+  // Real level changes still come through, each at most once per crossing
+  CHECK(after >= changes);
+  CHECK(after <= changes + changes / 4);
+}
+
+static void testHysteresisHoldsAndReleases() {
+  LevelQuantizer q(8, 25);
+  q.setRange(0, 800); // 100 per level
+  CHECK_EQ(q.quantize(300), 3);
+  CHECK_EQ(q.quantize(299), 3);
+  CHECK_EQ(q.quantize(276), 3);
+  CHECK_EQ(q.quantize(274), 2);
+  CHECK_EQ(q.quantize(299), 2);
+  CHECK_EQ(q.quantize(300), 3);
+  // Large drops fall through every level at once
+  CHECK_EQ(q.quantize(0), 0);
+  CHECK_EQ(q.quantize(800), 8);
+}
+
+int main() {
+  testLinearMatchesMap();
+  testCurvesMonotonic();
+  testHysteresisTransitions();
+  testHysteresisHoldsAndReleases();
+  return checkResult();
+}
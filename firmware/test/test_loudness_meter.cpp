@@ -0,0 +1,121 @@
+#include <math.h>
+#include "check.h"
+#include "LoudnessMeter.h"
+
+#define MIC_A 35
+#define MIC_B 34
+#define MIC_GAIN 32
+#define WINDOW_MS 14
+#define READ_MICROS 50 // 280 reads per window
+
+// Per-pin tone around an offset, clipped at the ADC rails
+static double amplitude[HOST_PIN_COUNT];
+static double offset[HOST_PIN_COUNT];
+
+static uint16_t tone(uint8_t pin) {
+  double t = Host::nowMicros / 1e6;
+  double v = offset[pin] + amplitude[pin] * sin(2 * M_PI * 250 * t);
+  return (uint16_t)(v < 0 ? 0 : (v > 4095 ? 4095 : lround(v)));
+}
+
+static LoudnessMeter makeMeter() {
+  LoudnessMeter mic(MIC_A, MIC_GAIN, WINDOW_MS, 800, 1950, 800, 1950);
+  mic.begin();
+  return mic;
+}
+
+static void testPeakToPeak() {
+  LoudnessMeter mic = makeMeter();
+  offset[MIC_A] = 2048;
+  amplitude[MIC_A] = 500;
+  mic.readAudioSample();
+  CHECK_EQ(mic.getSampleCount(), WINDOW_MS * 1000 / READ_MICROS);
+  CHECK_EQ(mic.getSampleRate(), 1000000 / READ_MICROS);
+  CHECK_NEAR(mic.getSignal(), 1000, 10);
+  CHECK_EQ(mic.getClipCount(), 0);
+}
+
+// Clips are counted per raw read, so the rate is the same with the
+// front end averaging four reads into one sample
+static void testClipsCountRawReads() {
+  LoudnessMeter mic = makeMeter();
+  offset[MIC_A] = 2048;
+  amplitude[MIC_A] = 3000;
+  mic.readAudioSample();
+  double plain = (double)mic.getClipCount() / mic.getSampleCount();
+  mic.setFrontEnd(true);
+  mic.readAudioSample();
+  CHECK_EQ(mic.getSampleCount(), WINDOW_MS * 1000 / READ_MICROS);
+  double frontEnd = (double)mic.getClipCount() / mic.getSampleCount();
+  CHECK(plain > 0.3);
+  CHECK_NEAR(frontEnd, plain, 0.05);
+}
+
+// Windows are not contiguous: the median must not mix in the last one
+static void testFrontEndStartsEachWindowFresh() {
+  LoudnessMeter mic = makeMeter();
+  mic.setFrontEnd(true);
+  amplitude[MIC_A] = 0;
+  offset[MIC_A] = 3000;
+  mic.readAudioSample();
+  offset[MIC_A] = 1000;
+  mic.readAudioSample();
+  CHECK_EQ(mic.getSignal(), 0);
+}
+
+static void testThresholdsFollowGain() {
+  LoudnessMeter mic = makeMeter();
+  mic.setGainStep(3162, 1000);
+  CHECK_EQ(mic.getLow(), 800);
+  CHECK_EQ(mic.getHigh(), 1950);
+  mic.setGain(LoudnessMeter::LOW_GAIN);
+  CHECK_NEAR(mic.getLow(), 80, 1);
+  CHECK_NEAR(mic.getHigh(), 195, 1);
+  mic.setGain(LoudnessMeter::HIGH_GAIN);
+  CHECK_EQ(mic.getLow(), 800);
+  CHECK_EQ(mic.getHigh(), 1950);
+
+  // Set at low gain beyond what high gain can show: clamped on read at
+  // high gain, but not lost on the way back
+  mic.setGain(LoudnessMeter::LOW_GAIN);
+  mic.setHigh(4000);
+  CHECK(!mic.thresholdsFit(LoudnessMeter::HIGH_GAIN));
+  CHECK(mic.thresholdsFit(LoudnessMeter::LOW_GAIN));
+  mic.setGain(LoudnessMeter::HIGH_GAIN);
+  CHECK_EQ(mic.getHigh(), MAX_SIGNAL);
+  CHECK(mic.getLow() < mic.getHigh());
+  mic.setGain(LoudnessMeter::LOW_GAIN);
+  CHECK_EQ(mic.getHigh(), 4000);
+}
+
+static void testCombinedInputs() {
+  const uint8_t pins[] = { MIC_A, MIC_B };
+  LoudnessMeter mic(MIC_A, MIC_GAIN, WINDOW_MS, 800, 1950, 800, 1950);
+  mic.setInputs(pins, 2);
+  mic.begin();
+  offset[MIC_A] = offset[MIC_B] = 2048;
+  amplitude[MIC_A] = 200;
+  amplitude[MIC_B] = 600;
+  mic.readAudioSample();
+  CHECK_EQ(mic.getSampleCount(), WINDOW_MS * 1000 / READ_MICROS);
+  CHECK_NEAR(mic.getChannelSignal(0), 400, 5);
+  CHECK_NEAR(mic.getChannelSignal(1), 1200, 10);
+  CHECK_NEAR(mic.getSignal(), 1200, 10);
+  CHECK_EQ(mic.getChannelRms(1), 0);
+  mic.setCombiner(LoudnessMeter::COMBINE_MEAN);
+  mic.setChannelRms(true);
+  mic.readAudioSample();
+  CHECK_NEAR(mic.getSignal(), 800, 10);
+  CHECK_NEAR(mic.getChannelRms(1), 600 / sqrt(2.0), 10);
+}
+
+int main() {
+  Host::analogSource = tone;
+  Host::analogReadMicros = READ_MICROS;
+  testPeakToPeak();
+  testClipsCountRawReads();
+  testFrontEndStartsEachWindowFresh();
+  testThresholdsFollowGain();
+  testCombinedInputs();
+  return checkResult();
+}
@@ -0,0 +1,263 @@
+#include "check.h"
+#include "EnvelopeFollower.h"
+#include "FastRandom.h"
+#include "ModeEngine.h"
+#include "TapTempo.h"
+#include "WireMask.h"
+
+#define ACTIVE_CHANNELS 8
+#define WINDOWS 20000
+
+// The ELSequencer calls the old modes made, recorded as a mask
+struct Sequencer {
+  uint8_t mask = 0;
+  FastRandom rng;
+
+  void lightNumWires(uint8_t num) { mask = WireMask::fullMask(num); }
+  void lightWiresAtIndex(uint8_t index) { mask = index < 8 ? 1 << index : 0; }
+  void lightNumWiresUpToWire(uint8_t num, uint8_t wireNum) {
+    mask = 0;
+    for (uint8_t i = 0; i < ACTIVE_CHANNELS; i++) {
+      if (wireNum > i && i + num >= wireNum) mask |= 1 << i;
+    }
+  }
+  void lightWiresByPattern(const uint8_t* pattern) {
+    mask = 0;
+    for (uint8_t i = 0; i < ACTIVE_CHANNELS; i++) {
+      if (pattern[i]) mask |= 1 << i;
+    }
+  }
+  void lightAll() { mask = 0xFF; }
+  void lightNone() { mask = 0; }
+  void lightRandomWires() { mask = (uint8_t)(rng.next() >> 24); }
+  void lightNumRandomWires(uint8_t num) { mask = WireMask::randomMask(rng, ACTIVE_CHANNELS, num); }
+  void swapRandomWires(uint8_t count) { mask = WireMask::swapBits(rng, mask, ACTIVE_CHANNELS, count); }
+  uint8_t getCurrentMask() { return mask; }
+};
+
+// The light modes as they were in firmware.ino before ModeEngine, with
+// their function statics turned into members so every run starts clean
+struct OldModes {
+  Sequencer sequencer;
+  uint16_t mappedSignal = 0;
+  uint8_t numWires = 8;
+  uint16_t delayMs = 25;
+  uint32_t nowMs = 0;
+  const TapTempo* tapTempo = nullptr;
+  EnvelopeFollower envelope{ 0, 0 };
+  EnvelopeFollower beatEnvelope{ 0, 0 };
+  uint32_t periodicAnchorMs = 0;
+  uint32_t lastPeriodicStep = UINT32_MAX;
+  uint16_t randomLast = 0;
+  uint16_t swapLast = 0;
+  uint8_t swapLastNumWires = 0;
+  uint16_t highLowLast = 0;
+  uint32_t lastHighMs = 0;
+  uint16_t sweepLast = 0;
+  uint8_t sweepStart = 0;
+
+  uint32_t millis() { return nowMs; }
+  uint16_t currentDelay() { return delayMs; }
+
+  void reactivePulse() {
+    if (numWires == 1) {
+      mappedSignal > 0 ? sequencer.lightWiresAtIndex(mappedSignal - 1) : sequencer.lightNumWires(0);
+    } else if (numWires == ACTIVE_CHANNELS) {
+      sequencer.lightNumWires(mappedSignal);
+    } else {
+      sequencer.lightNumWiresUpToWire(numWires, mappedSignal);
+    }
+  }
+
+  void reactivePulseWithDecay() {
+    envelope.setRelease(currentDelay());
+    uint8_t level = envelope.update(mappedSignal, millis());
+    sequencer.lightNumWiresUpToWire(numWires, level);
+  }
+
+  void reactiveBeatPulseDecay() {
+    const uint8_t THRESHOLD = 6;
+    beatEnvelope.setRelease(currentDelay());
+    uint8_t level = beatEnvelope.update(mappedSignal >= THRESHOLD ? mappedSignal : 0, millis());
+    sequencer.lightNumWiresUpToWire(numWires, level);
+  }
+
+  void reactiveRandomSimple() {
+    bool rising = mappedSignal > randomLast;
+    randomLast = mappedSignal;
+    if (rising && mappedSignal > 6) {
+      sequencer.lightNumRandomWires(numWires);
+    }
+  }
+
+  void reactiveRandomSwap() {
+    bool rising = mappedSignal > swapLast;
+    swapLast = mappedSignal;
+    if (rising && mappedSignal > 6) {
+      uint8_t litCount = WireMask::popcount(sequencer.getCurrentMask());
+      if (litCount != numWires || swapLastNumWires != numWires) {
+        sequencer.lightNumRandomWires(numWires);
+        swapLastNumWires = numWires;
+        return;
+      }
+      uint8_t darkCount = ACTIVE_CHANNELS - litCount;
+      uint8_t swapCount = (litCount >= 2 && darkCount >= 2) ? 2 : 1;
+      sequencer.swapRandomWires(swapCount);
+    }
+  }
+
+  void reactiveRandomHighLow() {
+    const uint8_t TH_MED = 2;
+    const uint8_t TH_HIGH = 7;
+    const uint32_t LOW_MODE_COOLDOWN_MS = 1000;
+    uint16_t cur = mappedSignal;
+    uint32_t now = millis();
+    bool rising = cur > highLowLast;
+    highLowLast = cur;
+    if (!rising) return;
+    if (cur >= TH_HIGH) {
+      lastHighMs = now;
+      uint8_t k = (numWires > ACTIVE_CHANNELS) ? ACTIVE_CHANNELS : numWires;
+      sequencer.lightNumRandomWires(k);
+      return;
+    }
+    if (cur >= TH_MED && (now - lastHighMs) >= LOW_MODE_COOLDOWN_MS) {
+      sequencer.lightNumRandomWires(1);
+    }
+  }
+
+  void reactiveLinearSweep() {
+    const uint8_t THRESHOLD = 6;
+    uint16_t cur = mappedSignal;
+    bool rising = cur > sweepLast;
+    sweepLast = cur;
+    if (!rising || cur <= THRESHOLD) return;
+    uint8_t pattern[ACTIVE_CHANNELS] = {};
+    for (uint8_t k = 0; k < numWires; k++) {
+      pattern[(sweepStart + k) % ACTIVE_CHANNELS] = 1;
+    }
+    sweepStart = (sweepStart + 1) % ACTIVE_CHANNELS;
+    sequencer.lightWiresByPattern(pattern);
+  }
+
+  bool periodicStepDue(uint8_t cycleLength, uint8_t& step) {
+    uint32_t now = millis();
+    uint32_t index = tapTempo->hasTempo()
+      ? tapTempo->position(now, cycleLength)
+      : (now - periodicAnchorMs) / currentDelay();
+    if (index == lastPeriodicStep) return false;
+    lastPeriodicStep = index;
+    step = index % cycleLength;
+    return true;
+  }
+
+  void periodicPulseUp() {
+    uint8_t step;
+    if (periodicStepDue(ACTIVE_CHANNELS + 1, step)) {
+      sequencer.lightWiresAtIndex(step);
+    }
+  }
+
+  void periodicPulseUpDown() {
+    uint8_t step;
+    if (periodicStepDue(2 * ACTIVE_CHANNELS - 2, step)) {
+      sequencer.lightWiresAtIndex(step < ACTIVE_CHANNELS ? step : 2 * ACTIVE_CHANNELS - 2 - step);
+    }
+  }
+
+  void periodicFlash() {
+    uint8_t step;
+    if (!periodicStepDue(2, step)) return;
+    if (step == 0) {
+      sequencer.lightAll();
+    } else {
+      sequencer.lightNone();
+    }
+  }
+
+  void periodicFlashWithDecay() {
+    uint8_t step;
+    if (!periodicStepDue(ACTIVE_CHANNELS + 1, step)) return;
+    if (step == 0) {
+      sequencer.lightAll();
+    } else {
+      sequencer.lightNumWires(ACTIVE_CHANNELS - step);
+    }
+  }
+
+  void periodicRandom() {
+    uint8_t step;
+    if (periodicStepDue(1, step)) {
+      sequencer.lightRandomWires();
+    }
+  }
+
+  void run(uint8_t mode) {
+    switch (mode) {
+      case 0: reactivePulse(); break;
+      case 1: reactivePulseWithDecay(); break;
+      case 2: reactiveBeatPulseDecay(); break;
+      case 3: reactiveRandomSimple(); break;
+      case 4: reactiveRandomSwap(); break;
+      case 5: reactiveRandomHighLow(); break;
+      case 6: reactiveLinearSweep(); break;
+      case 7: periodicPulseUp(); break;
+      case 8: periodicPulseUpDown(); break;
+      case 9: periodicFlash(); break;
+      case 10: periodicFlashWithDecay(); break;
+      case 11: periodicRandom(); break;
+    }
+  }
+};
+
+// Same levels, clock and random seed into both; the masks must agree on
+// every window
+static bool matchesOldMode(uint8_t mode, uint8_t numWires, bool tapped) {
+  TapTempo tapTempo(200, 1500);
+  uint32_t now = 5000;
+  if (tapped) {
+    for (int i = 0; i < 4; i++) tapTempo.tap(now - 2000 + i * 480);
+  }
+  OldModes old;
+  old.sequencer.rng.seed(1234);
+  old.numWires = numWires;
+  old.delayMs = (numWires * 37) % 300 + 10;
+  old.nowMs = now;
+  old.tapTempo = &tapTempo;
+  old.periodicAnchorMs = now;
+
+  ModeEngine engine(ACTIVE_CHANNELS, 0);
+  engine.seed(1234);
+  engine.setNumWires(numWires);
+  engine.setDelay(old.delayMs);
+  engine.setTapTempo(&tapTempo);
+  engine.setMode(mode, now);
+
+  FastRandom rng(mode * 100 + numWires);
+  for (int i = 0; i < WINDOWS; i++) {
+    now += 10 + rng.below(10);
+    uint16_t level = (uint16_t)rng.below(9);
+    if (rng.below(4) == 0) level = 8 - level / 3;
+    old.nowMs = now;
+    old.mappedSignal = level;
+    old.run(mode);
+    engine.run((uint8_t)level, now);
+    if (engine.getMask() != old.sequencer.mask) {
+      fprintf(stderr, "mode %u, %u wires%s: window %d old %02X new %02X\n",
+        mode, numWires, tapped ? ", tapped" : "", i, old.sequencer.mask, engine.getMask());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  CHECK_EQ(getModeCount(), 12);
+  for (uint8_t mode = 0; mode < getModeCount(); mode++) {
+    for (uint8_t numWires = 1; numWires <= ACTIVE_CHANNELS; numWires++) {
+      CHECK(matchesOldMode(mode, numWires, false));
+      if (mode >= 7) CHECK(matchesOldMode(mode, numWires, true));
+    }
+  }
+  return checkResult();
+}
@@ -0,0 +1,149 @@
+#include <initializer_list>
+#include <vector>
+#include "check.h"
+#include "FastRandom.h"
+#include "PushButtons.h"
+
+#define PIN_A 25
+#define PIN_B 26
+#define DEBOUNCE_MS 5
+#define DOUBLE_CLICK_MS 300
+#define LONG_PRESS_MS 600
+
+static FastRandom rng(1);
+
+// Contact bounce: the pin toggles every 0-1 ms, each edge through the
+// ISR, before settling at the final level. Returns the first edge's time.
+static uint32_t bounce(uint8_t pin, uint8_t level, unsigned edges) {
+  uint32_t start = millis();
+  for (unsigned i = 0; i < edges; i++) {
+    Host::setPin(pin, i % 2 == 0 ? level : !level);
+    Host::advanceMillis(rng.below(2));
+  }
+  Host::setPin(pin, level);
+  return start;
+}
+
+// Runs the loop for `ms` milliseconds, collecting events
+static std::vector<ButtonEvent> run(uint32_t ms) {
+  std::vector<ButtonEvent> events;
+  for (uint32_t i = 0; i < ms; i++) {
+    pushButtonsUpdate(millis());
+    ButtonEvent e;
+    while (pushButtonsPoll(e)) events.push_back(e);
+    Host::advanceMillis(1);
+  }
+  return events;
+}
+
+static bool matches(const std::vector<ButtonEvent>& events, std::initializer_list<ButtonEvent> expected) {
+  if (events.size() != expected.size()) return false;
+  size_t i = 0;
+  for (const ButtonEvent& e : expected) {
+    const ButtonEvent& a = events[i++];
+    if (a.gesture != e.gesture || a.button != e.button || a.timeMs != e.timeMs) return false;
+  }
+  return true;
+}
+
+static void append(std::vector<ButtonEvent>& to, const std::vector<ButtonEvent>& from) {
+  to.insert(to.end(), from.begin(), from.end());
+}
+
+static void testClick() {
+  uint32_t t = bounce(PIN_A, LOW, 6);
+  std::vector<ButtonEvent> events = run(80);
+  bounce(PIN_A, HIGH, 4);
+  append(events, run(DOUBLE_CLICK_MS + 100));
+  CHECK(matches(events, { { ButtonGesture::Press, 0, t }, { ButtonGesture::Click, 0, t } }));
+}
+
+static void testDoubleClick() {
+  uint32_t t = bounce(PIN_A, LOW, 8);
+  std::vector<ButtonEvent> events = run(60);
+  bounce(PIN_A, HIGH, 5);
+  append(events, run(100));
+  uint32_t t2 = bounce(PIN_A, LOW, 3);
+  append(events, run(60));
+  bounce(PIN_A, HIGH, 7);
+  append(events, run(DOUBLE_CLICK_MS + 100));
+  CHECK(matches(events, { { ButtonGesture::Press, 0, t }, { ButtonGesture::Press, 0, t2 }, { ButtonGesture::DoubleClick, 0, t2 } }));
+}
+
+static void testLongPress() {
+  uint32_t t = bounce(PIN_A, LOW, 5);
+  std::vector<ButtonEvent> events = run(LONG_PRESS_MS + 300);
+  bounce(PIN_A, HIGH, 5);
+  append(events, run(DOUBLE_CLICK_MS + 100));
+  CHECK(matches(events, { { ButtonGesture::Press, 0, t }, { ButtonGesture::LongPress, 0, t } }));
+}
+
+static void testChord() {
+  uint32_t t = bounce(PIN_A, LOW, 5);
+  std::vector<ButtonEvent> events = run(40);
+  uint32_t t2 = bounce(PIN_B, LOW, 5);
+  append(events, run(200));
+  bounce(PIN_A, HIGH, 4);
+  bounce(PIN_B, HIGH, 4);
+  append(events, run(LONG_PRESS_MS + 100));
+  // The press completing the chord is not reported as a Press (a tap)
+  CHECK(matches(events, { { ButtonGesture::Press, 0, t }, { ButtonGesture::Chord, 0x03, t2 } }));
+}
+
+// Both buttons settling in the same update: the first one's Press is
+// withdrawn before it is polled, so only the chord comes out
+static void testChordInOneUpdate() {
+  uint32_t t = bounce(PIN_A, LOW, 3);
+  uint32_t t2 = bounce(PIN_B, LOW, 4);
+  Host::advanceMillis(DEBOUNCE_MS);
+  std::vector<ButtonEvent> events = run(200);
+  bounce(PIN_A, HIGH, 4);
+  bounce(PIN_B, HIGH, 4);
+  append(events, run(LONG_PRESS_MS + 100));
+  CHECK(t2 >= t);
+  CHECK(matches(events, { { ButtonGesture::Chord, 0x03, t2 } }));
+}
+
+// A glitch shorter than the debounce time is not a press
+static void testGlitch() {
+  Host::setPin(PIN_A, LOW);
+  Host::advanceMillis(DEBOUNCE_MS - 3);
+  Host::setPin(PIN_A, HIGH);
+  CHECK(run(DOUBLE_CLICK_MS + 100).empty());
+}
+
+static void testBouncyClicks() {
+  unsigned presses = 0, clicks = 0, other = 0;
+  bool dated = true;
+  for (int i = 0; i < 200; i++) {
+    uint32_t t = bounce(PIN_A, LOW, rng.below(10));
+    std::vector<ButtonEvent> events = run(30 + rng.below(200));
+    bounce(PIN_A, HIGH, rng.below(10));
+    append(events, run(DOUBLE_CLICK_MS + 100));
+    for (const ButtonEvent& e : events) {
+      if (e.gesture == ButtonGesture::Press) presses++;
+      else if (e.gesture == ButtonGesture::Click) clicks++;
+      else other++;
+      dated &= e.timeMs == t;
+    }
+  }
+  CHECK_EQ(presses, 200);
+  CHECK_EQ(clicks, 200);
+  CHECK_EQ(other, 0);
+  CHECK(dated);
+}
+
+int main() {
+  const uint8_t pins[] = { PIN_A, PIN_B };
+  Host::setMillis(1000);
+  pushButtonsBegin(pins, 2, DEBOUNCE_MS, DOUBLE_CLICK_MS, LONG_PRESS_MS);
+  CHECK(run(10).empty());
+  testClick();
+  testDoubleClick();
+  testLongPress();
+  testChord();
+  testChordInOneUpdate();
+  testGlitch();
+  testBouncyClicks();
+  return checkResult();
+}
@@ -0,0 +1,93 @@
+#include <initializer_list>
+#include <math.h>
+#include <vector>
+#include "check.h"
+#include "FastRandom.h"
+#include "RiceCodec.h"
+
+// Bit-exact reader for the frame described in RiceCodec.h; the same
+// walk as simulator/src/vibelight/capture_receiver.py
+struct BitReader {
+  const uint8_t* data;
+  size_t length;
+  size_t bit;
+
+  uint32_t get(uint8_t count) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      size_t byte = bit >> 3;
+      uint8_t b = byte < length ? data[byte] : 0;
+      value = (value << 1) | ((b >> (7 - (bit & 7))) & 1);
+      bit++;
+    }
+    return value;
+  }
+};
+
+static std::vector<uint16_t> decode(const uint8_t* frame, size_t length, uint16_t& sampleRate) {
+  BitReader r = { frame, length, 0 };
+  uint16_t count = (uint16_t)(r.get(8) | (r.get(8) << 8));
+  sampleRate = (uint16_t)(r.get(8) | (r.get(8) << 8));
+  uint16_t previous = (uint16_t)(r.get(8) | (r.get(8) << 8));
+  std::vector<uint16_t> samples;
+  if (count == 0) return samples;
+  samples.push_back(previous);
+  while (samples.size() < count) {
+    uint8_t k = (uint8_t)r.get(4);
+    for (unsigned i = 0; i < RICE_BLOCK_SAMPLES && samples.size() < count; i++) {
+      uint32_t q = 0;
+      while (q < RICE_ESCAPE_QUOTIENT && r.get(1)) q++;
+      uint32_t residual = q == RICE_ESCAPE_QUOTIENT ? r.get(16) : (q << k) | r.get(k);
+      int32_t delta = (int32_t)(residual >> 1) ^ -(int32_t)(residual & 1);
+      previous = (uint16_t)(previous + delta);
+      samples.push_back(previous);
+    }
+  }
+  return samples;
+}
+
+static double roundTrip(const std::vector<uint16_t>& samples) {
+  std::vector<uint8_t> frame(samples.size() * 3 + 16);
+  uint16_t length = RiceCodec::encode(samples.data(), (uint16_t)samples.size(), 20000, frame.data(), (uint16_t)frame.size());
+  CHECK(length > 0);
+  uint16_t rate = 0;
+  std::vector<uint16_t> decoded = decode(frame.data(), length, rate);
+  CHECK_EQ(rate, 20000);
+  CHECK(decoded == samples);
+  return samples.empty() ? 0 : (double)length / (samples.size() * 2);
+}
+
+int main() {
+  FastRandom rng(11);
+  std::vector<uint16_t> samples(280);
+
+  // Microphone-like: a few tones plus noise around the bias
+  for (unsigned i = 0; i < samples.size(); i++) {
+    samples[i] = (uint16_t)lround(2048 + 400 * sin(i * 0.07) + 150 * sin(i * 0.53) + (int)rng.below(21) - 10);
+  }
+  double ratio = roundTrip(samples);
+  printf("microphone-like window: %.2f of 16-bit size\n", ratio);
+  CHECK(ratio < 0.6);
+
+  // Silence, white noise over the full scale, rail-to-rail jumps (escapes)
+  for (auto& s : samples) s = 2048;
+  CHECK(roundTrip(samples) < 0.2);
+  for (auto& s : samples) s = (uint16_t)rng.below(4096);
+  roundTrip(samples);
+  for (unsigned i = 0; i < samples.size(); i++) samples[i] = i % 2 ? 4095 : 0;
+  roundTrip(samples);
+  for (unsigned i = 0; i < samples.size(); i++) samples[i] = i % 37 == 0 ? 4095 : 2048 + (int)rng.below(5);
+  roundTrip(samples);
+
+  // Lengths around the block size, and the empty and single-sample frames
+  for (unsigned n : { 0u, 1u, 2u, 32u, 33u, 64u, 65u, 1000u }) {
+    std::vector<uint16_t> v(n);
+    for (auto& s : v) s = (uint16_t)(2048 + rng.below(200));
+    roundTrip(v);
+  }
+
+  // A frame that does not fit reports 0 instead of a truncated frame
+  uint8_t small[8];
+  CHECK_EQ(RiceCodec::encode(samples.data(), (uint16_t)samples.size(), 20000, small, sizeof(small)), 0);
+  return checkResult();
+}
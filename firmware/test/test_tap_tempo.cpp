@@ -0,0 +1,92 @@
+#include <math.h>
+#include "check.h"
+#include "FastRandom.h"
+#include "TapTempo.h"
+
+#define TRIALS 500
+#define BEATS 8
+
+struct Case {
+  const char* name;
+  double periodMs;
+  double jitterMs; // taps land within +-jitter of the beat
+  bool doubleTap; // an extra tap 80 ms after the fourth
+  bool missedBeat; // the fifth beat is not tapped
+};
+
+// Triangular in [-1, 1]: a human's error clusters around the beat
+static double jitter(FastRandom& rng) {
+  return (rng.below(1001) + rng.below(1001)) / 1000.0 - 1;
+}
+
+static void runCase(const Case& c, FastRandom& rng) {
+  double sumError = 0, worstError = 0, worstPhase = 0;
+  unsigned noTempo = 0;
+  for (int trial = 0; trial < TRIALS; trial++) {
+    TapTempo tempo(200, 1500);
+    double start = 10000 + rng.below(1000);
+    for (int b = 0; b < BEATS; b++) {
+      if (c.missedBeat && b == 4) continue;
+      double t = start + b * c.periodMs + c.jitterMs * jitter(rng);
+      tempo.tap((uint32_t)lround(t));
+      if (c.doubleTap && b == 3) tempo.tap((uint32_t)lround(t + 80));
+    }
+    if (!tempo.hasTempo()) {
+      noTempo++;
+      continue;
+    }
+    double error = fabs(tempo.getPeriodMs() - c.periodMs);
+    sumError += error;
+    if (error > worstError) worstError = error;
+    // Three beats after the last tap the grid should still be on the beat
+    double beat = start + (BEATS + 2) * c.periodMs;
+    uint32_t position = tempo.position((uint32_t)lround(beat), 100);
+    double phase = fmod(position / 100.0 + 0.5, 1.0) - 0.5;
+    if (fabs(phase * c.periodMs) > worstPhase) worstPhase = fabs(phase * c.periodMs);
+  }
+  double meanError = sumError / (TRIALS - noTempo);
+  printf("%-34s mean |dP| %.1f ms, worst %.1f ms, worst phase %.0f ms, no tempo %u/%d\n",
+    c.name, meanError, worstError, worstPhase, noTempo, TRIALS);
+  CHECK_EQ(noTempo, 0);
+  CHECK(meanError <= c.jitterMs / 4 + 1);
+  CHECK(worstError <= c.jitterMs / 2 + 1);
+  CHECK(worstPhase <= c.jitterMs * 2 + 2);
+}
+
+static void testJitteredSequences() {
+  const Case cases[] = {
+    { "120 bpm, +-10 ms", 500, 10, false, false },
+    { "120 bpm, +-25 ms", 500, 25, false, false },
+    { "90 bpm, +-20 ms, one double tap", 666.7, 20, true, false },
+    { "140 bpm, +-15 ms, one missed beat", 428.6, 15, false, true },
+    { "175 bpm, +-8 ms", 342.9, 8, false, false },
+    { "60 bpm, +-30 ms", 1000, 30, false, false },
+  };
+  FastRandom rng(3);
+  for (const Case& c : cases) runCase(c, rng);
+}
+
+static void testLimits() {
+  TapTempo tempo(200, 1500);
+  CHECK(!tempo.tap(1000));
+  CHECK(!tempo.tap(1100));
+  CHECK(!tempo.tap(1200)); // 100 ms is faster than the minimum period
+  tempo.clear();
+  CHECK(!tempo.tap(1000));
+  CHECK(!tempo.tap(1500));
+  CHECK(tempo.tap(2000));
+  CHECK_EQ(tempo.getPeriodMs(), 500);
+  CHECK_EQ(tempo.getBpm(), 120);
+  // A long pause starts a new sequence; the old tempo holds meanwhile
+  CHECK(tempo.tap(10000));
+  CHECK(tempo.tap(10400));
+  CHECK_EQ(tempo.getPeriodMs(), 500);
+  CHECK(tempo.tap(10800));
+  CHECK_EQ(tempo.getPeriodMs(), 400);
+}
+
+int main() {
+  testJitteredSequences();
+  testLimits();
+  return checkResult();
+}
@@ -0,0 +1,125 @@
+#include <initializer_list>
+#include <math.h>
+#include <map>
+#include "check.h"
+#include "FastRandom.h"
+#include "WireMask.h"
+
+// Chi-square critical value at p = 0.001 (Wilson-Hilferty). With fixed
+// seeds the outcome is deterministic; the margin only has to hold once.
+static double chiSquareLimit(unsigned degrees) {
+  double d = degrees;
+  double t = 1 - 2 / (9 * d) + 3.09 * sqrt(2 / (9 * d));
+  return d * t * t * t;
+}
+
+static double chiSquare(const std::map<uint32_t, unsigned>& counts, unsigned categories, unsigned draws) {
+  double expected = (double)draws / categories;
+  double sum = 0;
+  for (const auto& c : counts) {
+    sum += (c.second - expected) * (c.second - expected) / expected;
+  }
+  // Categories never drawn
+  sum += (categories - counts.size()) * expected;
+  return sum;
+}
+
+static void testBelow() {
+  FastRandom rng(12345);
+  for (uint32_t bound : { 2u, 3u, 7u, 9u, 70u, 1000u }) {
+    std::map<uint32_t, unsigned> counts;
+    unsigned draws = bound * 2000;
+    bool inRange = true;
+    for (unsigned i = 0; i < draws; i++) {
+      uint32_t v = rng.below(bound);
+      inRange &= v < bound;
+      counts[v]++;
+    }
+    CHECK(inRange);
+    CHECK(chiSquare(counts, bound, draws) < chiSquareLimit(bound - 1));
+  }
+  CHECK_EQ(rng.below(0), 0);
+}
+
+static void testSeed() {
+  FastRandom a(0), b(0x9E3779B9UL);
+  CHECK_EQ(a.next(), b.next());
+  FastRandom c(7), d(7);
+  bool same = true;
+  for (int i = 0; i < 100; i++) same &= c.next() == d.next();
+  CHECK(same);
+}
+
+static void testRandomMaskUniform() {
+  FastRandom rng(2024);
+  for (uint8_t n = 1; n <= 8; n++) {
+    for (uint8_t k = 0; k <= n; k++) {
+      unsigned categories = WireMask::binomial(n, k);
+      unsigned draws = categories * 1000;
+      std::map<uint32_t, unsigned> counts;
+      bool valid = true;
+      for (unsigned i = 0; i < draws; i++) {
+        uint8_t m = WireMask::randomMask(rng, n, k);
+        valid &= WireMask::popcount(m) == k && (m & ~WireMask::fullMask(n)) == 0;
+        counts[m]++;
+      }
+      CHECK(valid);
+      CHECK_EQ(counts.size(), categories);
+      if (categories > 1) {
+        CHECK(chiSquare(counts, categories, draws) < chiSquareLimit(categories - 1));
+      }
+    }
+  }
+}
+
+static void testDepositBits() {
+  bool same = true;
+  for (unsigned mask = 0; mask < 256; mask++) {
+    for (unsigned src = 0; src < 256; src++) {
+      uint8_t expected = 0;
+      uint8_t bit = 0;
+      for (uint8_t i = 0; i < 8; i++) {
+        if (mask & (1 << i)) {
+          if (src & (1 << bit)) expected |= 1 << i;
+          bit++;
+        }
+      }
+      same &= WireMask::depositBits(src, mask) == expected;
+    }
+  }
+  CHECK(same);
+}
+
+static void testSwapBits() {
+  FastRandom rng(99);
+  // Three of eight lit, swap two: every (2 of 3 off) x (2 of 5 on) pair
+  const uint8_t start = 0x23;
+  unsigned categories = WireMask::binomial(3, 2) * WireMask::binomial(5, 2);
+  unsigned draws = categories * 1000;
+  std::map<uint32_t, unsigned> counts;
+  bool valid = true;
+  for (unsigned i = 0; i < draws; i++) {
+    uint8_t m = WireMask::swapBits(rng, start, 8, 2);
+    valid &= WireMask::popcount(m) == 3;
+    valid &= WireMask::popcount(m & start) == 1;
+    counts[m]++;
+  }
+  CHECK(valid);
+  CHECK_EQ(counts.size(), categories);
+  CHECK(chiSquare(counts, categories, draws) < chiSquareLimit(categories - 1));
+
+  // k is clamped to the wires available on each side
+  CHECK_EQ(WireMask::swapBits(rng, 0xFF, 8, 2), 0xFF);
+  CHECK_EQ(WireMask::swapBits(rng, 0x00, 8, 2), 0x00);
+  CHECK_EQ(WireMask::popcount(WireMask::swapBits(rng, 0x01, 4, 3)), 1);
+  CHECK_EQ(WireMask::swapBits(rng, 0x0F, 4, 1) & 0xF0, 0);
+}
+
+int main() {
+  testBelow();
+  testSeed();
+  testRandomMaskUniform();
+  testDepositBits();
+  testSwapBits();
+  return checkResult();
+}
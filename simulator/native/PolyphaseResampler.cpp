@@ -0,0 +1,159 @@
+#include "PolyphaseResampler.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+namespace {
+  double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+      term *= (x / (2 * k)) * (x / (2 * k));
+      sum += term;
+      if (term < sum * 1e-12) break;
+    }
+    return sum;
+  }
+
+  // Dot products of x with two coefficient rows at once; length is a
+  // multiple of 8. Both phases share every load of x.
+  inline void dot2(const float* x, const float* c0, const float* c1, uint16_t length, float& a, float& b) {
+#if defined(RESAMPLER_SSE2)
+    __m128 a0 = _mm_setzero_ps(), a1 = _mm_setzero_ps();
+    __m128 b0 = _mm_setzero_ps(), b1 = _mm_setzero_ps();
+    for (uint16_t i = 0; i < length; i += 8) {
+      __m128 x0 = _mm_loadu_ps(x + i);
+      __m128 x1 = _mm_loadu_ps(x + i + 4);
+      a0 = _mm_add_ps(a0, _mm_mul_ps(x0, _mm_loadu_ps(c0 + i)));
+      a1 = _mm_add_ps(a1, _mm_mul_ps(x1, _mm_loadu_ps(c0 + i + 4)));
+      b0 = _mm_add_ps(b0, _mm_mul_ps(x0, _mm_loadu_ps(c1 + i)));
+      b1 = _mm_add_ps(b1, _mm_mul_ps(x1, _mm_loadu_ps(c1 + i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(a0, a1));
+    a = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, _mm_add_ps(b0, b1));
+    b = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t a0 = vdupq_n_f32(0), a1 = vdupq_n_f32(0);
+    float32x4_t b0 = vdupq_n_f32(0), b1 = vdupq_n_f32(0);
+    for (uint16_t i = 0; i < length; i += 8) {
+      float32x4_t x0 = vld1q_f32(x + i);
+      float32x4_t x1 = vld1q_f32(x + i + 4);
+      a0 = vmlaq_f32(a0, x0, vld1q_f32(c0 + i));
+      a1 = vmlaq_f32(a1, x1, vld1q_f32(c0 + i + 4));
+      b0 = vmlaq_f32(b0, x0, vld1q_f32(c1 + i));
+      b1 = vmlaq_f32(b1, x1, vld1q_f32(c1 + i + 4));
+    }
+    float32x4_t sa = vaddq_f32(a0, a1), sb = vaddq_f32(b0, b1);
+    a = (vgetq_lane_f32(sa, 0) + vgetq_lane_f32(sa, 1)) + (vgetq_lane_f32(sa, 2) + vgetq_lane_f32(sa, 3));
+    b = (vgetq_lane_f32(sb, 0) + vgetq_lane_f32(sb, 1)) + (vgetq_lane_f32(sb, 2) + vgetq_lane_f32(sb, 3));
+#else
+    float sa[4] = { 0, 0, 0, 0 }, sb[4] = { 0, 0, 0, 0 };
+    for (uint16_t i = 0; i < length; i += 4) {
+      for (uint8_t j = 0; j < 4; j++) {
+        sa[j] += x[i + j] * c0[i + j];
+        sb[j] += x[i + j] * c1[i + j];
+      }
+    }
+    a = (sa[0] + sa[1]) + (sa[2] + sa[3]);
+    b = (sb[0] + sb[1]) + (sb[2] + sb[3]);
+#endif
+  }
+}
+
+PolyphaseResampler::PolyphaseResampler(double inputRate, double outputRate, double cutoffHz) {
+  this->inputRate = inputRate;
+  this->outputRate = outputRate;
+  this->cutoffHz = cutoffHz;
+  design();
+  reset();
+}
+
+void PolyphaseResampler::design() {
+  double lower = inputRate < outputRate ? inputRate : outputRate;
+  if (cutoffHz <= 0) cutoffHz = 0.45 * lower;
+  if (cutoffHz > 0.49 * lower) cutoffHz = 0.49 * lower;
+  step = inputRate / outputRate;
+
+  // Kaiser's estimate of the length for the attenuation over a transition
+  // band from the cutoff to its alias, both in cycles per input sample
+  double transition = (lower - 2 * cutoffHz) / inputRate;
+  double length = (RESAMPLER_STOPBAND_DB - 7.95) / (14.36 * transition);
+  uint32_t n = ((uint32_t)ceil(length) + 7) & ~7U;
+  taps = (uint16_t)(n < 8 ? 8 : n > RESAMPLER_MAX_TAPS ? RESAMPLER_MAX_TAPS : n);
+
+  // The sinc's -6 dB point sits mid-transition, at the lower Nyquist
+  double beta = 0.1102 * (RESAMPLER_STOPBAND_DB - 8.7);
+  double fc = 0.5 * lower / inputRate;
+  double half = taps / 2;
+  coefficients.assign((size_t)(RESAMPLER_PHASES + 1) * taps, 0.0f);
+  for (uint16_t p = 0; p <= RESAMPLER_PHASES; p++) {
+    float* row = &coefficients[(size_t)p * taps];
+    double frac = (double)p / RESAMPLER_PHASES;
+    double sum = 0;
+    for (uint16_t k = 0; k < taps; k++) {
+      // Distance from the output instant back to input sample k
+      double t = frac + half - 1 - k;
+      double r = t / half;
+      double window = r * r < 1 ? besselI0(beta * sqrt(1 - r * r)) / besselI0(beta) : 0;
+      double sinc = t == 0 ? 1 : sin(M_PI * 2 * fc * t) / (M_PI * 2 * fc * t);
+      double h = 2 * fc * sinc * window;
+      row[k] = (float)h;
+      sum += h;
+    }
+    // Unity gain at DC for every fractional delay
+    for (uint16_t k = 0; k < taps; k++) {
+      row[k] = (float)(row[k] / sum);
+    }
+  }
+}
+
+void PolyphaseResampler::reset() {
+  // Silence before the stream, so the first output sits on the first input
+  history.assign(taps / 2 - 1, 0.0f);
+  outputIndex = 0;
+  consumed = 0;
+}
+
+size_t PolyphaseResampler::maxOutput(size_t inputCount) const {
+  return (size_t)((history.size() + inputCount) / step) + 2;
+}
+
+// Appends the block to the stream; writes every output sample whose
+// filter span is now complete and returns how many
+size_t PolyphaseResampler::process(const float* input, size_t inputCount, float* output) {
+  history.insert(history.end(), input, input + inputCount);
+  const size_t half = taps / 2;
+  size_t produced = 0;
+  for (;;) {
+    // From the absolute output index, so rounding does not depend on how
+    // the stream was split into blocks
+    double position = outputIndex * step - (double)consumed + (double)(half - 1);
+    size_t base = (size_t)position;
+    if (base + half >= history.size()) break;
+    double phase = (position - base) * RESAMPLER_PHASES;
+    uint16_t p = (uint16_t)phase;
+    if (p >= RESAMPLER_PHASES) p = RESAMPLER_PHASES - 1;
+    float mu = (float)(phase - p);
+    float a, b;
+    dot2(&history[base + 1 - half], &coefficients[(size_t)p * taps], &coefficients[(size_t)(p + 1) * taps], taps, a, b);
+    output[produced++] = a + mu * (b - a);
+    outputIndex++;
+  }
+
+  // Drop input no later output reaches back to
+  double next = outputIndex * step - (double)consumed + (double)(half - 1);
+  size_t keepFrom = (size_t)next + 1 - half;
+  if (keepFrom > 0) {
+    history.erase(history.begin(), history.begin() + keepFrom);
+    consumed += keepFrom;
+  }
+  return produced;
+}
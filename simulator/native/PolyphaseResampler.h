@@ -0,0 +1,50 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define RESAMPLER_PHASES 128 // fractional delays tabulated, interpolated between
+#define RESAMPLER_STOPBAND_DB 80.0
+#define RESAMPLER_MAX_TAPS 1024
+
+// Streaming band-limited resampler between arbitrary rates, for turning
+// host audio (44.1/48 kHz) into the stream the ESP32's ADC loop sees.
+// A Kaiser-windowed sinc is tabulated at RESAMPLER_PHASES fractional
+// delays; each output sample is the dot product of the input around it
+// with the two nearest phases, interpolated linearly. Input may arrive in
+// blocks of any size: the filter history and the fractional read position
+// carry over, so output is the same however the stream is split.
+//
+// The passband ends at cutoffHz and the stopband starts where content
+// would alias back below it (outputRate - cutoffHz when downsampling).
+class PolyphaseResampler {
+public:
+  // cutoffHz <= 0 picks 90% of the lower Nyquist frequency; above 98% it
+  // is clamped so the filter stays finite
+  PolyphaseResampler(double inputRate, double outputRate, double cutoffHz = 0);
+
+  void reset();
+  size_t maxOutput(size_t inputCount) const;
+  size_t process(const float* input, size_t inputCount, float* output);
+
+  double getInputRate() const { return inputRate; }
+  double getOutputRate() const { return outputRate; }
+  double getCutoff() const { return cutoffHz; }
+  uint16_t getTapCount() const { return taps; }
+
+private:
+  void design();
+  double inputRate;
+  double outputRate;
+  double cutoffHz;
+  double step; // input samples per output sample
+  uint16_t taps; // per phase, a multiple of 8
+  std::vector<float> coefficients; // (RESAMPLER_PHASES + 1) rows of taps
+  std::vector<float> history; // unconsumed input, oldest first
+  uint64_t outputIndex; // output samples produced since reset
+  uint64_t consumed; // input samples dropped from history since reset
+};
+
+#endif
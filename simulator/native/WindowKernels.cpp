@@ -0,0 +1,316 @@
+#include "WindowKernels.h"
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KERNELS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define KERNELS_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define KERNELS_NEON
+#endif
+
+// Vectors summed in 32-bit (int16) or float lanes before flushing to the
+// wide totals: no int32 overflow, and float rounding stays per block
+#define KERNELS_INT16_BLOCK 8192
+#define KERNELS_FLOAT_BLOCK 1024
+
+namespace {
+  void startStats(Int16Stats& stats) {
+    stats.min = INT16_MAX;
+    stats.max = INT16_MIN;
+    stats.sum = 0;
+    stats.sumSquares = 0;
+  }
+
+  void startStats(FloatStats& stats) {
+    stats.min = INFINITY;
+    stats.max = -INFINITY;
+    stats.sum = 0;
+    stats.sumSquares = 0;
+  }
+
+  // Also finishes the tails the vector kernels leave
+  void addScalar(const int16_t* samples, size_t count, Int16Stats& stats) {
+    for (size_t i = 0; i < count; i++) {
+      int16_t v = samples[i];
+      if (v < stats.min) stats.min = v;
+      if (v > stats.max) stats.max = v;
+      stats.sum += v;
+      stats.sumSquares += (uint32_t)((int32_t)v * v);
+    }
+  }
+
+  void addScalar(const float* samples, size_t count, FloatStats& stats) {
+    for (size_t i = 0; i < count; i++) {
+      float v = samples[i];
+      if (v < stats.min) stats.min = v;
+      if (v > stats.max) stats.max = v;
+      stats.sum += v;
+      stats.sumSquares += (double)v * v;
+    }
+  }
+
+  [[maybe_unused]] void reduceScalar(const int16_t* samples, size_t count, Int16Stats& stats) {
+    startStats(stats);
+    addScalar(samples, count, stats);
+  }
+
+  [[maybe_unused]] void reduceScalar(const float* samples, size_t count, FloatStats& stats) {
+    startStats(stats);
+    addScalar(samples, count, stats);
+  }
+
+#if defined(KERNELS_SSE2)
+  void reduceSse2(const int16_t* samples, size_t count, Int16Stats& stats) {
+    startStats(stats);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i low = _mm_set1_epi16(INT16_MAX);
+    __m128i high = _mm_set1_epi16(INT16_MIN);
+    __m128i squares = zero;
+    size_t i = 0;
+    while (i + 8 <= count) {
+      size_t end = i + 8 * KERNELS_INT16_BLOCK;
+      __m128i sum = zero;
+      for (; i + 8 <= count && i < end; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(samples + i));
+        low = _mm_min_epi16(low, v);
+        high = _mm_max_epi16(high, v);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, ones));
+        // Pairs of squares reach 2^31, so widen them as unsigned
+        __m128i pairs = _mm_madd_epi16(v, v);
+        squares = _mm_add_epi64(squares, _mm_unpacklo_epi32(pairs, zero));
+        squares = _mm_add_epi64(squares, _mm_unpackhi_epi32(pairs, zero));
+      }
+      int32_t lanes[4];
+      _mm_storeu_si128((__m128i*)lanes, sum);
+      stats.sum += (int64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    int16_t lows[8], highs[8];
+    uint64_t wide[2];
+    _mm_storeu_si128((__m128i*)lows, low);
+    _mm_storeu_si128((__m128i*)highs, high);
+    _mm_storeu_si128((__m128i*)wide, squares);
+    for (uint8_t j = 0; j < 8; j++) {
+      if (lows[j] < stats.min) stats.min = lows[j];
+      if (highs[j] > stats.max) stats.max = highs[j];
+    }
+    stats.sumSquares = wide[0] + wide[1];
+    addScalar(samples + i, count - i, stats);
+  }
+
+  void reduceSse2(const float* samples, size_t count, FloatStats& stats) {
+    startStats(stats);
+    __m128 low = _mm_set1_ps(INFINITY);
+    __m128 high = _mm_set1_ps(-INFINITY);
+    size_t i = 0;
+    while (i + 8 <= count) {
+      size_t end = i + KERNELS_FLOAT_BLOCK;
+      __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+      __m128 squares0 = _mm_setzero_ps(), squares1 = _mm_setzero_ps();
+      for (; i + 8 <= count && i < end; i += 8) {
+        __m128 v0 = _mm_loadu_ps(samples + i);
+        __m128 v1 = _mm_loadu_ps(samples + i + 4);
+        low = _mm_min_ps(low, _mm_min_ps(v0, v1));
+        high = _mm_max_ps(high, _mm_max_ps(v0, v1));
+        sum0 = _mm_add_ps(sum0, v0);
+        sum1 = _mm_add_ps(sum1, v1);
+        squares0 = _mm_add_ps(squares0, _mm_mul_ps(v0, v0));
+        squares1 = _mm_add_ps(squares1, _mm_mul_ps(v1, v1));
+      }
+      float lanes[4];
+      _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+      stats.sum += ((double)lanes[0] + lanes[1]) + ((double)lanes[2] + lanes[3]);
+      _mm_storeu_ps(lanes, _mm_add_ps(squares0, squares1));
+      stats.sumSquares += ((double)lanes[0] + lanes[1]) + ((double)lanes[2] + lanes[3]);
+    }
+    float lows[4], highs[4];
+    _mm_storeu_ps(lows, low);
+    _mm_storeu_ps(highs, high);
+    for (uint8_t j = 0; j < 4; j++) {
+      if (lows[j] < stats.min) stats.min = lows[j];
+      if (highs[j] > stats.max) stats.max = highs[j];
+    }
+    addScalar(samples + i, count - i, stats);
+  }
+#endif
+
+#if defined(KERNELS_AVX2)
+  __attribute__((target("avx2")))
+  void reduceAvx2(const int16_t* samples, size_t count, Int16Stats& stats) {
+    startStats(stats);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i low = _mm256_set1_epi16(INT16_MAX);
+    __m256i high = _mm256_set1_epi16(INT16_MIN);
+    __m256i squares = zero;
+    size_t i = 0;
+    while (i + 16 <= count) {
+      size_t end = i + 16 * KERNELS_INT16_BLOCK;
+      __m256i sum = zero;
+      for (; i + 16 <= count && i < end; i += 16) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(samples + i));
+        low = _mm256_min_epi16(low, v);
+        high = _mm256_max_epi16(high, v);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, ones));
+        __m256i pairs = _mm256_madd_epi16(v, v);
+        squares = _mm256_add_epi64(squares, _mm256_unpacklo_epi32(pairs, zero));
+        squares = _mm256_add_epi64(squares, _mm256_unpackhi_epi32(pairs, zero));
+      }
+      int32_t lanes[8];
+      _mm256_storeu_si256((__m256i*)lanes, sum);
+      for (uint8_t j = 0; j < 8; j++) {
+        stats.sum += lanes[j];
+      }
+    }
+    int16_t lows[16], highs[16];
+    uint64_t wide[4];
+    _mm256_storeu_si256((__m256i*)lows, low);
+    _mm256_storeu_si256((__m256i*)highs, high);
+    _mm256_storeu_si256((__m256i*)wide, squares);
+    for (uint8_t j = 0; j < 16; j++) {
+      if (lows[j] < stats.min) stats.min = lows[j];
+      if (highs[j] > stats.max) stats.max = highs[j];
+    }
+    stats.sumSquares = (wide[0] + wide[1]) + (wide[2] + wide[3]);
+    addScalar(samples + i, count - i, stats);
+  }
+
+  __attribute__((target("avx2")))
+  void reduceAvx2(const float* samples, size_t count, FloatStats& stats) {
+    startStats(stats);
+    __m256 low = _mm256_set1_ps(INFINITY);
+    __m256 high = _mm256_set1_ps(-INFINITY);
+    size_t i = 0;
+    while (i + 16 <= count) {
+      size_t end = i + KERNELS_FLOAT_BLOCK;
+      __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+      __m256 squares0 = _mm256_setzero_ps(), squares1 = _mm256_setzero_ps();
+      for (; i + 16 <= count && i < end; i += 16) {
+        __m256 v0 = _mm256_loadu_ps(samples + i);
+        __m256 v1 = _mm256_loadu_ps(samples + i + 8);
+        low = _mm256_min_ps(low, _mm256_min_ps(v0, v1));
+        high = _mm256_max_ps(high, _mm256_max_ps(v0, v1));
+        sum0 = _mm256_add_ps(sum0, v0);
+        sum1 = _mm256_add_ps(sum1, v1);
+        squares0 = _mm256_add_ps(squares0, _mm256_mul_ps(v0, v0));
+        squares1 = _mm256_add_ps(squares1, _mm256_mul_ps(v1, v1));
+      }
+      float lanes[8];
+      _mm256_storeu_ps(lanes, _mm256_add_ps(sum0, sum1));
+      for (uint8_t j = 0; j < 8; j++) {
+        stats.sum += lanes[j];
+      }
+      _mm256_storeu_ps(lanes, _mm256_add_ps(squares0, squares1));
+      for (uint8_t j = 0; j < 8; j++) {
+        stats.sumSquares += lanes[j];
+      }
+    }
+    float lows[8], highs[8];
+    _mm256_storeu_ps(lows, low);
+    _mm256_storeu_ps(highs, high);
+    for (uint8_t j = 0; j < 8; j++) {
+      if (lows[j] < stats.min) stats.min = lows[j];
+      if (highs[j] > stats.max) stats.max = highs[j];
+    }
+    addScalar(samples + i, count - i, stats);
+  }
+#endif
+
+#if defined(KERNELS_NEON)
+  void reduceNeon(const int16_t* samples, size_t count, Int16Stats& stats) {
+    startStats(stats);
+    int16x8_t low = vdupq_n_s16(INT16_MAX);
+    int16x8_t high = vdupq_n_s16(INT16_MIN);
+    int64x2_t sum = vdupq_n_s64(0);
+    uint64x2_t squares = vdupq_n_u64(0);
+    size_t i = 0;
+    while (i + 8 <= count) {
+      size_t end = i + 8 * KERNELS_INT16_BLOCK;
+      int32x4_t blockSum = vdupq_n_s32(0);
+      for (; i + 8 <= count && i < end; i += 8) {
+        int16x8_t v = vld1q_s16(samples + i);
+        low = vminq_s16(low, v);
+        high = vmaxq_s16(high, v);
+        blockSum = vpadalq_s16(blockSum, v);
+        squares = vpadalq_u32(squares, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(v), vget_low_s16(v))));
+        squares = vpadalq_u32(squares, vreinterpretq_u32_s32(vmull_high_s16(v, v)));
+      }
+      sum = vpadalq_s32(sum, blockSum);
+    }
+    stats.min = vminvq_s16(low);
+    stats.max = vmaxvq_s16(high);
+    stats.sum = vaddvq_s64(sum);
+    stats.sumSquares = vaddvq_u64(squares);
+    addScalar(samples + i, count - i, stats);
+  }
+
+  void reduceNeon(const float* samples, size_t count, FloatStats& stats) {
+    startStats(stats);
+    float32x4_t low = vdupq_n_f32(INFINITY);
+    float32x4_t high = vdupq_n_f32(-INFINITY);
+    size_t i = 0;
+    while (i + 8 <= count) {
+      size_t end = i + KERNELS_FLOAT_BLOCK;
+      float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+      float32x4_t squares0 = vdupq_n_f32(0), squares1 = vdupq_n_f32(0);
+      for (; i + 8 <= count && i < end; i += 8) {
+        float32x4_t v0 = vld1q_f32(samples + i);
+        float32x4_t v1 = vld1q_f32(samples + i + 4);
+        low = vminq_f32(low, vminq_f32(v0, v1));
+        high = vmaxq_f32(high, vmaxq_f32(v0, v1));
+        sum0 = vaddq_f32(sum0, v0);
+        sum1 = vaddq_f32(sum1, v1);
+        squares0 = vmlaq_f32(squares0, v0, v0);
+        squares1 = vmlaq_f32(squares1, v1, v1);
+      }
+      stats.sum += vaddvq_f32(vaddq_f32(sum0, sum1));
+      stats.sumSquares += vaddvq_f32(vaddq_f32(squares0, squares1));
+    }
+    stats.min = vminvq_f32(low);
+    stats.max = vmaxvq_f32(high);
+    addScalar(samples + i, count - i, stats);
+  }
+#endif
+
+  struct Kernels {
+    void (*reduceInt16)(const int16_t*, size_t, Int16Stats&);
+    void (*reduceFloat)(const float*, size_t, FloatStats&);
+    const char* name;
+  };
+
+  Kernels selectKernels() {
+#if defined(KERNELS_AVX2)
+    if (__builtin_cpu_supports("avx2")) return { reduceAvx2, reduceAvx2, "avx2" };
+#endif
+#if defined(KERNELS_SSE2)
+    return { reduceSse2, reduceSse2, "sse2" };
+#elif defined(KERNELS_NEON)
+    return { reduceNeon, reduceNeon, "neon" };
+#else
+    return { reduceScalar, reduceScalar, "scalar" };
+#endif
+  }
+
+  const Kernels& kernels() {
+    static const Kernels selected = selectKernels();
+    return selected;
+  }
+}
+
+void WindowKernels::reduce(const int16_t* samples, size_t count, Int16Stats& stats) {
+  kernels().reduceInt16(samples, count, stats);
+}
+
+void WindowKernels::reduce(const float* samples, size_t count, FloatStats& stats) {
+  kernels().reduceFloat(samples, count, stats);
+}
+
+const char* WindowKernels::instructionSet() {
+  return kernels().name;
+}
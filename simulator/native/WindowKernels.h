@@ -0,0 +1,32 @@
+#ifndef WINDOW_KERNELS_H
+#define WINDOW_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Host-side counterpart of the firmware's WindowStats: min, max, sum and
+// sum of squares of a window in one vectorized pass, for 16-bit PCM (or
+// ADC counts) and float audio. The widest instruction set the CPU has
+// (AVX2, SSE2, NEON, else scalar) is picked once at first use.
+struct Int16Stats {
+  int16_t min;
+  int16_t max;
+  int64_t sum;
+  uint64_t sumSquares;
+};
+
+struct FloatStats {
+  float min;
+  float max;
+  double sum;
+  double sumSquares;
+};
+
+namespace WindowKernels {
+  // An empty window gives min > max (the identities) and zero sums
+  void reduce(const int16_t* samples, size_t count, Int16Stats& stats);
+  void reduce(const float* samples, size_t count, FloatStats& stats);
+  const char* instructionSet();
+}
+
+#endif
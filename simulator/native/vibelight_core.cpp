@@ -0,0 +1,248 @@
+// Python bindings for the firmware's platform-independent modules
+// (sampling, level quantization and the light modes). The sources are
+// compiled straight from /firmware, so the simulator runs the exact code
+// that is flashed. Host-only helpers (the ADC-rate resampler, vectorized
+// window reductions) live next to this file.
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "LevelQuantizer.h"
+#include "ModeEngine.h"
+#include "PeakToPeakSampler.h"
+#include "PolyphaseResampler.h"
+#include "WindowKernels.h"
+#include "WindowStats.h"
+
+namespace py = pybind11;
+
+namespace {
+  WindowStats reduce(py::array_t<uint16_t, py::array::c_style | py::array::forcecast> samples) {
+    auto in = samples.unchecked<1>();
+    // Same limit as a firmware window, whose count is 16 bits wide
+    if (in.shape(0) > UINT16_MAX) {
+      throw std::length_error("window longer than 65535 samples");
+    }
+    WindowStats stats;
+    stats.reset();
+    for (py::ssize_t i = 0; i < in.shape(0); i++) {
+      stats.addSquared(in(i));
+    }
+    return stats;
+  }
+
+  using FloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+  using Int16Array = py::array_t<int16_t, py::array::c_style>;
+
+  // int16 arrays reduce as integers, anything else as float32
+  bool isInt16(const py::array& samples) {
+    return samples.dtype().kind() == 'i' && samples.itemsize() == 2;
+  }
+
+  py::tuple sampleStats(py::array samples) {
+    if (samples.ndim() != 1) throw std::invalid_argument("samples must be 1-D");
+    if (isInt16(samples)) {
+      Int16Array in = Int16Array::ensure(samples);
+      Int16Stats stats;
+      WindowKernels::reduce(in.data(), (size_t)in.shape(0), stats);
+      return py::make_tuple(stats.min, stats.max, stats.sum, stats.sumSquares);
+    }
+    FloatArray in = FloatArray::ensure(samples);
+    FloatStats stats;
+    WindowKernels::reduce(in.data(), (size_t)in.shape(0), stats);
+    return py::make_tuple(stats.min, stats.max, stats.sum, stats.sumSquares);
+  }
+
+  template <typename Stats, typename Sum, typename Square, typename Array>
+  py::tuple reduceRows(const Array& windows) {
+    using T = typename Array::value_type;
+    py::ssize_t rows = windows.shape(0), length = windows.shape(1);
+    py::array_t<T> mins(rows), maxs(rows);
+    py::array_t<Sum> sums(rows);
+    py::array_t<Square> squares(rows);
+    const T* in = windows.data();
+    T* low = mins.mutable_data();
+    T* high = maxs.mutable_data();
+    Sum* sum = sums.mutable_data();
+    Square* square = squares.mutable_data();
+    {
+      py::gil_scoped_release release;
+      for (py::ssize_t r = 0; r < rows; r++) {
+        Stats stats;
+        WindowKernels::reduce(in + r * length, (size_t)length, stats);
+        low[r] = stats.min;
+        high[r] = stats.max;
+        sum[r] = stats.sum;
+        square[r] = stats.sumSquares;
+      }
+    }
+    return py::make_tuple(mins, maxs, sums, squares);
+  }
+
+  py::tuple sampleStatsRows(py::array windows) {
+    if (windows.ndim() != 2) throw std::invalid_argument("windows must be 2-D, one row per window");
+    if (isInt16(windows)) {
+      return reduceRows<Int16Stats, int64_t, uint64_t>(Int16Array::ensure(windows));
+    }
+    return reduceRows<FloatStats, double, double>(FloatArray::ensure(windows));
+  }
+
+  uint8_t paramIndex(const std::string& name) {
+    int8_t param = findModeParam(name.c_str());
+    if (param < 0) throw py::key_error(name);
+    return (uint8_t)param;
+  }
+}
+
+PYBIND11_MODULE(_core, m) {
+  m.doc() = "Firmware DSP core shared with the simulator";
+
+  m.def("modes", []() {
+    py::list out;
+    for (uint8_t i = 0; i < getModeCount(); i++) {
+      out.append(py::make_tuple(modes[i].label, isReactive(i)));
+    }
+    return out;
+  }, "(label, reactive) of every light mode, in firmware order");
+
+  m.def("mode_params", []() {
+    py::list out;
+    for (uint8_t i = 0; i < MODE_PARAM_COUNT; i++) {
+      const ModeParamInfo& p = modeParams[i];
+      out.append(py::make_tuple(p.name, p.minValue, p.maxValue, p.defaultValue));
+    }
+    return out;
+  }, "(name, min, max, default) of every mode parameter, by index");
+
+  py::class_<WindowStats>(m, "WindowStats")
+    .def_readonly("min", &WindowStats::min)
+    .def_readonly("max", &WindowStats::max)
+    .def_readonly("sum", &WindowStats::sum)
+    .def_readonly("sum_squares", &WindowStats::sumSquares)
+    .def_readonly("count", &WindowStats::count)
+    .def("peak_to_peak", &WindowStats::peakToPeak)
+    .def("deviation", &WindowStats::deviation);
+
+  m.def("window_stats", &reduce, py::arg("samples"),
+        "Min, max, sum and sum of squares of a window of ADC counts");
+
+  m.def("sample_stats", &sampleStats, py::arg("samples"),
+        "(min, max, sum, sum_squares) of a window of int16 or float samples, in one SIMD pass");
+  m.def("sample_stats_rows", &sampleStatsRows, py::arg("windows"),
+        "sample_stats of every row of a 2-D array, as four arrays");
+  m.def("simd_isa", &WindowKernels::instructionSet, "Instruction set sample_stats dispatched to");
+
+  py::class_<PeakToPeakSampler>(m, "PeakToPeakSampler")
+    .def(py::init<bool>(), py::arg("double_window") = false)
+    .def_property("double_window", &PeakToPeakSampler::isDoubleWindow, &PeakToPeakSampler::setDoubleWindow)
+    .def("reset", &PeakToPeakSampler::reset)
+    .def("feed", &PeakToPeakSampler::feed, py::arg("window_min"), py::arg("window_max"))
+    .def("feed_window", [](PeakToPeakSampler& sampler, py::array_t<uint16_t, py::array::c_style | py::array::forcecast> samples) {
+      WindowStats stats = reduce(samples);
+      return sampler.feed(stats.min, stats.max);
+    }, py::arg("samples"))
+    .def("feed_many", [](PeakToPeakSampler& sampler,
+                         py::array_t<uint16_t, py::array::c_style | py::array::forcecast> mins,
+                         py::array_t<uint16_t, py::array::c_style | py::array::forcecast> maxs) {
+      if (mins.ndim() != 1 || maxs.ndim() != 1 || mins.shape(0) != maxs.shape(0)) {
+        throw std::invalid_argument("mins and maxs must be 1-D and of equal length");
+      }
+      auto low = mins.unchecked<1>();
+      auto high = maxs.unchecked<1>();
+      py::array_t<uint16_t> signals(low.shape(0));
+      auto out = signals.mutable_unchecked<1>();
+      for (py::ssize_t i = 0; i < low.shape(0); i++) {
+        out(i) = sampler.feed(low(i), high(i));
+      }
+      return signals;
+    }, py::arg("mins"), py::arg("maxs"), "One feed() per window; returns every window's signal");
+
+  py::class_<LevelQuantizer> quantizer(m, "LevelQuantizer");
+  py::enum_<LevelQuantizer::Curve>(quantizer, "Curve")
+    .value("LINEAR", LevelQuantizer::LINEAR)
+    .value("PERCEPTUAL", LevelQuantizer::PERCEPTUAL)
+    .value("DECIBEL", LevelQuantizer::DECIBEL);
+  quantizer
+    .def(py::init<uint8_t, uint8_t>(), py::arg("levels"), py::arg("hysteresis_percent"))
+    .def("set_range", &LevelQuantizer::setRange, py::arg("low"), py::arg("high"))
+    .def_property("curve", &LevelQuantizer::getCurve, &LevelQuantizer::setCurve)
+    .def("set_hysteresis", &LevelQuantizer::setHysteresis, py::arg("percent"))
+    .def("quantize", &LevelQuantizer::quantize, py::arg("signal"))
+    .def("level_for", &LevelQuantizer::levelFor, py::arg("signal"))
+    .def("quantize_many", [](LevelQuantizer& quantizer, py::array_t<uint16_t, py::array::c_style | py::array::forcecast> signals) {
+      auto in = signals.unchecked<1>();
+      py::array_t<uint8_t> levels(in.shape(0));
+      auto out = levels.mutable_unchecked<1>();
+      for (py::ssize_t i = 0; i < in.shape(0); i++) {
+        out(i) = quantizer.quantize(in(i));
+      }
+      return levels;
+    }, py::arg("signals"), "One quantize() per signal, in order")
+    .def_property_readonly("level", &LevelQuantizer::getLevel);
+
+  py::class_<ModeEngine>(m, "ModeEngine")
+    .def(py::init<uint8_t, uint16_t>(), py::arg("channel_count"), py::arg("attack_ms_per_level") = 0)
+    .def("seed", &ModeEngine::seed, py::arg("seed"))
+    .def("set_mode", &ModeEngine::setMode, py::arg("mode"), py::arg("now_ms"))
+    .def_property_readonly("mode", &ModeEngine::getMode)
+    .def_property("num_wires", &ModeEngine::getNumWires, &ModeEngine::setNumWires)
+    .def_property("delay_ms", &ModeEngine::getDelay, &ModeEngine::setDelay)
+    .def("restart_periodic", &ModeEngine::restartPeriodic)
+    .def("run", &ModeEngine::run, py::arg("level"), py::arg("now_ms"))
+    .def_property("mask", &ModeEngine::getMask, &ModeEngine::setMask)
+    .def("set_param", [](ModeEngine& engine, const std::string& name, uint16_t value) {
+      return engine.setParam(paramIndex(name), value);
+    }, py::arg("name"), py::arg("value"), "Sets a mode parameter, clamped; returns the value in effect")
+    .def("get_param", [](const ModeEngine& engine, const std::string& name) {
+      return engine.getParam(paramIndex(name));
+    }, py::arg("name"))
+    .def("reset_params", &ModeEngine::resetParams)
+    .def("run_many", [](ModeEngine& engine,
+                        py::array_t<uint8_t, py::array::c_style | py::array::forcecast> levels,
+                        py::array_t<uint32_t, py::array::c_style | py::array::forcecast> timesMs,
+                        bool withDrawn) -> py::object {
+      if (levels.ndim() != 1 || timesMs.ndim() != 1 || levels.shape(0) != timesMs.shape(0)) {
+        throw std::invalid_argument("levels and times_ms must be 1-D and of equal length");
+      }
+      auto level = levels.unchecked<1>();
+      auto time = timesMs.unchecked<1>();
+      py::array_t<uint8_t> masks(levels.shape(0));
+      py::array_t<bool> drawn(levels.shape(0));
+      auto out = masks.mutable_unchecked<1>();
+      auto outDrawn = drawn.mutable_unchecked<1>();
+      {
+        py::gil_scoped_release release;
+        for (py::ssize_t i = 0; i < level.shape(0); i++) {
+          outDrawn(i) = engine.run(level(i), time(i));
+          out(i) = engine.getMask();
+        }
+      }
+      if (withDrawn) return py::make_tuple(masks, drawn);
+      return masks;
+    }, py::arg("levels"), py::arg("times_ms"), py::arg("with_drawn") = false,
+       "Runs one window per level at the given times; returns the mask after each\n"
+       "(and, with_drawn, whether run() drew it)");
+
+  py::class_<PolyphaseResampler>(m, "PolyphaseResampler")
+    .def(py::init<double, double, double>(), py::arg("input_rate"), py::arg("output_rate"), py::arg("cutoff_hz") = 0.0)
+    .def("reset", &PolyphaseResampler::reset)
+    .def("process", [](PolyphaseResampler& resampler, py::array_t<float, py::array::c_style | py::array::forcecast> samples) {
+      if (samples.ndim() != 1) throw std::invalid_argument("samples must be 1-D");
+      size_t count = (size_t)samples.shape(0);
+      std::vector<float> out(resampler.maxOutput(count));
+      size_t produced;
+      {
+        py::gil_scoped_release release;
+        produced = resampler.process(samples.data(), count, out.data());
+      }
+      return py::array_t<float>(produced, out.data());
+    }, py::arg("samples"), "Appends a block of the input stream; returns the output samples now complete")
+    .def_property_readonly("input_rate", &PolyphaseResampler::getInputRate)
+    .def_property_readonly("output_rate", &PolyphaseResampler::getOutputRate)
+    .def_property_readonly("cutoff_hz", &PolyphaseResampler::getCutoff)
+    .def_property_readonly("taps", &PolyphaseResampler::getTapCount);
+}
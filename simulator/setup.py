@@ -0,0 +1,60 @@
+"""
+Builds vibelight._core, the firmware's sampling, quantizer and mode code
+compiled for the host plus host-only helpers from native/ (see
+native/vibelight_core.cpp). Everything else
+about the package lives in pyproject.toml.
+
+In a checkout the firmware sources are read from ../firmware. An sdist
+carries a copy of them under native/firmware instead, so wheels built
+from it (uv build, python -m build, isolated pip builds) find them too.
+"""
+
+from pathlib import Path
+
+from pybind11.setup_helpers import Pybind11Extension, build_ext
+from setuptools import setup
+from setuptools.command.sdist import sdist
+
+BUNDLED_FIRMWARE = Path("native") / "firmware"
+FIRMWARE = BUNDLED_FIRMWARE if BUNDLED_FIRMWARE.is_dir() else Path("..") / "firmware"
+CORE_SOURCES = [
+    "EnvelopeFollower.cpp",
+    "FastRandom.cpp",
+    "FixedLog.cpp",
+    "LevelQuantizer.cpp",
+    "ModeEngine.cpp",
+    "PeakToPeakSampler.cpp",
+    "TapTempo.cpp",
+    "WindowStats.cpp",
+    "WireMask.cpp",
+]
+
+NATIVE_SOURCES = [
+    "native/PolyphaseResampler.cpp",
+    "native/WindowKernels.cpp",
+]
+
+
+class BundleFirmwareSdist(sdist):
+    """Copies the firmware sources and headers into the sdist."""
+
+    def make_release_tree(self, base_dir, files):
+        # The extension's ../firmware sources would land outside the tree
+        super().make_release_tree(base_dir, [f for f in files if not f.startswith("..")])
+        target = Path(base_dir) / BUNDLED_FIRMWARE
+        self.mkpath(str(target))
+        for name in [*CORE_SOURCES, *sorted(p.name for p in FIRMWARE.glob("*.h"))]:
+            self.copy_file(str(FIRMWARE / name), str(target / name))
+
+
+setup(
+    ext_modules=[
+        Pybind11Extension(
+            "vibelight._core",
+            ["native/vibelight_core.cpp", *NATIVE_SOURCES, *(str(FIRMWARE / s) for s in CORE_SOURCES)],
+            include_dirs=["native", str(FIRMWARE)],
+            cxx_std=17,
+        )
+    ],
+    cmdclass={"build_ext": build_ext, "sdist": BundleFirmwareSdist},
+)
@@ -0,0 +1,6 @@
+# The modules import each other by bare name so they also run as scripts
+# from this directory; keep that working for the package entry points.
+import os as _os
+import sys as _sys
+
+_sys.path.insert(0, _os.path.dirname(__file__))
@@ -11,6 +11,7 @@ except Exception:
     HAS_SOUNDCARD = False
 
 from constants import DEVICE_SAMPLE_RATE, SIMULATED_SAMPLE_RATE
+from sampling import AdcStream
 
 class AudioCapture:
     def __init__(self, window_ms: float, device: int | None = None):
@@ -20,6 +21,7 @@ class AudioCapture:
         self._device_block = int(DEVICE_SAMPLE_RATE * window_ms / 1000)
         self._device = device
         self._channels = 1
+        self._adc = AdcStream(DEVICE_SAMPLE_RATE, self.simulated_samples)
 
     @property
     def simulated_samples(self) -> int:
@@ -69,12 +71,15 @@ class AudioCapture:
         raise RuntimeError(f"Failed to open input stream: {last_err}")
 
     def get_window(self) -> np.ndarray | None:
-        try:
-            chunk = self._queue.get_nowait()
-        except queue.Empty:
-            return None
-        indices = np.linspace(0, len(chunk) - 1, self.simulated_samples, dtype=int)
-        return chunk[indices]
+        window = self._adc.pop_window()
+        while window is None:
+            try:
+                chunk = self._queue.get_nowait()
+            except queue.Empty:
+                return None
+            self._adc.push(chunk)
+            window = self._adc.pop_window()
+        return window
 
     def stop(self):
         if self._stream:
@@ -87,6 +92,7 @@ class SystemLoopbackCapture:
         self._device_block = int(DEVICE_SAMPLE_RATE * window_ms / 1000)
         self._recorder: any = None
         self._device = device
+        self._adc = AdcStream(DEVICE_SAMPLE_RATE, self.simulated_samples)
 
     @property
     def simulated_samples(self) -> int:
@@ -114,15 +120,17 @@ class SystemLoopbackCapture:
     def get_window(self) -> np.ndarray | None:
         if not self._recorder:
             return None
-        try:
-            chunk = self._recorder.record(self._device_block)
-        except Exception:
-            return None
-        if chunk is None or len(chunk) == 0:
-            return None
-        sig = chunk[:, 0].copy() if chunk.ndim == 2 else chunk.copy()
-        indices = np.linspace(0, len(sig) - 1, self.simulated_samples, dtype=int)
-        return sig[indices]
+        window = self._adc.pop_window()
+        while window is None:
+            try:
+                chunk = self._recorder.record(self._device_block)
+            except Exception:
+                return None
+            if chunk is None or len(chunk) == 0:
+                return None
+            self._adc.push(chunk[:, 0] if chunk.ndim == 2 else chunk)
+            window = self._adc.pop_window()
+        return window
 
     def stop(self):
         if self._recorder:
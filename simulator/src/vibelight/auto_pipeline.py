@@ -8,6 +8,8 @@ Drop-in alternative to manual floor/ceiling control.
 import numpy as np
 from collections import deque
 
+import core
+
 LED_COUNT = 8
 
 
@@ -43,8 +45,7 @@ class AutoCalibratingSampler:
         self.ceiling: float = min_range
 
     def feed(self, samples: np.ndarray) -> float:
-        cur_min = float(np.min(samples))
-        cur_max = float(np.max(samples))
+        cur_min, cur_max, _, _ = core.sample_stats(samples)
 
         if self.double_window and self._prev_min is not None:
             p2p = max(cur_max, self._prev_max) - min(cur_min, self._prev_min)
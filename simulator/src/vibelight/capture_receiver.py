@@ -0,0 +1,139 @@
+"""
+capture_receiver.py
+
+Receiver for the firmware's raw waveform capture (Bluetooth command `W`).
+
+While capture is on, every sample window arrives as a `*W<base64>*` line
+holding one RiceCodec frame (see firmware/RiceCodec.h). Log the Bluetooth
+output to a text file, or pipe it in, and run:
+
+    receive-capture capture.txt -o capture.wav
+
+Windows are concatenated as they arrive; the firmware does not sample
+between windows, so the recording has small gaps at window boundaries.
+Windows the firmware could not queue are skipped whole and announced by
+a `*w<count>*` line; the receiver reports their total.
+"""
+
+from __future__ import annotations
+import argparse
+import base64
+import binascii
+import re
+import sys
+import wave
+from dataclasses import dataclass
+
+BLOCK_SAMPLES = 32
+ESCAPE_QUOTIENT = 16
+ADC_MIDPOINT = 2048
+
+
+@dataclass
+class CaptureFrame:
+    sample_rate: int
+    samples: list[int]
+
+
+class _BitReader:
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def bit(self) -> int:
+        byte = self.data[self.pos >> 3]
+        value = (byte >> (7 - (self.pos & 7))) & 1
+        self.pos += 1
+        return value
+
+    def bits(self, count: int) -> int:
+        value = 0
+        for _ in range(count):
+            value = (value << 1) | self.bit()
+        return value
+
+
+def _unzigzag(value: int) -> int:
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_frame(frame: bytes) -> CaptureFrame:
+    count = int.from_bytes(frame[0:2], "little")
+    sample_rate = int.from_bytes(frame[2:4], "little")
+    if count == 0:
+        return CaptureFrame(sample_rate, [])
+    previous = int.from_bytes(frame[4:6], "little")
+    samples = [previous]
+    reader = _BitReader(frame[6:])
+    remaining = count - 1
+    while remaining > 0:
+        n = min(remaining, BLOCK_SAMPLES)
+        k = reader.bits(4)
+        for _ in range(n):
+            q = 0
+            while q < ESCAPE_QUOTIENT and reader.bit():
+                q += 1
+            if q == ESCAPE_QUOTIENT:
+                residual = reader.bits(16)
+            else:
+                residual = (q << k) | reader.bits(k)
+            previous += _unzigzag(residual)
+            samples.append(previous)
+        remaining -= n
+    return CaptureFrame(sample_rate, samples)
+
+
+def parse_capture_lines(text: str) -> list[CaptureFrame]:
+    """Decode every `*W...*` line; damaged lines are skipped."""
+    frames = []
+    for match in re.finditer(r"\*W([A-Za-z0-9+/=]+)\*", text):
+        try:
+            frames.append(decode_frame(base64.b64decode(match.group(1))))
+        except (binascii.Error, IndexError):
+            continue
+    return frames
+
+
+def count_skipped(text: str) -> int:
+    """Total of the `*w<count>*` skipped-window reports."""
+    return sum(int(m.group(1)) for m in re.finditer(r"\*w(\d+)\*", text))
+
+
+def write_wav(frames: list[CaptureFrame], path: str):
+    """Write 16-bit mono PCM, ADC counts re-centered and scaled by 16."""
+    rates = sorted(f.sample_rate for f in frames if f.samples)
+    rate = rates[len(rates) // 2] if rates else 8000
+    pcm = bytearray()
+    for f in frames:
+        for s in f.samples:
+            pcm += ((s - ADC_MIDPOINT) * 16).to_bytes(2, "little", signed=True)
+    with wave.open(path, "wb") as out:
+        out.setnchannels(1)
+        out.setsampwidth(2)
+        out.setframerate(rate)
+        out.writeframes(bytes(pcm))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a waveform capture to WAV")
+    parser.add_argument("capture", nargs="?", help="text file containing the *W...* lines (default: stdin)")
+    parser.add_argument("-o", "--output", default="capture.wav", help="WAV file")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, encoding="utf-8", errors="replace") as f:
+            text = f.read()
+    else:
+        text = sys.stdin.read()
+
+    frames = parse_capture_lines(text)
+    write_wav(frames, args.output)
+    total = sum(len(f.samples) for f in frames)
+    print(f"{len(frames)} windows, {total} samples -> {args.output}", file=sys.stderr)
+    skipped = count_skipped(text)
+    if skipped:
+        print(f"{skipped} windows skipped by the firmware (Bluetooth too slow)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
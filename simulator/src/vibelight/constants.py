@@ -3,6 +3,12 @@
 # --- Hardware simulation constants ---
 SIMULATED_SAMPLE_RATE = 20_000
 DEVICE_SAMPLE_RATE = 44_100
+# The ESP32 ADC has no anti-alias filter of its own; host audio is band-
+# limited to this before resampling to SIMULATED_SAMPLE_RATE
+ADC_BANDWIDTH_HZ = 9_000
+# 12-bit ADC with the mic biased mid-scale (MAX_SIGNAL in LoudnessMeter.h)
+ADC_MAX = 4095
+ADC_MIDPOINT = 2048
 
 # --- Display constants ---
 WINDOW_WIDTH = 1200
@@ -23,6 +29,14 @@ SLIDER_WIDTH = 280
 LED_HEIGHT = 120
 PLOT_HISTORY = 200
 
+# --- Firmware defaults (firmware.ino) ---
+DEFAULT_P2P_LOW = 800  # ADC counts
+DEFAULT_P2P_HIGH = 1950
+MIC_SAMPLE_WINDOW_MS = 14
+LEVEL_HYSTERESIS = 25  # % of a step
+ENVELOPE_ATTACK_MS = 0  # decay modes, per level
+DEFAULT_DELAY_MS = 25  # periodic step / decay release
+
 # --- Device defaults (optional) ---
 # Set to a substring of your desired input device name (case-insensitive).
 # Example: DEFAULT_INPUT_DEVICE_NAME = "Line In (Realtek HD Audio Line input)"
@@ -0,0 +1,23 @@
+"""
+core.py
+
+The firmware's sampling, quantizer and light-mode code, compiled for the
+host as vibelight._core (native/vibelight_core.cpp), plus the resampler
+feeding it audio at the ADC rate and SIMD window reductions. Simulator classes
+wrap these so they behave exactly like the flashed firmware.
+"""
+
+try:
+    from vibelight._core import (
+        LevelQuantizer, ModeEngine, PeakToPeakSampler, PolyphaseResampler, WindowStats, mode_params, modes,
+        sample_stats, sample_stats_rows, simd_isa, window_stats,
+    )
+except ImportError as e:
+    raise ImportError(
+        "vibelight._core is not built; run `uv sync` (or `pip install -e .`) in /simulator"
+    ) from e
+
+__all__ = [
+    "LevelQuantizer", "ModeEngine", "PeakToPeakSampler", "PolyphaseResampler", "WindowStats", "mode_params",
+    "modes", "sample_stats", "sample_stats_rows", "simd_isa", "window_stats",
+]
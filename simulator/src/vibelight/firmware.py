@@ -3,7 +3,7 @@ import time
 import numpy as np
 
 from constants import SIMULATED_SAMPLE_RATE, DEFAULT_INPUT_DEVICE_NAME
-from sampling import PeakToPeakSampler, p2p_to_level
+from sampling import PeakToPeakSampler, LevelQuantizer
 from mappers import MAPPER_REGISTRY
 from audio import AudioCapture, SystemLoopbackCapture, HAS_SOUNDCARD, list_input_devices, list_output_devices
 from renderer import LEDRenderer
@@ -18,6 +18,7 @@ def main(window_ms: float = 14.0):
 
     double_window = False
     manual_sampler = PeakToPeakSampler(double_window=double_window)
+    quantizer = LevelQuantizer()
     auto_pipeline = AutoPipeline(double_window=double_window)
     use_auto = False
     input_source = "MIC"
@@ -169,7 +170,7 @@ def main(window_ms: float = 14.0):
                     renderer.ceil_slider.val = auto_pipeline.ceiling
                 else:
                     current_p2p = manual_sampler.feed(window)
-                    level = p2p_to_level(current_p2p, renderer.floor_slider.val, renderer.ceil_slider.val)
+                    level = quantizer.quantize(current_p2p, renderer.floor_slider.val, renderer.ceil_slider.val)
                 leds = mappers[mapper_idx](level)
 
             renderer.draw(
@@ -0,0 +1,132 @@
+"""
+flight_log.py
+
+Decoder for the firmware's FlightRecorder dump (Bluetooth command `R`).
+
+The dump arrives as `*R<hex>*` lines terminated by `*REND*`. Paste or log
+them to a text file and run:
+
+    decode-flight-log dump.txt -o show.csv
+"""
+
+from __future__ import annotations
+import argparse
+import csv
+import re
+import sys
+from dataclasses import dataclass
+
+BLOCK_SIZE = 256
+BLOCK_MAGIC = 0xA5
+HEADER_SIZE = 12
+RECORD_END = 0xFF
+
+
+@dataclass
+class WindowRecord:
+    time_ms: int
+    signal: int
+    level: int
+    mask: int
+    loop_ms: int
+
+
+@dataclass
+class CommandRecord:
+    time_ms: int
+    text: str
+
+
+def _varint(data: bytes, pos: int) -> tuple[int, int]:
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def _zigzag(value: int) -> int:
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_block(block: bytes) -> list[WindowRecord | CommandRecord]:
+    if len(block) < HEADER_SIZE or block[0] != BLOCK_MAGIC:
+        return []
+    time_ms = int.from_bytes(block[5:9], "little")
+    signal = int.from_bytes(block[9:11], "little")
+    mask = block[11]
+    records: list[WindowRecord | CommandRecord] = []
+    pos = HEADER_SIZE
+    while pos < len(block) and block[pos] != RECORD_END:
+        header = block[pos]
+        pos += 1
+        dt, pos = _varint(block, pos)
+        # The firmware's clock is 32 bits wide
+        time_ms = (time_ms + dt) & 0xFFFFFFFF
+        if header & 0xC0 == 0x40:
+            length = header & 0x3F
+            text = block[pos:pos + length].decode("ascii", errors="replace")
+            pos += length
+            records.append(CommandRecord(time_ms, text))
+        else:
+            delta, pos = _varint(block, pos)
+            signal += _zigzag(delta)
+            loop_ms, pos = _varint(block, pos)
+            if header & 0x20:
+                mask = block[pos]
+                pos += 1
+            records.append(WindowRecord(time_ms, signal, header & 0x0F, mask, loop_ms))
+    return records
+
+
+def decode_dump(data: bytes) -> list[WindowRecord | CommandRecord]:
+    """Decode raw dump bytes; blocks are ordered by their sequence number."""
+    blocks = [data[i:i + BLOCK_SIZE] for i in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE)]
+    blocks = [b for b in blocks if b[0] == BLOCK_MAGIC]
+    blocks.sort(key=lambda b: int.from_bytes(b[1:5], "little"))
+    records: list[WindowRecord | CommandRecord] = []
+    for block in blocks:
+        records.extend(decode_block(block))
+    return records
+
+
+def parse_dump_lines(text: str) -> bytes:
+    """Collect the hex payload of `*R...*` lines up to `*REND*`."""
+    payload = bytearray()
+    for match in re.finditer(r"\*R([0-9A-Fa-f]*|END)\*", text):
+        chunk = match.group(1)
+        if chunk == "END":
+            break
+        payload.extend(bytes.fromhex(chunk))
+    return bytes(payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a FlightRecorder dump to CSV")
+    parser.add_argument("dump", help="text file containing the *R...* lines")
+    parser.add_argument("-o", "--output", help="CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, encoding="utf-8", errors="replace") as f:
+        records = decode_dump(parse_dump_lines(f.read()))
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        writer = csv.writer(out)
+        writer.writerow(["time_ms", "signal", "level", "mask", "loop_ms", "command"])
+        for r in records:
+            if isinstance(r, WindowRecord):
+                writer.writerow([r.time_ms, r.signal, r.level, f"{r.mask:08b}", r.loop_ms, ""])
+            else:
+                writer.writerow([r.time_ms, "", "", "", "", r.text])
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+"""
+kwl_panel.py
+
+Generates firmware/KwlPanel.h from the Bluetooth Electronics panel in
+app/Bluetooth_Electronics_Panels.kwl, so the firmware can push the panel
+to the phone on connect. Run it after editing the panel or the command
+table in firmware.ino:
+
+    generate-kwl-panel
+
+Only panels with controls are kept. Generation fails unless every
+command a control sends is in the firmware's bluetoothCommandList, every
+command there has a control (see NO_CONTROL) and every state key in
+PANEL_FIELD_KEYS has a display.
+"""
+
+from __future__ import annotations
+import argparse
+import re
+import sys
+from pathlib import Path
+
+REPO = Path(__file__).resolve().parents[3]
+PANEL_FILE = REPO / "app" / "Bluetooth_Electronics_Panels.kwl"
+FIRMWARE_FILE = REPO / "firmware" / "firmware.ino"
+HEADER_FILE = REPO / "firmware" / "KwlPanel.h"
+
+# Arguments holding the text a control sends, per control type
+SEND_ARGUMENTS = {
+    "add_button": [3, 4],
+    "add_switch": [3, 4],
+    "add_4way_pad": [2, 3, 4, 5, 6],
+}
+
+# Commands the panel cannot offer, and why
+NO_CONTROL = {
+    "V": "takes a free-text name=value; send presets with tune-modes",
+}
+
+
+def split_panels(text: str) -> list[list[str]]:
+    panels: list[list[str]] = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line.startswith("select_panel("):
+            panels.append([line])
+        elif panels and line:
+            panels[-1].append(line)
+    return [p for p in panels if any(l.startswith("add_") for l in p)]
+
+
+def _arguments(line: str) -> list[str]:
+    inner = line[line.index("(") + 1:line.rindex(")")]
+    return [a.strip('"') for a in re.findall(r'"[^"]*"|[^,]+|(?<=,)(?=,)|^(?=,)', inner)]
+
+
+def sent_commands(panel: list[str]) -> set[str]:
+    """First characters of everything the panel's controls send."""
+    sent = set()
+    for line in panel:
+        name = line[:line.find("(")]
+        args = _arguments(line) if "(" in line else []
+        for i in SEND_ARGUMENTS.get(name, []):
+            if i < len(args):
+                text = args[i].replace("\\n", "").strip()
+                if text:
+                    sent.add(text[0])
+        if name == "add_slider" and len(args) > 6 and args[6]:
+            sent.add(args[6][0])
+    return sent
+
+
+def displayed_keys(panel: list[str]) -> set[str]:
+    """Receive characters of the panel's text displays."""
+    keys = set()
+    for line in panel:
+        if line.startswith("add_text("):
+            args = _arguments(line)
+            if len(args) > 8 and args[8]:
+                keys.add(args[8])
+    return keys
+
+
+def field_keys(firmware: str) -> set[str]:
+    return set(re.search(r'#define PANEL_FIELD_KEYS "([^"]*)"', firmware).group(1))
+
+
+def registered_commands(firmware: str) -> set[str]:
+    table = firmware[firmware.index("bluetoothCommandList[]"):]
+    table = table[:table.index("};")]
+    return set(re.findall(r'\{\s*"([^"]+)"', table))
+
+
+def render_header(panel_code: str) -> str:
+    return f"""#ifndef KWL_PANEL_H
+#define KWL_PANEL_H
+
+#include <stdint.h>
+
+// Generated by generate-kwl-panel from app/Bluetooth_Electronics_Panels.kwl.
+// Do not edit; change the panel in the app, export it and regenerate.
+constexpr char KWL_PANEL[] = R"KWL({panel_code})KWL";
+
+// FNV-1a of the panel text, so the firmware can tell whether the phone
+// already has this version
+constexpr uint32_t kwlPanelHash(const char* text) {{
+  uint32_t hash = 2166136261UL;
+  while (*text) {{
+    hash = (hash ^ (uint8_t)*text++) * 16777619UL;
+  }}
+  return hash;
+}}
+
+constexpr uint32_t KWL_PANEL_HASH = kwlPanelHash(KWL_PANEL);
+
+#endif
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate firmware/KwlPanel.h from the app panel")
+    parser.add_argument("--panel", default=PANEL_FILE, type=Path)
+    parser.add_argument("--firmware", default=FIRMWARE_FILE, type=Path)
+    parser.add_argument("-o", "--output", default=HEADER_FILE, type=Path)
+    args = parser.parse_args()
+
+    panels = split_panels(args.panel.read_text(encoding="utf-8"))
+    firmware = args.firmware.read_text(encoding="utf-8")
+    registered = registered_commands(firmware)
+    sent = set().union(*(sent_commands(p) for p in panels))
+    displayed = set().union(*(displayed_keys(p) for p in panels))
+    problems = []
+    if sent - registered:
+        problems.append(f"panel sends unregistered commands: {', '.join(sorted(sent - registered))}")
+    if registered - sent - set(NO_CONTROL):
+        problems.append(f"commands without a control: {', '.join(sorted(registered - sent - set(NO_CONTROL)))}")
+    if field_keys(firmware) - displayed:
+        problems.append(f"state keys without a display: {', '.join(sorted(field_keys(firmware) - displayed))}")
+    if problems:
+        sys.exit("\n".join(problems))
+
+    lines = ["clear_panel()"]
+    for panel in panels:
+        lines.extend(panel)
+    lines.append("run()")
+    args.output.write_text(render_header("\n".join(lines)), encoding="utf-8")
+    print(f"{args.output}: {len(panels)} panel(s)", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
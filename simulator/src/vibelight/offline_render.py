@@ -0,0 +1,189 @@
+"""
+offline_render.py
+
+Headless renderer: feeds WAV files through the firmware's sampling, level
+quantizer and every light mode (vibelight._core) on a virtual clock, far
+faster than real time, with one worker process per core.
+
+    render-offline album/ -o renders/
+
+For every input, <name>.csv gets one row per sample window: time_ms,
+signal, level, then each mode's wire mask (bit i = channel i). Audio is
+resampled to the ADC rate and cut into windows like the live simulator's
+AudioCapture does. On the virtual clock, periodic modes advance once per
+window, so steps shorter than a window are skipped.
+"""
+
+from __future__ import annotations
+import argparse
+import os
+import sys
+import time
+import wave
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from pathlib import Path
+
+import numpy as np
+
+from constants import (
+    SIMULATED_SAMPLE_RATE, ADC_BANDWIDTH_HZ, LED_COUNT, ENVELOPE_ATTACK_MS, DEFAULT_DELAY_MS,
+    DEFAULT_P2P_LOW, DEFAULT_P2P_HIGH, MIC_SAMPLE_WINDOW_MS, LEVEL_HYSTERESIS,
+)
+from sampling import to_adc_counts
+import core
+
+
+@dataclass(frozen=True)
+class RenderSettings:
+    window_ms: int = MIC_SAMPLE_WINDOW_MS
+    adc_rate: int = SIMULATED_SAMPLE_RATE
+    low: int = DEFAULT_P2P_LOW
+    high: int = DEFAULT_P2P_HIGH
+    double_window: bool = False
+    num_wires: int = LED_COUNT
+    delay_ms: int = DEFAULT_DELAY_MS
+    seed: int = 0x9E3779B9
+
+
+@dataclass
+class RenderResult:
+    path: Path
+    windows: int
+    audio_seconds: float
+    render_seconds: float
+
+
+def read_wav(path: Path) -> tuple[int, np.ndarray]:
+    """Sample rate and first channel as floats in [-1, 1] (PCM only)."""
+    with wave.open(str(path), "rb") as f:
+        rate = f.getframerate()
+        width = f.getsampwidth()
+        channels = f.getnchannels()
+        raw = f.readframes(f.getnframes())
+    if width == 1:
+        data = (np.frombuffer(raw, dtype=np.uint8).astype(np.float64) - 128) / 128
+    elif width == 3:
+        b = np.frombuffer(raw, dtype=np.uint8).reshape(-1, 3).astype(np.int32)
+        data = ((b[:, 0] | (b[:, 1] << 8) | (b[:, 2] << 16)) << 8 >> 8) / float(1 << 23)
+    else:
+        dtype = {2: np.int16, 4: np.int32}[width]
+        data = np.frombuffer(raw, dtype=dtype) / float(1 << (8 * width - 1))
+    return rate, data.reshape(-1, channels)[:, 0]
+
+
+def cut_windows(audio: np.ndarray, rate: int, window_ms: int, adc_rate: int = SIMULATED_SAMPLE_RATE) -> np.ndarray:
+    """One row per window, resampled to the ADC rate as AdcStream does."""
+    samples = int(adc_rate * window_ms / 1000)
+    resampled = core.PolyphaseResampler(rate, adc_rate, ADC_BANDWIDTH_HZ).process(audio)
+    count = len(resampled) // samples
+    return resampled[:count * samples].reshape(count, samples)
+
+
+def sample_levels(audio: np.ndarray, rate: int, settings: RenderSettings) -> tuple[np.ndarray, np.ndarray, np.ndarray]:
+    """Per window: end time on the virtual clock (ms), signal and level."""
+    mins, maxs, _, _ = core.sample_stats_rows(cut_windows(audio, rate, settings.window_ms, settings.adc_rate))
+    sampler = core.PeakToPeakSampler(settings.double_window)
+    signals = sampler.feed_many(to_adc_counts(mins), to_adc_counts(maxs))
+    quantizer = core.LevelQuantizer(LED_COUNT, LEVEL_HYSTERESIS)
+    quantizer.set_range(settings.low, settings.high)
+    levels = quantizer.quantize_many(signals)
+    times = np.arange(1, len(levels) + 1, dtype=np.uint32) * np.uint32(settings.window_ms)
+    return times, signals, levels
+
+
+def new_engine(mode: int, settings: RenderSettings, params: dict[str, int] | None = None) -> core.ModeEngine:
+    engine = core.ModeEngine(LED_COUNT, ENVELOPE_ATTACK_MS)
+    engine.seed(settings.seed)
+    engine.num_wires = settings.num_wires
+    engine.delay_ms = settings.delay_ms
+    for name, value in (params or {}).items():
+        engine.set_param(name, value)
+    engine.set_mode(mode, 0)
+    return engine
+
+
+def render(audio: np.ndarray, rate: int, settings: RenderSettings) -> np.ndarray:
+    """Columns time_ms, signal, level and one mask per mode, a row per window."""
+    times, signals, levels = sample_levels(audio, rate, settings)
+    columns = [times, signals, levels]
+    for mode in range(len(core.modes())):
+        columns.append(new_engine(mode, settings).run_many(levels, times))
+    return np.column_stack(columns)
+
+
+def render_file(path: Path, output_dir: Path | None, settings: RenderSettings) -> RenderResult:
+    start = time.perf_counter()
+    rate, audio = read_wav(path)
+    table = render(audio, rate, settings)
+    if output_dir is not None:
+        header = ",".join(["time_ms", "signal", "level", *(label for label, _ in core.modes())])
+        np.savetxt(output_dir / f"{path.stem}.csv", table, fmt="%d", delimiter=",", header=header, comments="")
+    return RenderResult(path, len(table), len(audio) / rate, time.perf_counter() - start)
+
+
+def find_wavs(inputs: list[str]) -> list[Path]:
+    paths: list[Path] = []
+    for name in inputs:
+        p = Path(name)
+        paths.extend(sorted(p.rglob("*.wav")) if p.is_dir() else [p])
+    return paths
+
+
+def add_render_arguments(parser: argparse.ArgumentParser):
+    """Firmware settings shared by the offline tools."""
+    parser.add_argument("--window-ms", type=int, default=MIC_SAMPLE_WINDOW_MS)
+    parser.add_argument("--adc-rate", type=int, default=SIMULATED_SAMPLE_RATE,
+                        help="ADC sample rate, e.g. a device capture's (default: %(default)s)")
+    parser.add_argument("--low", type=int, default=DEFAULT_P2P_LOW, help="quantizer low, ADC counts")
+    parser.add_argument("--high", type=int, default=DEFAULT_P2P_HIGH, help="quantizer high, ADC counts")
+    parser.add_argument("--double-window", action="store_true", help="RMS sampling mode (double window)")
+    parser.add_argument("--num-wires", type=int, default=LED_COUNT, help="reactive mode setting")
+    parser.add_argument("--delay-ms", type=int, default=DEFAULT_DELAY_MS, help="periodic step / decay release")
+
+
+def settings_from_args(args: argparse.Namespace) -> RenderSettings:
+    return RenderSettings(
+        window_ms=args.window_ms, adc_rate=args.adc_rate, low=args.low, high=args.high, double_window=args.double_window,
+        num_wires=args.num_wires, delay_ms=args.delay_ms,
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Render firmware light modes over WAV files, headless")
+    parser.add_argument("inputs", nargs="+", help="WAV files or directories searched for *.wav")
+    parser.add_argument("-o", "--output", help="directory for the per-file CSV timelines (default: none, stats only)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="worker processes (default: all cores)")
+    add_render_arguments(parser)
+    args = parser.parse_args()
+
+    paths = find_wavs(args.inputs)
+    if not paths:
+        sys.exit("no WAV files found")
+    output_dir = Path(args.output) if args.output else None
+    if output_dir is not None:
+        output_dir.mkdir(parents=True, exist_ok=True)
+    settings = settings_from_args(args)
+
+    start = time.perf_counter()
+    with ProcessPoolExecutor(max_workers=args.jobs) as pool:
+        futures = [pool.submit(render_file, p, output_dir, settings) for p in paths]
+        results = []
+        for future in futures:
+            r = future.result()
+            results.append(r)
+            print(f"{r.path.name}: {r.windows} windows, {r.audio_seconds:.1f} s audio in {r.render_seconds:.2f} s")
+    elapsed = time.perf_counter() - start
+
+    windows = sum(r.windows for r in results)
+    audio_seconds = sum(r.audio_seconds for r in results)
+    mode_count = len(core.modes())
+    print(
+        f"{len(results)} files, {windows} windows x {mode_count} modes in {elapsed:.2f} s: "
+        f"{windows / elapsed:,.0f} windows/s ({windows * mode_count / elapsed:,.0f} mode-windows/s), "
+        f"{audio_seconds / elapsed:,.0f}x real time"
+    )
+
+
+if __name__ == "__main__":
+    main()
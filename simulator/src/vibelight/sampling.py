@@ -1,28 +1,89 @@
 from __future__ import annotations
 import numpy as np
-from constants import LED_COUNT
+from constants import LED_COUNT, ADC_MAX, ADC_MIDPOINT, LEVEL_HYSTERESIS, SIMULATED_SAMPLE_RATE, ADC_BANDWIDTH_HZ
+import core
+
+
+def to_adc_counts(samples: np.ndarray) -> np.ndarray:
+    """Float audio in [-1, 1] as the ESP32 reads it: mid-biased 12-bit counts."""
+    counts = np.rint(ADC_MIDPOINT + np.asarray(samples, dtype=np.float64) * ADC_MIDPOINT)
+    return np.clip(counts, 0, ADC_MAX).astype(np.uint16)
+
+
+class AdcStream:
+    """Host audio resampled to the ADC rate and cut into firmware windows.
+
+    Blocks of any size go in with push(); the resampler keeps its state
+    across them, so windows come out as one continuous band-limited stream
+    however the audio device chunked it.
+    """
+
+    def __init__(self, input_rate: float, window_samples: int, adc_rate: float = SIMULATED_SAMPLE_RATE,
+                 bandwidth_hz: float = ADC_BANDWIDTH_HZ):
+        self._resampler = core.PolyphaseResampler(input_rate, adc_rate, bandwidth_hz)
+        self._window_samples = window_samples
+        self._pending = np.zeros(0, dtype=np.float32)
+
+    def push(self, audio: np.ndarray):
+        self._pending = np.concatenate((self._pending, self._resampler.process(audio)))
+
+    def pop_window(self) -> np.ndarray | None:
+        if len(self._pending) < self._window_samples:
+            return None
+        window, self._pending = self._pending[:self._window_samples], self._pending[self._window_samples:]
+        return window
+
+    def reset(self):
+        self._resampler.reset()
+        self._pending = np.zeros(0, dtype=np.float32)
+
+
+def _adc_count(sample: float) -> int:
+    """to_adc_counts of a single sample."""
+    return int(min(max(round(ADC_MIDPOINT + sample * ADC_MIDPOINT), 0), ADC_MAX))
+
+
+def _to_counts(value: float) -> int:
+    return int(round(value * ADC_MIDPOINT))
+
 
 class PeakToPeakSampler:
+    """Firmware peak-to-peak sampler; double window is the RMS sampling mode.
+
+    Works on ADC counts internally and reports p2p in float units
+    (full scale = 2.0), the scale of the floor/ceiling sliders.
+    """
+
     def __init__(self, double_window: bool = False):
-        self.double_window = double_window
-        self._prev_min: float | None = None
-        self._prev_max: float | None = None
+        self._sampler = core.PeakToPeakSampler(double_window)
+
+    @property
+    def double_window(self) -> bool:
+        return self._sampler.double_window
 
     def feed(self, samples: np.ndarray) -> float:
-        cur_min = float(np.min(samples))
-        cur_max = float(np.max(samples))
-        if self.double_window and self._prev_min is not None:
-            p2p = max(cur_max, self._prev_max) - min(cur_min, self._prev_min)
-        else:
-            p2p = cur_max - cur_min
-        self._prev_min = cur_min
-        self._prev_max = cur_max
-        return p2p
+        # Counts rise with the sample, so only the extremes need converting
+        low, high, _, _ = core.sample_stats(samples)
+        return self._sampler.feed(_adc_count(low), _adc_count(high)) / ADC_MIDPOINT
+
+
+class LevelQuantizer:
+    """Firmware LevelQuantizer (with its hysteresis) on float p2p values."""
+
+    def __init__(self, levels: int = LED_COUNT, hysteresis_percent: int = LEVEL_HYSTERESIS):
+        self._quantizer = core.LevelQuantizer(levels, hysteresis_percent)
+
+    def quantize(self, p2p: float, floor: float, ceiling: float) -> int:
+        self._quantizer.set_range(_to_counts(floor), _to_counts(ceiling))
+        return self._quantizer.quantize(_to_counts(p2p))
+
+
+_stateless_quantizer = core.LevelQuantizer(LED_COUNT, 0)
 
 
 def p2p_to_level(p2p: float, floor: float, ceiling: float) -> int:
+    """Firmware level steps without hysteresis (LevelQuantizer.levelFor)."""
     if ceiling <= floor:
         return 0
-    normalized = (p2p - floor) / (ceiling - floor)
-    normalized = max(0.0, min(1.0, normalized))
-    return round(normalized * LED_COUNT)
+    _stateless_quantizer.set_range(_to_counts(floor), _to_counts(ceiling))
+    return _stateless_quantizer.level_for(_to_counts(p2p))
@@ -0,0 +1,211 @@
+"""
+tune_modes.py
+
+Grid search over the reactive modes' runtime parameters (ModeEngine's
+parameter table, Bluetooth command `V`) on an annotated audio corpus,
+using every core.
+
+Each WAV needs its onsets next to it as <name>.txt (or .onsets): one time
+in seconds per line, extra columns ignored (Audacity/Sonic Visualiser
+label exports work). Run:
+
+    tune-modes corpus/ -o presets.json
+
+A mode's triggers are the windows where it draws a new pattern (for the
+decay mode: where more wires light). Each parameter set is scored by the
+F-measure of triggers against onsets (precision: triggers with an onset
+within --tolerance-ms, recall: onsets with a trigger that close), minus
+--flicker-weight times the share of triggers following the previous one
+by less than --min-gap-ms. The best set per mode is printed next to the
+firmware defaults and as a batch frame to send as is. Frames are numbered
+from --first-seq, by default derived from the clock, because the firmware
+ignores a frame repeating the seq it last applied.
+"""
+
+from __future__ import annotations
+import argparse
+import itertools
+import json
+import os
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass
+from pathlib import Path
+
+import numpy as np
+
+from offline_render import RenderSettings, read_wav, sample_levels, new_engine, find_wavs, add_render_arguments, settings_from_args
+import core
+
+# Parameters tuned per mode, with their grids. continuous modes draw every
+# window, so only windows lighting more wires count as triggers.
+TUNED_MODES: dict[str, tuple[dict[str, tuple[int, ...]], bool]] = {
+    "rBeatPulseDecay": ({"beat": tuple(range(9))}, True),
+    "rRandom": ({"random": tuple(range(9))}, False),
+    "rRandomSwap": ({"swap": tuple(range(9))}, False),
+    "rRandomHL": ({
+        "hlMed": tuple(range(9)),
+        "hlHigh": tuple(range(9)),
+        "hlCool": (0, 250, 500, 1000, 2000, 4000),
+    }, False),
+    "rLinearSweep": ({"sweep": tuple(range(9))}, False),
+}
+
+
+@dataclass
+class Track:
+    name: str
+    times: np.ndarray
+    levels: np.ndarray
+    onsets_ms: np.ndarray
+    seconds: float
+
+
+@dataclass
+class Score:
+    score: float
+    f_measure: float
+    precision: float
+    recall: float
+    triggers_per_second: float
+    flicker: float
+
+
+_tracks: list[Track] = []
+_settings = RenderSettings()
+_scoring: tuple[float, float, float] = (50.0, 100.0, 0.5)
+
+
+def read_onsets(wav: Path) -> np.ndarray | None:
+    for suffix in (".txt", ".onsets"):
+        path = wav.with_suffix(suffix)
+        if path.exists():
+            times = []
+            for line in path.read_text().splitlines():
+                fields = line.split()
+                if fields and not fields[0].startswith("#"):
+                    times.append(float(fields[0]) * 1000)
+            return np.sort(np.array(times))
+    return None
+
+
+def load_track(wav: Path, settings: RenderSettings) -> Track | None:
+    onsets = read_onsets(wav)
+    if onsets is None:
+        return None
+    rate, audio = read_wav(wav)
+    times, _, levels = sample_levels(audio, rate, settings)
+    return Track(wav.name, times, levels, onsets, len(audio) / rate)
+
+
+def _init_worker(tracks: list[Track], settings: RenderSettings, scoring: tuple[float, float, float]):
+    global _tracks, _settings, _scoring
+    _tracks, _settings, _scoring = tracks, settings, scoring
+
+
+def triggers(mode: int, continuous: bool, params: dict[str, int], track: Track) -> np.ndarray:
+    masks, drawn = new_engine(mode, _settings, params).run_many(track.levels, track.times, with_drawn=True)
+    if continuous:
+        lit = np.unpackbits(masks[:, None], axis=1).sum(axis=1).astype(np.int16)
+        drawn = drawn & (np.diff(lit, prepend=lit[:1]) > 0)
+    return track.times[drawn].astype(np.float64)
+
+
+def near(times: np.ndarray, targets: np.ndarray, tolerance: float) -> int:
+    """How many of times have a target within the tolerance (targets sorted)."""
+    if len(times) == 0 or len(targets) == 0:
+        return 0
+    idx = np.searchsorted(targets, times)
+    left = targets[np.clip(idx - 1, 0, len(targets) - 1)]
+    right = targets[np.clip(idx, 0, len(targets) - 1)]
+    return int(np.count_nonzero(np.minimum(np.abs(times - left), np.abs(times - right)) <= tolerance))
+
+
+def evaluate(task: tuple[str, dict[str, int]]) -> tuple[str, dict[str, int], Score]:
+    label, params = task
+    mode = [name for name, _ in core.modes()].index(label)
+    continuous = TUNED_MODES[label][1]
+    tolerance, min_gap, flicker_weight = _scoring
+    true_events = found_onsets = events = onsets = rapid = 0
+    seconds = 0.0
+    for track in _tracks:
+        t = triggers(mode, continuous, params, track)
+        true_events += near(t, track.onsets_ms, tolerance)
+        found_onsets += near(track.onsets_ms, t, tolerance)
+        events += len(t)
+        onsets += len(track.onsets_ms)
+        rapid += int(np.count_nonzero(np.diff(t) < min_gap))
+        seconds += track.seconds
+    precision = true_events / events if events else 0.0
+    recall = found_onsets / onsets if onsets else 0.0
+    f = 2 * precision * recall / (precision + recall) if precision + recall > 0 else 0.0
+    flicker = rapid / events if events else 0.0
+    return label, params, Score(f - flicker_weight * flicker, f, precision, recall, events / seconds, flicker)
+
+
+def grid(label: str) -> list[dict[str, int]]:
+    space = TUNED_MODES[label][0]
+    combos = [dict(zip(space, values)) for values in itertools.product(*space.values())]
+    # A medium level above the high one never fires
+    return [c for c in combos if c.get("hlMed", 0) <= c.get("hlHigh", 8)]
+
+
+def defaults(label: str) -> dict[str, int]:
+    table = {name: default for name, _, _, default in core.mode_params()}
+    return {name: table[name] for name in TUNED_MODES[label][0]}
+
+
+def batch_frame(seq: int, params: dict[str, int]) -> str:
+    return f"#{seq}|" + ";".join(f"V{name}={value}" for name, value in params.items())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Tune reactive mode parameters on an annotated corpus")
+    parser.add_argument("inputs", nargs="+", help="WAV files or directories; onsets in <name>.txt or .onsets")
+    parser.add_argument("-o", "--output", help="write the presets as JSON")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="worker processes (default: all cores)")
+    parser.add_argument("--modes", nargs="+", choices=list(TUNED_MODES), default=list(TUNED_MODES))
+    parser.add_argument("--tolerance-ms", type=float, default=50.0, help="onset match window (default: 50)")
+    parser.add_argument("--min-gap-ms", type=float, default=100.0, help="triggers closer than this flicker")
+    parser.add_argument("--flicker-weight", type=float, default=0.5)
+    parser.add_argument("--first-seq", type=int, default=int(time.time()) % 1_000_000_000,
+                        help="seq of the first batch frame (default: from the clock)")
+    add_render_arguments(parser)
+    args = parser.parse_args()
+
+    settings = settings_from_args(args)
+    paths = find_wavs(args.inputs)
+    with ProcessPoolExecutor(max_workers=args.jobs) as pool:
+        tracks = [t for t in pool.map(load_track, paths, itertools.repeat(settings)) if t is not None]
+    if not tracks:
+        sys.exit("no WAV files with onset annotations found")
+    print(f"{len(tracks)} annotated tracks, {sum(len(t.onsets_ms) for t in tracks)} onsets")
+
+    tasks = [(label, params) for label in args.modes for params in grid(label)]
+    scoring = (args.tolerance_ms, args.min_gap_ms, args.flicker_weight)
+    with ProcessPoolExecutor(max_workers=args.jobs, initializer=_init_worker,
+                             initargs=(tracks, settings, scoring)) as pool:
+        results = list(pool.map(evaluate, tasks, chunksize=max(1, len(tasks) // (8 * (args.jobs or 1)))))
+    _init_worker(tracks, settings, scoring)
+
+    presets = {}
+    for seq, label in enumerate(args.modes, start=args.first_seq):
+        best = max((r for r in results if r[0] == label), key=lambda r: r[2].score)
+        base = evaluate((label, defaults(label)))
+        s = best[2]
+        print(
+            f"{label}: {best[1]} score {s.score:.3f} (F {s.f_measure:.3f}, P {s.precision:.3f}, "
+            f"R {s.recall:.3f}, {s.triggers_per_second:.2f} triggers/s, flicker {s.flicker:.3f}); "
+            f"defaults {base[1]} score {base[2].score:.3f}"
+        )
+        print(f"  send: {batch_frame(seq, best[1])}")
+        presets[label] = {"params": best[1], "frame": batch_frame(seq, best[1]), "score": vars(s), "default_score": vars(base[2])}
+    print(f"{len(tasks)} parameter sets evaluated")
+
+    if args.output:
+        Path(args.output).write_text(json.dumps(presets, indent=2))
+
+
+if __name__ == "__main__":
+    main()
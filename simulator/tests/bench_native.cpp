@@ -0,0 +1,76 @@
+#include "WindowKernels.cpp"
+
+#include <initializer_list>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "PolyphaseResampler.h"
+
+// Throughput of the host-side natives: the resampler feeding the
+// simulator's capture path in 617-sample blocks (14 ms at 44.1 kHz), and
+// the window kernels against the four separate passes they replaced, at
+// one firmware window (280) and a large capture buffer (65536).
+
+static volatile double sink;
+
+template <class F> static double secondsPer(F f, size_t samples) {
+  size_t reps = std::max<size_t>(1, 400000000 / samples);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; r++) f();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+static void benchResampler() {
+  const size_t block = 617;
+  std::mt19937 g(2);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::vector<float> x(1 << 22);
+  for (float& v : x) v = noise(g);
+  for (double rate : { 44100.0, 48000.0 }) {
+    PolyphaseResampler r(rate, 20000);
+    std::vector<float> y(r.maxOutput(block));
+    size_t produced = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 3; rep++) {
+      for (size_t i = 0; i + block <= x.size(); i += block) produced += r.process(&x[i], block, y.data());
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("resampler %.0f -> 20000 (%u taps): %.1f M input samples/s (%.0fx real time), %.1f M output/s\n",
+      rate, r.getTapCount(), 3.0 * x.size() / s / 1e6, 3.0 * x.size() / s / rate, produced / s / 1e6);
+  }
+}
+
+template <class T, class S> static void benchKernels(const char* type, const std::vector<T>& x) {
+  size_t n = x.size();
+  S stats;
+  double passes = secondsPer([&] {
+    T lo = *std::min_element(x.begin(), x.end());
+    T hi = *std::max_element(x.begin(), x.end());
+    double sum = 0, squares = 0;
+    for (T v : x) sum += v;
+    for (T v : x) squares += (double)v * v;
+    sink = lo + hi + sum + squares;
+  }, n);
+  double scalar = secondsPer([&] { reduceScalar(x.data(), n, stats); sink = stats.sum; }, n);
+  double dispatched = secondsPer([&] { WindowKernels::reduce(x.data(), n, stats); sink = stats.sum; }, n);
+  printf("%s n=%zu: 4 passes %.0f ns, scalar %.0f ns, %s %.0f ns (%.2f G samples/s, %.1fx the passes)\n",
+    type, n, passes * 1e9, scalar * 1e9, WindowKernels::instructionSet(), dispatched * 1e9,
+    n / dispatched / 1e9, passes / dispatched);
+}
+
+int main() {
+  benchResampler();
+  std::mt19937 g(3);
+  for (size_t n : { 280, 65536 }) {
+    std::vector<int16_t> pcm(n);
+    std::vector<float> audio(n);
+    for (size_t i = 0; i < n; i++) {
+      pcm[i] = (int16_t)(g() & 0xFFFF);
+      audio[i] = (float)(int32_t)g() / 2147483648.0f;
+    }
+    benchKernels<int16_t, Int16Stats>("int16", pcm);
+    benchKernels<float, FloatStats>("float", audio);
+  }
+  return 0;
+}
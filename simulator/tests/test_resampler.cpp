@@ -0,0 +1,120 @@
+#include <initializer_list>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "PolyphaseResampler.h"
+
+#define INPUT_RATE 44100.0
+#define OUTPUT_RATE 20000.0
+#define WINDOW 280 // samples per firmware window at OUTPUT_RATE
+
+static std::vector<float> resample(PolyphaseResampler& r, const std::vector<float>& x) {
+  std::vector<float> y(r.maxOutput(x.size()));
+  y.resize(r.process(x.data(), x.size(), y.data()));
+  return y;
+}
+
+static std::vector<float> tone(double f, size_t n) {
+  std::vector<float> x(n);
+  for (size_t i = 0; i < n; i++) x[i] = (float)sin(2 * M_PI * f * i / INPUT_RATE);
+  return x;
+}
+
+// Amplitude of a resampled full-scale tone, after the filter has settled
+static double gainDb(double f) {
+  PolyphaseResampler r(INPUT_RATE, OUTPUT_RATE);
+  std::vector<float> y = resample(r, tone(f, (size_t)INPUT_RATE));
+  double squares = 0;
+  size_t n = 0;
+  for (size_t i = WINDOW; i < y.size(); i++, n++) squares += (double)y[i] * y[i];
+  return 20 * log10(sqrt(2 * squares / n) + 1e-12);
+}
+
+// Output does not depend on how the input is split into blocks
+static void testSplitInvariance() {
+  std::mt19937 g(1);
+  std::normal_distribution<float> noise(0, 0.3f);
+  std::vector<float> x(200000);
+  for (float& v : x) v = noise(g);
+
+  PolyphaseResampler whole(INPUT_RATE, OUTPUT_RATE), split(INPUT_RATE, OUTPUT_RATE);
+  std::vector<float> a = resample(whole, x);
+  std::vector<float> b;
+  std::uniform_int_distribution<int> block(1, 1500);
+  for (size_t i = 0; i < x.size();) {
+    size_t n = std::min((size_t)block(g), x.size() - i);
+    std::vector<float> part(split.maxOutput(n));
+    part.resize(split.process(&x[i], n, part.data()));
+    b.insert(b.end(), part.begin(), part.end());
+    i += n;
+  }
+  CHECK(a == b);
+  // Output lags by up to the filter's half length, held until input follows
+  double expected = x.size() * OUTPUT_RATE / INPUT_RATE;
+  CHECK(a.size() <= expected + 1);
+  CHECK(a.size() >= expected - whole.getTapCount());
+
+  // reset() starts the stream over
+  whole.reset();
+  CHECK(resample(whole, x) == a);
+}
+
+static void testTones() {
+  double ripple = 0, aliasing = -INFINITY;
+  for (double f = 500; f < INPUT_RATE / 2; f += 500) {
+    double g = gainDb(f);
+    if (f <= 9000) ripple = std::max(ripple, fabs(g));
+    if (f >= 11000) aliasing = std::max(aliasing, g);
+  }
+  printf("passband to 9 kHz within %.3f dB; tones from 11 kHz at most %.1f dB\n", ripple, aliasing);
+  CHECK(ripple < 0.1);
+  CHECK(aliasing < -RESAMPLER_STOPBAND_DB + 6);
+}
+
+// A log sweep over the whole input band: once past the point where a tone
+// would fold back below the cutoff, no window may light up
+static void testSweep() {
+  const double seconds = 10, start = 20, end = 22000;
+  size_t n = (size_t)(INPUT_RATE * seconds);
+  std::vector<float> x(n);
+  double phase = 0;
+  for (size_t i = 0; i < n; i++) {
+    double f = start * pow(end / start, (double)i / n);
+    phase += 2 * M_PI * f / INPUT_RATE;
+    x[i] = (float)sin(phase);
+  }
+  PolyphaseResampler r(INPUT_RATE, OUTPUT_RATE);
+  std::vector<float> y = resample(r, x);
+
+  double worst = 0, passband = INFINITY;
+  for (size_t w = 0; (w + 1) * WINDOW <= y.size(); w++) {
+    double t = (w * WINDOW + WINDOW / 2) / OUTPUT_RATE;
+    double f = start * pow(end / start, t / seconds);
+    auto range = std::minmax_element(y.begin() + w * WINDOW, y.begin() + (w + 1) * WINDOW);
+    double p2p = *range.second - *range.first;
+    if (f >= 11500) worst = std::max(worst, p2p);
+    if (f >= 200 && f <= 4000) passband = std::min(passband, p2p);
+  }
+  printf("sweep: windows above 11.5 kHz peak-to-peak at most %.5f (%.1f dB of full scale), "
+    "200 Hz to 4 kHz at least %.3f\n", worst, 20 * log10(worst / 2 + 1e-12), passband);
+  CHECK(worst / 2 < pow(10, -60 / 20.0));
+  CHECK(passband > 1.9);
+}
+
+static void testCutoff() {
+  PolyphaseResampler automatic(INPUT_RATE, OUTPUT_RATE);
+  CHECK_NEAR(automatic.getCutoff(), 0.9 * OUTPUT_RATE / 2, 1e-6);
+  CHECK(automatic.getTapCount() % 8 == 0);
+  PolyphaseResampler upsampling(OUTPUT_RATE, INPUT_RATE);
+  CHECK_NEAR(upsampling.getCutoff(), 0.9 * OUTPUT_RATE / 2, 1e-6);
+}
+
+int main() {
+  testSplitInvariance();
+  testTones();
+  testSweep();
+  testCutoff();
+  return checkResult();
+}
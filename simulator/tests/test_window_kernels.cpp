@@ -0,0 +1,78 @@
+// Built from the source so every compiled-in variant can be called, not
+// just the one the dispatcher picks
+#include "WindowKernels.cpp"
+
+#include <initializer_list>
+#include <random>
+#include <vector>
+#include "check.h"
+
+static bool same(const Int16Stats& a, const Int16Stats& b) {
+  return a.min == b.min && a.max == b.max && a.sum == b.sum && a.sumSquares == b.sumSquares;
+}
+
+// Vector lanes add in a different order; float sums differ by rounding
+static bool same(const FloatStats& a, const FloatStats& b) {
+  return a.min == b.min && a.max == b.max &&
+    fabs(a.sum - b.sum) <= 1e-4 * (1 + fabs(b.sum)) &&
+    fabs(a.sumSquares - b.sumSquares) <= 1e-5 * (1 + b.sumSquares);
+}
+
+struct Variant {
+  const char* name;
+  void (*reduceInt16)(const int16_t*, size_t, Int16Stats&);
+  void (*reduceFloat)(const float*, size_t, FloatStats&);
+};
+
+static std::vector<Variant> variants() {
+  std::vector<Variant> v;
+  v.push_back({ "dispatched", WindowKernels::reduce, WindowKernels::reduce });
+#if defined(KERNELS_SSE2)
+  v.push_back({ "sse2", reduceSse2, reduceSse2 });
+#endif
+#if defined(KERNELS_AVX2)
+  if (__builtin_cpu_supports("avx2")) v.push_back({ "avx2", reduceAvx2, reduceAvx2 });
+#endif
+#if defined(KERNELS_NEON)
+  v.push_back({ "neon", reduceNeon, reduceNeon });
+#endif
+  return v;
+}
+
+int main() {
+  std::vector<Variant> kernels = variants();
+  printf("dispatch: %s; checking", WindowKernels::instructionSet());
+  for (const Variant& k : kernels) printf(" %s", k.name);
+  printf("\n");
+
+  std::mt19937 g(3);
+  for (const Variant& k : kernels) {
+    unsigned mismatches = 0;
+    // Every tail length, then long windows past the block flush; some are
+    // all -32768, where the squares come closest to overflowing
+    for (int t = 0; t < 400; t++) {
+      size_t n = t < 100 ? t : g() % 200000;
+      std::vector<int16_t> pcm(n);
+      std::vector<float> audio(n);
+      for (size_t i = 0; i < n; i++) {
+        pcm[i] = t % 7 == 0 ? INT16_MIN : (int16_t)(g() & 0xFFFF);
+        audio[i] = (float)(int32_t)g() / 2147483648.0f;
+      }
+      Int16Stats expected, actual;
+      reduceScalar(pcm.data(), n, expected);
+      k.reduceInt16(pcm.data(), n, actual);
+      mismatches += !same(actual, expected);
+      FloatStats expectedFloat, actualFloat;
+      reduceScalar(audio.data(), n, expectedFloat);
+      k.reduceFloat(audio.data(), n, actualFloat);
+      mismatches += !same(actualFloat, expectedFloat);
+    }
+    if (!CHECK(mismatches == 0)) fprintf(stderr, "  %s: %u mismatches\n", k.name, mismatches);
+  }
+
+  // An empty window gives the identities
+  Int16Stats empty;
+  WindowKernels::reduce((const int16_t*)nullptr, 0, empty);
+  CHECK(empty.min > empty.max && empty.sum == 0 && empty.sumSquares == 0);
+  return checkResult();
+}